@@ -34,10 +34,9 @@ static void generateCSV_payload(char *res, size_t res_size, const char *timestam
 template <typename T>
 static void add_value2JSON_array(JsonArray arr, const char *key, T &value)
 {
-    JsonDocument doc;
-    doc["value_type"] = key;
-    doc["value"] = value;
-    arr.add(doc);
+    JsonObject obj = arr.add<JsonObject>(); // built in place, no temporary document
+    obj["value_type"] = key;
+    obj["value"] = value;
 }
 bool validateJson(const char *input);
 
@@ -10,6 +10,11 @@
 #include "dhtnew.h"
 #include <stdint.h>
 
+#if defined(ESP32)
+#include "driver/gpio.h"
+#include "soc/gpio_reg.h"
+#endif
+
 //  these defines are not for user to adjust (microseconds)
 //  it adds 10% above the data sheet to allow a margin.
 #define DHTLIB_DHT11_WAKEUP (18 * 1100UL)
@@ -186,7 +191,11 @@ int DHTNEW::read()
 int DHTNEW::_read()
 {
     //  READ VALUES
+#if defined(ESP32)
+    int rv = _edgeCapture ? _readSensorEdges() : _readSensor();
+#else
     int rv = _readSensor();
+#endif
 
     //  enable interrupts again
 #if defined(ESP32)
@@ -209,48 +218,7 @@ int DHTNEW::_read()
         return rv; //  propagate error value
     }
 
-    if (_type == 11) //  DHT11, DH12, KY015 compatible
-    {
-        _humidity = _bits[0];
-        if (_bits[1])
-            _humidity += _bits[1] * 0.1;
-        _temperature = _bits[2];
-        if (_bits[3])
-            _temperature += _bits[3] * 0.1;
-    }
-    else //  DHT22, DHT33, DHT44, compatible + Si7021
-    {
-        _humidity = (_bits[0] * 256 + _bits[1]) * 0.1;
-
-        //  positive temperature?
-        if ((_bits[2] & 0x80) != 0x80)
-        {
-            int16_t t = ((_bits[2] & 0x7F) * 256 + _bits[3]);
-            //  prevent -0.0;
-            if (t == 0)
-            {
-                _temperature = 0.0;
-            }
-            else
-            {
-                _temperature = t * 0.1;
-            }
-        }
-        else //  negative temperature
-        {
-            //  See issue #100 - 2 different representations
-            if ((_bits[2] & 0x40) != 0x40)
-            {
-                int16_t t = ((_bits[2] & 0x7F) * 256 + _bits[3]);
-                _temperature = t * -0.1;
-            }
-            else
-            {
-                int16_t t = (_bits[2] << 8) + _bits[3]; //  16 bits, as raw int
-                _temperature = t * 0.1;
-            }
-        }
-    }
+    dhtConvertBits(_bits, _type, _humidity, _temperature);
 
     //  HEXDUMP DEBUG
     /*
@@ -312,6 +280,97 @@ int DHTNEW::_read()
     return DHTLIB_OK;
 }
 
+/////////////////////////////////////////////////////
+//
+//  DECODING (no hardware access)
+//
+void dhtConvertBits(const uint8_t bits[5], uint8_t type, float &humidity, float &temperature)
+{
+    if (type == 11) //  DHT11, DH12, KY015 compatible
+    {
+        humidity = bits[0];
+        if (bits[1])
+            humidity += bits[1] * 0.1;
+        temperature = bits[2];
+        if (bits[3])
+            temperature += bits[3] * 0.1;
+    }
+    else //  DHT22, DHT33, DHT44, compatible + Si7021
+    {
+        humidity = (bits[0] * 256 + bits[1]) * 0.1;
+
+        //  positive temperature?
+        if ((bits[2] & 0x80) != 0x80)
+        {
+            int16_t t = ((bits[2] & 0x7F) * 256 + bits[3]);
+            //  prevent -0.0;
+            if (t == 0)
+            {
+                temperature = 0.0;
+            }
+            else
+            {
+                temperature = t * 0.1;
+            }
+        }
+        else //  negative temperature
+        {
+            //  See issue #100 - 2 different representations
+            if ((bits[2] & 0x40) != 0x40)
+            {
+                int16_t t = ((bits[2] & 0x7F) * 256 + bits[3]);
+                temperature = t * -0.1;
+            }
+            else
+            {
+                int16_t t = (bits[2] << 8) + bits[3]; //  16 bits, as raw int
+                temperature = t * 0.1;
+            }
+        }
+    }
+}
+
+int dhtDecodePulses(const uint16_t *highPulses, uint8_t count, uint8_t bits[5], uint16_t threshold)
+{
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        bits[i] = 0;
+    }
+    if (count < 40)
+        return DHTLIB_ERROR_TIMEOUT_C;
+
+    //  26-28 us  ==>  0
+    //     70 us  ==>  1
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        if (highPulses[i] > threshold)
+        {
+            bits[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+
+    //  see _readSensor(): humidity MSB may never be set
+    if (bits[0] & 0x80)
+        return DHTLIB_ERROR_BIT_SHIFT;
+
+    uint8_t sum = bits[0] + bits[1] + bits[2] + bits[3];
+    if (bits[4] != sum)
+        return DHTLIB_ERROR_CHECKSUM;
+
+    return DHTLIB_OK;
+}
+
+int dhtDecode(const uint16_t *highPulses, uint8_t count, uint8_t type,
+              float &humidity, float &temperature)
+{
+    uint8_t bits[5];
+    int rv = dhtDecodePulses(highPulses, count, bits);
+    if (rv != DHTLIB_OK)
+        return rv;
+    dhtConvertBits(bits, type, humidity, temperature);
+    return DHTLIB_OK;
+}
+
 void DHTNEW::powerUp()
 {
     digitalWrite(_dataPin, HIGH);
@@ -457,6 +516,120 @@ int DHTNEW::_readSensor()
     return DHTLIB_OK;
 }
 
+#if defined(ESP32)
+//  level of a pin straight from the GPIO input registers;
+//  digitalRead() and gpio_get_level() live in flash
+static inline uint8_t IRAM_ATTR dhtPinLevel(uint8_t pin)
+{
+    uint32_t in = pin < 32 ? REG_READ(GPIO_IN_REG) : REG_READ(GPIO_IN1_REG);
+    return (in >> (pin & 31)) & 1;
+}
+
+//  runs from IRAM with everything it calls (micros() is IRAM_ATTR in the core),
+//  so an edge is not lost while the flash cache is off for a LittleFS write
+void IRAM_ATTR DHTNEW::_edgeISR(void *arg)
+{
+    DHTNEW *self = static_cast<DHTNEW *>(arg);
+    uint8_t n = self->_edgeCount;
+    if (n < DHTLIB_MAX_EDGES)
+    {
+        self->_edgeTime[n] = micros();
+        self->_edgeLevel[n] = dhtPinLevel(self->_dataPin);
+        self->_edgeCount = n + 1;
+    }
+}
+
+//  edge interrupt straight through the GPIO ISR service, installed IRAM-safe
+//  unless attachInterrupt() installed it first; attachInterruptArg() goes
+//  through the core's dispatcher, which is in flash unless CONFIG_ARDUINO_ISR_IRAM
+void DHTNEW::_attachEdgeISR()
+{
+    gpio_num_t pin = (gpio_num_t)_dataPin;
+    gpio_install_isr_service(ESP_INTR_FLAG_IRAM); //  ESP_ERR_INVALID_STATE if already installed
+    gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+    gpio_isr_handler_add(pin, _edgeISR, this);
+    gpio_intr_enable(pin);
+}
+
+void DHTNEW::_detachEdgeISR()
+{
+    gpio_num_t pin = (gpio_num_t)_dataPin;
+    gpio_intr_disable(pin);
+    gpio_isr_handler_remove(pin);
+    gpio_set_intr_type(pin, GPIO_INTR_DISABLE);
+}
+
+//  same protocol as _readSensor() but the line is sampled by an edge ISR,
+//  interrupts stay enabled so the UARTs keep being serviced.
+//  return values:
+//  DHTLIB_OK
+//  DHTLIB_ERROR_CHECKSUM
+//  DHTLIB_ERROR_BIT_SHIFT
+//  DHTLIB_ERROR_SENSOR_NOT_READY
+//  DHTLIB_ERROR_TIMEOUT_C
+int DHTNEW::_readSensorEdges()
+{
+    //  REQUEST SAMPLE - SEND WAKEUP TO SENSOR
+    pinMode(_dataPin, OUTPUT);
+    digitalWrite(_dataPin, LOW);
+    if (_type == 70)
+    {
+        delayMicroseconds(DHTLIB_SI7021_WAKEUP);
+    }
+    else
+    {
+        delayMicroseconds(_wakeupDelay);
+    }
+
+    //  HOST GIVES CONTROL TO SENSOR, capture every edge from here
+    _edgeCount = 0;
+    _attachEdgeISR();
+    digitalWrite(_dataPin, HIGH);
+    pinMode(_dataPin, INPUT_PULLUP);
+
+    //  response (160 us) + 40 bits (max 120 us each) is about 5 ms,
+    //  DHT11 may take 10 ms more to respond
+    uint32_t timeout = (_type == 11) ? 25 : 10;
+    uint32_t start = millis();
+    while ((millis() - start) < timeout && _edgeCount < DHTLIB_MAX_EDGES)
+    {
+        delay(1);
+    }
+    _detachEdgeISR();
+
+    //  HIGH pulse widths; the data bits are the last 40 complete ones
+    //  (before them: the host release and the 80 us sensor response)
+    uint16_t highPulses[DHTLIB_MAX_EDGES / 2];
+    uint8_t pulses = 0;
+    uint8_t edges = _edgeCount;
+    bool high = false;
+    uint32_t riseTime = 0;
+    for (uint8_t i = 0; i < edges && pulses < DHTLIB_MAX_EDGES / 2; i++)
+    {
+        if (_edgeLevel[i] == HIGH)
+        {
+            high = true;
+            riseTime = _edgeTime[i];
+        }
+        else if (high)
+        {
+            uint32_t width = _edgeTime[i] - riseTime;
+            highPulses[pulses++] = width > 0xFFFF ? 0xFFFF : width;
+            high = false;
+        }
+    }
+
+    if (pulses == 0)
+        return DHTLIB_ERROR_SENSOR_NOT_READY;
+    if (pulses < 40)
+        return DHTLIB_ERROR_TIMEOUT_C;
+
+    int rv = dhtDecodePulses(&highPulses[pulses - 40], 40, _bits);
+    //  checksum is verified again by _read() after the offsets
+    return rv == DHTLIB_ERROR_CHECKSUM ? DHTLIB_OK : rv;
+}
+#endif
+
 //  returns true  if timeout has passed.
 //  returns false if timeout is not reached and state is seen.
 bool DHTNEW::_waitFor(uint8_t state, uint32_t timeout)
@@ -47,6 +47,25 @@
 #define DHTLIB_BIT_THRESHOLD 50
 #endif
 
+//  edge capture read (ESP32): edges are time stamped by an ISR
+//  with interrupts enabled and decoded afterwards.
+//  wake-up response + 40 bits = 83 edges, some spare for glitches.
+#ifndef DHTLIB_MAX_EDGES
+#define DHTLIB_MAX_EDGES 96
+#endif
+
+//  pure decoding helpers, no hardware access
+//  highPulses : duration in us of the HIGH part of each data bit, MSB first
+//  returns DHTLIB_OK, DHTLIB_ERROR_TIMEOUT_C (too few bits),
+//  DHTLIB_ERROR_BIT_SHIFT or DHTLIB_ERROR_CHECKSUM
+int dhtDecodePulses(const uint16_t *highPulses, uint8_t count, uint8_t bits[5],
+                    uint16_t threshold = DHTLIB_BIT_THRESHOLD);
+//  bits to humidity / temperature for the given type (11, 22, 70)
+void dhtConvertBits(const uint8_t bits[5], uint8_t type, float &humidity, float &temperature);
+//  pulse widths straight to humidity / temperature, offsets not applied
+int dhtDecode(const uint16_t *highPulses, uint8_t count, uint8_t type,
+              float &humidity, float &temperature);
+
 class DHTNEW
 {
 public:
@@ -92,6 +111,12 @@ public:
     bool getDisableIRQ() { return _disableIRQ; };
     void setDisableIRQ(bool b) { _disableIRQ = b; };
 
+    //  EDGE CAPTURE (ESP32 only, ignored elsewhere)
+    //  read the sensor by time stamping edges in an ISR instead of
+    //  bit banging with interrupts disabled; the legacy path stays the default
+    bool getEdgeCapture() { return _edgeCapture; };
+    void setEdgeCapture(bool b) { _edgeCapture = b; };
+
     bool getWaitForReading() { return _waitForRead; };
     void setWaitForReading(bool b) { _waitForRead = b; };
 
@@ -122,10 +147,22 @@ private:
     bool _suppressError = false;
     uint16_t _readDelay = 0;
 
+    bool _edgeCapture = false;
+
     uint8_t _bits[5]; //  buffer to receive data
     int _read();
     int _readSensor();
     bool _waitFor(uint8_t state, uint32_t timeout);
+
+#if defined(ESP32)
+    volatile uint8_t _edgeCount = 0;
+    uint32_t _edgeTime[DHTLIB_MAX_EDGES];
+    uint8_t _edgeLevel[DHTLIB_MAX_EDGES];
+    int _readSensorEdges();
+    static void _edgeISR(void *arg);
+    void _attachEdgeISR();
+    void _detachEdgeISR();
+#endif
 };
 
 //  -- END OF FILE --
@@ -0,0 +1,160 @@
+/* PlantowerFrameParser
+ Incremental (byte at a time) parser for Plantower PMSx003 messages.
+*/
+
+#include "PMframe.h"
+#include <string.h>
+
+PlantowerFrameParser::RESULT PlantowerFrameParser::feed(uint8_t c)
+{
+    if (heldLen == 0)
+        return step(c);
+
+    // bytes held back by resync() come first
+    uint8_t pending[MAX_FRAME_LEN + 1];
+    uint8_t count = heldLen;
+    memcpy(pending, held, count);
+    pending[count++] = c;
+    heldLen = 0;
+    return replay(pending, count);
+}
+
+PlantowerFrameParser::RESULT PlantowerFrameParser::feed(const uint8_t *data, size_t len, size_t &consumed)
+{
+    RESULT res = NEED_MORE;
+    for (consumed = 0; consumed < len;)
+    {
+        res = feed(data[consumed++]);
+        if (res == FRAME_READY)
+            break;
+    }
+    return res;
+}
+
+PlantowerFrameParser::RESULT PlantowerFrameParser::step(uint8_t c)
+{
+    switch (state)
+    {
+    case WAIT_B:
+        if (c != 'B')
+        {
+            skipped++;
+            return NEED_MORE;
+        }
+        buffer[0] = c;
+        pos = 1;
+        sum = c;
+        state = WAIT_M;
+        return NEED_MORE;
+
+    case WAIT_M:
+        if (c == 'M')
+        {
+            buffer[pos++] = c;
+            sum += c;
+            state = LEN_MSB;
+        }
+        else if (c == 'B')
+        {
+            skipped++; // "BB": the second 'B' may still start a message
+        }
+        else
+        {
+            skipped += 2;
+            restart();
+        }
+        return NEED_MORE;
+
+    case LEN_MSB:
+        buffer[pos++] = c;
+        sum += c;
+        state = LEN_LSB;
+        return NEED_MORE;
+
+    case LEN_LSB:
+    {
+        buffer[pos++] = c;
+        sum += c;
+        uint16_t messageLen = HEADER_LEN + ((buffer[2] << 8) | c);
+        if (messageLen != 24 && messageLen != 32 && messageLen != 40)
+        {
+            length_errors++;
+            return resync(1) ? FRAME_READY : ERROR_LENGTH;
+        }
+        frameLen = messageLen;
+        state = BODY;
+        return NEED_MORE;
+    }
+
+    case BODY:
+        buffer[pos++] = c;
+        if (pos <= frameLen - 2)
+        {
+            sum += c; // cksum=byte01+..+byte(len-2)
+            return NEED_MORE;
+        }
+        if (pos < frameLen)
+            return NEED_MORE;
+
+        if (sum == ((buffer[frameLen - 2] << 8) | buffer[frameLen - 1]))
+        {
+            frames++;
+            state = WAIT_B; // frame() stays valid until the next byte is fed
+            pos = 0;
+            return FRAME_READY;
+        }
+        cksum_errors++;
+        return resync(1) ? FRAME_READY : ERROR_CKSUM;
+    }
+    return NEED_MORE;
+}
+
+// decode bytes already taken from the line; stops at a complete message
+// and holds back the bytes after it for the next feed()
+PlantowerFrameParser::RESULT PlantowerFrameParser::replay(const uint8_t *data, uint8_t count)
+{
+    RESULT res = NEED_MORE;
+    for (uint8_t n = 0; n < count; n++)
+    {
+        RESULT r = step(data[n]);
+        if (r == FRAME_READY)
+        {
+            hold(data + n + 1, count - n - 1);
+            return r;
+        }
+        if (r != NEED_MORE)
+            res = r;
+    }
+    return res;
+}
+
+// replay the rejected bytes (after the bad 'B') so a message that started
+// inside them is picked up instead of being thrown away with the bad one;
+// returns true if the replay already completed a message
+bool PlantowerFrameParser::resync(uint8_t from)
+{
+    uint8_t rejected[MAX_FRAME_LEN];
+    uint8_t count = 0;
+    for (uint8_t n = from; n < pos; n++)
+    {
+        rejected[count++] = buffer[n];
+    }
+    skipped += from;
+    restart();
+
+    // a complete message can only hide in the rejected bytes when
+    // sensors with different message lengths share a line
+    return replay(rejected, count) == FRAME_READY;
+}
+
+// appended after bytes held by a nested resync(), which came first on the line
+void PlantowerFrameParser::hold(const uint8_t *data, uint8_t count)
+{
+    if (count > MAX_FRAME_LEN - heldLen)
+    {
+        skipped += count - (MAX_FRAME_LEN - heldLen); // cannot happen: a message takes at least 24 of 40 bytes
+        count = MAX_FRAME_LEN - heldLen;
+    }
+    memcpy(held + heldLen, data, count);
+    heldLen += count;
+}
@@ -0,0 +1,88 @@
+/* PlantowerFrameParser
+ Incremental (byte at a time) parser for Plantower PMSx003 messages.
+ Bytes can be pushed from a polling loop, a UART event queue or an ISR;
+ the parser never blocks or waits.
+
+ Message: 'B' 'M' <len MSB> <len LSB> <body: len bytes, last 2 = cksum>
+ Full message length (4 + len) must be 24, 32 or 40 bytes.
+*/
+#ifndef _PMFRAME_H
+#define _PMFRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class PlantowerFrameParser
+{
+public:
+    static const uint8_t HEADER_LEN = 4;
+    static const uint8_t MAX_FRAME_LEN = 40;
+
+    enum RESULT
+    {
+        NEED_MORE,    // frame in progress (or still hunting for 'BM')
+        FRAME_READY,  // frame() holds a complete, checksum-verified message
+        ERROR_LENGTH, // header announced an unsupported message length
+        ERROR_CKSUM   // complete message with a wrong checksum
+    };
+
+    PlantowerFrameParser() { reset(); }
+
+    void reset()
+    {
+        restart();
+        heldLen = 0;
+    }
+
+    // push one byte; on an error the parser has already re-synchronised
+    // on any 'BM' found in the rejected bytes, so no following frame is lost
+    RESULT feed(uint8_t c);
+
+    // push a block of bytes, stops at the first complete frame;
+    // consumed returns how many bytes were taken from data
+    RESULT feed(const uint8_t *data, size_t len, size_t &consumed);
+
+    inline const uint8_t *frame() const { return buffer; }
+    inline uint8_t length() const { return frameLen; }
+    inline bool in_sync() const { return state != WAIT_B; }
+
+    // diagnostics
+    uint32_t frames = 0;       // good frames
+    uint32_t skipped = 0;      // bytes discarded while hunting for 'BM'
+    uint32_t length_errors = 0;
+    uint32_t cksum_errors = 0;
+
+protected:
+    enum STATE
+    {
+        WAIT_B,
+        WAIT_M,
+        LEN_MSB,
+        LEN_LSB,
+        BODY
+    } state;
+
+    uint8_t buffer[MAX_FRAME_LEN];
+    uint8_t pos;      // bytes stored in buffer
+    uint8_t frameLen; // expected (then completed) message length
+    uint16_t sum;     // running checksum over buffer[0..frameLen-3]
+
+    // replayed bytes that followed a message found by resync(),
+    // decoded before the next byte fed
+    uint8_t held[MAX_FRAME_LEN];
+    uint8_t heldLen;
+
+    void restart()
+    {
+        state = WAIT_B;
+        pos = 0;
+        frameLen = 0;
+        sum = 0;
+    }
+    RESULT step(uint8_t c);
+    RESULT replay(const uint8_t *data, uint8_t count);
+    bool resync(uint8_t from);
+    void hold(const uint8_t *data, uint8_t count);
+};
+
+#endif //_PMFRAME_H
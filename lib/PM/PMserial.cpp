@@ -91,20 +91,22 @@ void SerialPM::init()
     }
 }
 
-void SerialPM::sleep()
+void SerialPM::sleep(bool wait)
 {
     uart->write(slp, msgLen); // sleep mode
     uart->flush();
-    delay(max_wait_ms * 2);
+    if (wait)
+        delay(max_wait_ms * 2);
 }
-void SerialPM::wake()
+void SerialPM::wake(bool wait)
 {
     uart->write(wak, msgLen); // wake mode
     uart->flush();
-    delay(max_wait_ms * 2);
+    if (wait)
+        delay(max_wait_ms * 2);
 }
 
-SerialPM::STATUS SerialPM::trigRead()
+void SerialPM::sendTrigger()
 {
 #ifdef HAS_SW_SERIAL
     if (hwSerial == serModeSoftware)
@@ -115,34 +117,18 @@ SerialPM::STATUS SerialPM::trigRead()
     {
         uart->read(); // empty the RX buffer
     }
+    frame.reset();
+    last_result = PlantowerFrameParser::NEED_MORE;
+    nbytes = 0;
     uart->write(trg, msgLen); // passive mode read
     uart->flush();
+    trigger_ms = millis();
+}
 
-    // wait for the mesage header
-    const size_t headLen = 4;     // message header length
-    uint32_t start_ms = millis(); // start waiting time
-    do
-    {                                  // ~650ms to complete a measurements
-        delay(10);                     // wait up to max_wait_ms
-        wait_ms = millis() - start_ms; // time waited so far
-    } while (size_t(uart->available()) < headLen && wait_ms < max_wait_ms);
-
-    // we should an answer/message after 650ms
-    if (!uart->available())
-        return ERROR_TIMEOUT;
-
-    // read message header
-    nbytes = uart->readBytes(&buffer[0], headLen);
-    if (nbytes != headLen)
-        return ERROR_MSG_HEADER;
-
-    // message header starts with 'BM'
-    if (buff2word(0) != 0x424D)
-        return ERROR_MSG_START;
-
-    // check message length against stated sensor type
-    size_t bodyLen = buff2word(2);         // message body length
-    size_t messageLen = headLen + bodyLen; // full message length
+// validate a complete message from the parser and copy it to the buffer
+SerialPM::STATUS SerialPM::checkFrame()
+{
+    size_t messageLen = frame.length(); // full message length
     PMS sensor;
     switch (messageLen)
     {
@@ -169,26 +155,87 @@ SerialPM::STATUS SerialPM::trigRead()
     if (messageLen > BUFFER_LEN)
         return ERROR_MSG_LENGTH;
 
-    // wait for the message body
+    memcpy(buffer, frame.frame(), messageLen);
+    nbytes = messageLen;
+    return OK;
+}
+
+SerialPM::STATUS SerialPM::trigRead()
+{
+    sendTrigger();
+
+    // ~650ms to complete a measurements; bytes are decoded as they arrive
     do
-    {                                  // ~650ms to complete a measurements
-        delay(10);                     // wait up to max_wait_ms
-        wait_ms = millis() - start_ms; // time waited so far
-    } while (size_t(uart->available()) < bodyLen && wait_ms < max_wait_ms);
+    {
+        while (uart->available())
+        {
+            if (nbytes < 0xFF)
+                nbytes++; // bytes seen, for the timeout/diagnostics only
+            last_result = frame.feed(uart->read());
+            if (last_result == PlantowerFrameParser::FRAME_READY)
+                return checkFrame();
+        }
+        yield();
+        wait_ms = millis() - trigger_ms; // time waited so far
+    } while (wait_ms < max_wait_ms);
 
     // we should an answer/message after 650ms
-    if (!uart->available())
+    return incompleteStatus();
+}
+
+// why the last request did not produce a message
+SerialPM::STATUS SerialPM::incompleteStatus()
+{
+    if (nbytes == 0)
         return ERROR_TIMEOUT;
+    if (last_result == PlantowerFrameParser::ERROR_CKSUM)
+        return ERROR_MSG_CKSUM;
+    if (last_result == PlantowerFrameParser::ERROR_LENGTH)
+        return ERROR_MSG_UNKNOWN;
+    if (!frame.in_sync())
+        return ERROR_MSG_START;
+    return ERROR_MSG_BODY;
+}
 
-    // read message body
-    nbytes += uart->readBytes(&buffer[headLen], bodyLen);
-    if (nbytes != messageLen)
-        return ERROR_MSG_BODY;
+SerialPM::STATUS SerialPM::expire()
+{
+    pending = false;
+    wait_ms = millis() - trigger_ms;
+    status = incompleteStatus();
+    return status;
+}
 
-    if (!checkBuffer(messageLen))
-        return ERROR_MSG_CKSUM;
+void SerialPM::trigger(bool tsi_mode, bool truncated_num)
+{
+    decode_tsi = tsi_mode;
+    decode_truncated = truncated_num;
+    sendTrigger();
+    pending = true;
+}
 
-    return OK;
+bool SerialPM::feed(uint8_t c)
+{
+    if (nbytes < 0xFF)
+        nbytes++;
+    last_result = frame.feed(c);
+    if (last_result != PlantowerFrameParser::FRAME_READY)
+        return false;
+
+    pending = false;
+    wait_ms = millis() - trigger_ms;
+    status = checkFrame();
+    decodeBuffer(decode_tsi, decode_truncated); // decode message only if buffer checks out
+    return true;
+}
+
+bool SerialPM::poll()
+{
+    while (uart->available())
+    {
+        if (feed(uart->read()))
+            return true;
+    }
+    return false;
 }
 
 bool SerialPM::checkBuffer(size_t bufferLen)
@@ -10,6 +10,7 @@
 #define _SERIALPM_H
 
 #include <Arduino.h>
+#include "PMframe.h"
 
 #define HAS_HW_SERIAL
 #ifdef HAS_HW_SERIAL
@@ -141,9 +142,24 @@ public:
 
     STATUS status;
     STATUS read(bool tsi_mode = false, bool truncated_num = false);
+
+    // non-blocking passive read: trigger() sends the read request,
+    // then call poll() (or feed() from a UART event queue/ISR) until it returns true;
+    // status and the pm/nc/extra values are updated when it does
+    void trigger(bool tsi_mode = false, bool truncated_num = false);
+    bool poll();
+    bool feed(uint8_t c);
+    inline bool waiting() { return pending; }
+    // time since trigger(), for the caller's own timeout
+    inline uint32_t waiting_ms() { return millis() - trigger_ms; }
+    // give up on a pending trigger(); status tells why no message came in
+    STATUS expire();
+    inline const PlantowerFrameParser &parser() { return frame; }
     operator bool() { return status == OK; }
-    void sleep();
-    void wake();
+    // wait=false sends the command and returns; the caller must allow
+    // max_wait_ms*2 before talking to the sensor again (see acquisition loop)
+    void sleep(bool wait = true);
+    void wake(bool wait = true);
     inline bool has_particulate_matter() { return status == OK; }
     inline bool has_number_concentration() { return (status == OK) && (pms != PMS3003); }
     inline bool has_temperature_humidity() { return (status == OK) && ((pms == PMS5003T) || (pms == PMS5003ST)); }
@@ -198,9 +214,19 @@ protected:
 
     // utility functions
     STATUS trigRead();
+    void sendTrigger();
+    STATUS checkFrame();
+    STATUS incompleteStatus();
     bool checkBuffer(size_t bufferLen);
     void decodeBuffer(bool tsi_mode, bool truncated_num);
 
+    // incremental message decoding
+    PlantowerFrameParser frame;
+    PlantowerFrameParser::RESULT last_result = PlantowerFrameParser::NEED_MORE;
+    bool pending = false;
+    bool decode_tsi = false, decode_truncated = false;
+    uint32_t trigger_ms = 0;
+
     // message timing
     static const uint16_t max_wait_ms = 1000;
     uint16_t wait_ms; // time spent waiting for new sample
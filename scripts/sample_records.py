@@ -0,0 +1,153 @@
+"""Convert CBOR sample records (src/utils/sample_record.h) back to the JSON push payloads.
+
+Reads a record file such as failed_send_records.cbor from the SD card, or a single application/cbor request body,
+and prints one JSON payload per line, as generateJSON_payload() writes them to failed_send_payloads.txt.
+
+    python scripts/sample_records.py failed_send_records.cbor > failed_send_payloads.txt
+"""
+
+import argparse
+import datetime
+import json
+import struct
+import sys
+
+SOFTWARE_VERSION = "NRZ-2020-129"
+
+# Schema version 1: X-Pin -> (sensor_type, [(value_type, decimals), ...]) in SENSOR_REGISTRY order
+SCHEMA_V1 = {
+    1: ("PMS", [("P0", 0), ("P1", 0), ("P2", 0)]),
+    7: ("DHT", [("temperature", 1), ("humidity", 1)]),
+}
+SCHEMAS = {1: SCHEMA_V1}
+
+
+class RecordError(ValueError):
+    pass
+
+
+def read_item(data, pos):
+    """Decode the CBOR item at pos. Returns (value, next position)."""
+    if pos >= len(data):
+        raise RecordError("truncated record")
+    initial = data[pos]
+    major, info = initial >> 5, initial & 0x1F
+    pos += 1
+
+    if major == 7:
+        if initial == 0xF6:
+            return None, pos
+        if initial == 0xFA:
+            if pos + 4 > len(data):
+                raise RecordError("truncated float")
+            return struct.unpack(">f", data[pos:pos + 4])[0], pos + 4
+        raise RecordError(f"unsupported simple value 0x{initial:02x}")
+
+    if info < 24:
+        arg = info
+    elif info in (24, 25, 26, 27):
+        n = 1 << (info - 24)
+        if pos + n > len(data):
+            raise RecordError("truncated integer")
+        arg = int.from_bytes(data[pos:pos + n], "big")
+        pos += n
+    else:
+        raise RecordError(f"unsupported additional info {info}")
+
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major == 4:
+        items = []
+        for _ in range(arg):
+            item, pos = read_item(data, pos)
+            items.append(item)
+        return items, pos
+    raise RecordError(f"unsupported major type {major}")
+
+
+def format_timestamp(epoch, tz_offset_min):
+    """formatISO8601(): local time, '+HH' for whole hours, '+HH:MM' otherwise, no suffix if the offset is unknown."""
+    offset = tz_offset_min or 0
+    local = datetime.datetime(1970, 1, 1) + datetime.timedelta(seconds=epoch + offset * 60)
+    text = local.strftime("%Y-%m-%dT%H:%M:%S")
+    if tz_offset_min is None:
+        return text
+    sign = "-" if tz_offset_min < 0 else "+"
+    hours, minutes = divmod(abs(tz_offset_min), 60)
+    return f"{text}{sign}{hours:02d}" + (f":{minutes:02d}" if minutes else "")
+
+
+def format_value(value, decimals):
+    """formatJsonFixed(): the registry's decimals, ties to even; NaN/inf as null."""
+    if value != value or value in (float("inf"), float("-inf")):
+        return "null"
+    return "%.*f" % (decimals, value)
+
+
+def to_payload(record):
+    if not isinstance(record, list) or len(record) != 5:
+        raise RecordError("not a sample record")
+    version, api_pin, epoch, tz_offset_min, values = record
+    schema = SCHEMAS.get(version)
+    if schema is None:
+        raise RecordError(f"unknown schema version {version}")
+    if api_pin not in schema:
+        raise RecordError(f"unknown X-Pin {api_pin}")
+    sensor_type, value_types = schema[api_pin]
+    if not isinstance(values, list) or len(values) != len(value_types):
+        raise RecordError(f"expected {len(value_types)} values for X-Pin {api_pin}")
+
+    # Written as text: the values keep their fixed number of decimals, as renderPayload() writes them
+    def string(s):
+        return json.dumps(s, ensure_ascii=False)
+
+    values_json = ",".join(
+        '{"value_type":%s,"value":%s}' % (string(value_type), format_value(value, decimals))
+        for (value_type, decimals), value in zip(value_types, values)
+    )
+    return '{"software_version":%s,"timestamp":%s,"sensordatavalues":[%s],"sensor_type":%s,"API_PIN":%d}' % (
+        string(SOFTWARE_VERSION),
+        string(format_timestamp(epoch, tz_offset_min)),
+        values_json,
+        string(sensor_type),
+        api_pin,
+    )
+
+
+def convert(data, out, err):
+    """Print the payload of every record in a CBOR sequence. Returns the number of records that were skipped."""
+    pos = skipped = 0
+    while pos < len(data):
+        try:
+            record, end = read_item(data, pos)
+            payload = to_payload(record)
+        except RecordError as e:
+            # same recovery as readSendDeleteRecords(): resynchronise on the next byte
+            err.write(f"offset {pos}: {e}, skipping a byte\n")
+            pos += 1
+            skipped += 1
+            continue
+        out.write(payload + "\n")
+        pos = end
+    return skipped
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="record file, stdin if omitted")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    skipped = convert(data, sys.stdout, sys.stderr)
+    sys.exit(1 if skipped else 0)
+
+
+if __name__ == "__main__":
+    main()
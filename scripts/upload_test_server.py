@@ -0,0 +1,203 @@
+"""Stand-in for the sensors.AFRICA push endpoint to check upload bodies and measure what compression saves.
+
+Server: accepts POSTs on any path, decodes Content-Encoding: gzip, checks that the body is JSON (or CBOR sample
+records for application/cbor) and answers 201, or 400 with the reason. Bytes on the wire and decoded bytes are
+printed per request and in total. Point stagingUrl at it and set "stagingGzip": true in /config.json.
+A JSON array body is a batch ("batchUpload": true); --reject-batches answers those with 400, as an endpoint that
+takes single payloads only, to check the device's fallback to single-record posts.
+
+    python scripts/upload_test_server.py serve --port 8080
+
+Replay: posts the payload lines of a backlog file (failed_send_payloads.txt) to a server, optionally gzipped with
+the device's 1 KB deflate window and batched as JSON arrays, to measure the saving and the throughput on a
+realistic backlog. Rejected batches are re-sent one payload per request, as sendBatch() does. With the server started
+with --delay 1 (about a GPRS round trip per request) the payloads/s line shows what batching saves on the device.
+
+    python scripts/upload_test_server.py replay failed_send_payloads.txt --url http://localhost:8080/v1/push-sensor-data/ --gzip --batch 10
+"""
+
+import argparse
+import gzip
+import http.server
+import json
+import sys
+import time
+import urllib.error
+import urllib.request
+import zlib
+
+import sample_records
+
+DEVICE_WINDOW_BITS = 10  # GZIP_WINDOW in src/utils/gzip.h
+GZIP_MIN_BODY_BYTES = 128  # src/global_configs.h
+BATCH_REJECTIONS = (400, 404, 405, 411, 413, 415, 422)  # isBatchRejection() in src/main.cpp
+
+
+class Totals:
+    requests = 0
+    records = 0
+    failed = 0
+    wire_bytes = 0
+    body_bytes = 0
+
+    @classmethod
+    def line(cls):
+        saved = 100.0 * (1 - cls.wire_bytes / cls.body_bytes) if cls.body_bytes else 0.0
+        return (f"total: {cls.requests} requests ({cls.failed} rejected), {cls.records} records, {cls.wire_bytes} bytes on the wire, "
+                f"{cls.body_bytes} decoded, {saved:.1f}% saved")
+
+
+def check_body(body, content_type, reject_batches=False):
+    """Raise ValueError if the decoded body is not what the content type announces. Returns the number of records."""
+    if content_type.startswith("application/cbor"):
+        class Sink:
+            def __init__(self):
+                self.lines = 0
+
+            def write(self, _):
+                self.lines += 1
+        out = Sink()
+        if sample_records.convert(body, out, Sink()):
+            raise ValueError("invalid CBOR sample record")
+        return out.lines
+    payload = json.loads(body.decode("utf-8"))
+    if not isinstance(payload, list):
+        return 1
+    if reject_batches:
+        raise ValueError("batches are not accepted")
+    if not payload or not all(isinstance(p, dict) and "API_PIN" in p for p in payload):
+        raise ValueError("a batch is a non-empty array of payloads with API_PIN")
+    return len(payload)
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    def do_POST(self):
+        wire = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        encoding = self.headers.get("Content-Encoding", "identity")
+        content_type = self.headers.get("Content-Type", "")
+        try:
+            if encoding == "gzip":
+                body = gzip.decompress(wire)  # verifies CRC-32 and length
+            elif encoding == "identity":
+                body = wire
+            else:
+                raise ValueError(f"unsupported Content-Encoding {encoding}")
+            records = check_body(body, content_type, self.server.reject_batches)
+        except (ValueError, OSError, EOFError, zlib.error) as e:
+            Totals.requests += 1
+            Totals.failed += 1
+            self.reply(400, str(e))
+            print(f"{self.path} X-PIN {self.headers.get('X-PIN')}: rejected, {e}", flush=True)
+            return
+
+        Totals.requests += 1
+        Totals.records += records
+        Totals.wire_bytes += len(wire)
+        Totals.body_bytes += len(body)
+        print(f"{self.path} X-PIN {self.headers.get('X-PIN')} {content_type} {encoding}: {records} records, "
+              f"{len(wire)} -> {len(body)} bytes | {Totals.line()}", flush=True)
+        self.reply(201, "created")
+
+    def reply(self, status, text):
+        time.sleep(self.server.delay)
+        data = text.encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, format, *args):
+        pass
+
+
+def serve(args):
+    server = http.server.ThreadingHTTPServer((args.host, args.port), Handler)
+    server.reject_batches = args.reject_batches
+    server.delay = args.delay
+    print(f"listening on {args.host}:{args.port}", flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print(Totals.line())
+
+
+def device_gzip(data):
+    """gzip with the device's window size (the device's match search is simpler, so it compresses a little less)."""
+    compressor = zlib.compressobj(9, zlib.DEFLATED, 16 + DEVICE_WINDOW_BITS)
+    return compressor.compress(data) + compressor.flush()
+
+
+def replay(args):
+    with open(args.file, encoding="utf-8") as f:
+        payloads = [line.strip() for line in f if line.strip()]
+
+    totals = {"raw": 0, "wire": 0, "requests": 0, "failed": 0}
+    batches = args.batch > 1
+
+    def post(body, pin):
+        """Post one body; returns the HTTP status (0 if only measured)."""
+        headers = {"Content-Type": "application/json", "X-PIN": str(pin)}
+        wire = body
+        if args.gzip and len(body) >= GZIP_MIN_BODY_BYTES:
+            wire = device_gzip(body)
+            headers["Content-Encoding"] = "gzip"
+        totals["raw"] += len(body)
+        totals["wire"] += len(wire)
+        totals["requests"] += 1
+        if not args.url:
+            return 0
+        request = urllib.request.Request(args.url, data=wire, headers=headers, method="POST")
+        try:
+            with urllib.request.urlopen(request) as response:
+                response.read()
+                return response.status
+        except urllib.error.HTTPError as e:
+            return e.code
+
+    start = time.monotonic()
+    for i in range(0, len(payloads), args.batch):
+        chunk = payloads[i:i + args.batch]
+        if batches and len(chunk) > 1:
+            status = post(("[" + ",".join(chunk) + "]").encode(), 0)  # X-PIN: 0, each payload has its API_PIN
+            if status not in BATCH_REJECTIONS:
+                totals["failed"] += len(chunk) if status >= 300 else 0
+                continue
+            print(f"batch rejected with HTTP {status}, sending payloads one by one")
+            batches = False
+        for payload in chunk:
+            if post(payload.encode(), json.loads(payload).get("API_PIN", "")) >= 300:
+                totals["failed"] += 1
+    elapsed = time.monotonic() - start
+
+    saved = 100.0 * (1 - totals["wire"] / totals["raw"]) if totals["raw"] else 0.0
+    print(f"{len(payloads)} payloads in bodies of {args.batch}: {totals['requests']} requests, "
+          f"{totals['raw']} -> {totals['wire']} bytes, {saved:.1f}% saved, {totals['failed']} payloads failed")
+    if args.url:
+        print(f"{elapsed:.2f} s, {len(payloads) / elapsed:.1f} payloads/s")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    serve_parser = commands.add_parser("serve", help="run the stand-in endpoint")
+    serve_parser.add_argument("--host", default="0.0.0.0")
+    serve_parser.add_argument("--port", type=int, default=8080)
+    serve_parser.add_argument("--reject-batches", action="store_true", help="answer JSON array bodies with 400")
+    serve_parser.add_argument("--delay", type=float, default=0.0, help="seconds to wait before each answer")
+    serve_parser.set_defaults(run=serve)
+
+    replay_parser = commands.add_parser("replay", help="post or measure a backlog file")
+    replay_parser.add_argument("file", help="JSON payload lines, e.g. failed_send_payloads.txt")
+    replay_parser.add_argument("--url", help="endpoint to post to; only measured if omitted")
+    replay_parser.add_argument("--gzip", action="store_true", help="gzip the bodies")
+    replay_parser.add_argument("--batch", type=int, default=1, help="payloads per body, sent as a JSON array")
+    replay_parser.set_defaults(run=replay)
+
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
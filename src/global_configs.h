@@ -26,9 +26,81 @@ enum CommunicationPriority
 
 #define QUECTEL EC200CN
 
+#define SOFTWARE_VERSION "NRZ-2020-129" // software_version of the push payloads
+
 #define PMS_API_PIN 1
 #define DHT_API_PIN 7
 
+// SENSOR ACQUISITION
+// The PMS is read once consecutive warm-up frames agree, bounded by MIN/MAX.
+// Set PMS_WARMUP_MIN_MS equal to PMS_WARMUP_MAX_MS for a fixed warm-up.
+#define PMS_WARMUP_MIN_MS 10000             // fan run time before a reading may be taken
+#define PMS_WARMUP_MAX_MS 30000             // fan run time after which a reading is taken regardless
+#define PMS_STABLE_FRAMES 3                 // consecutive frames within tolerance to declare the reading stable
+#define PMS_STABLE_TOLERANCE_PCT 10         // allowed change between consecutive frames [%]
+#define PMS_STABLE_TOLERANCE_UGM3 2         // allowed change at low concentrations [ug/m3]
+#define PMS_STABILITY_READ_INTERVAL_MS 1000 // passive read interval during warm-up
+#define PMS_READ_TIMEOUT_MS 1000            // give up on a passive read after this long
+#define PMS_BURST_FRAMES 5                  // frames per reading, summarised as median/mean/min/max
+#define PMS_CMD_SETTLE_MS 2000              // time the PMS needs after a wake/sleep command
+#define DHT_EDGE_CAPTURE true               // read the DHT from edge timestamps, interrupts stay enabled; false = legacy bit-bang
+#define DHT_READ_ATTEMPTS 3                 // DHT reads per cycle before the DHT values of the sample are dropped
+#define DHT_READ_RETRY_MS 2000              // time between DHT attempts, at least the DHT22 minimum read interval
+#define PMS_BURST_ATTEMPTS 2                // burst windows per cycle when no PMS frame came in; the fan stays on
+
+// SAMPLING TASK
+// The sensors are read in their own FreeRTOS task; finished cycles reach loop(), which logs and sends them, through a
+// lock-free queue (src/utils/spsc_queue.h), so a slow upload does not hold up sampling.
+#define SAMPLING_TASK_CORE 0        // loop() runs on core 1
+#define SAMPLING_TASK_PRIORITY 2
+#define SAMPLING_TASK_STACK 8192
+#define SAMPLING_TASK_PERIOD_MS 10  // acquisition step interval
+#define SAMPLE_QUEUE_DEPTH 8        // cycles loop() may fall behind; a power of two
+#define SAMPLE_QUEUE_POLICY 2       // queue full: 0 = block sampling, 1 = drop the oldest cycle, 2 = spill to the SD card
+#define SAMPLE_SPILL_PATH "/spilled_samples.cbor"
+
+// ADAPTIVE SAMPLING (defaults, overridable in /config.json)
+// The interval between acquisition cycles follows the PM2.5 rate of change between readings.
+#define ADAPTIVE_SAMPLING true                // false = fixed SAMPLING_INTERVAL_DEFAULT_MS
+#define SAMPLING_INTERVAL_DEFAULT_MS 300000UL // 5 minutes
+#define SAMPLING_INTERVAL_MIN_MS 60000UL      // during pollution events; raised to SAMPLING_CYCLE_MAX_MS if below
+#define SAMPLING_INTERVAL_MAX_MS 1800000UL    // on stable days
+#define PM25_FAST_RATE_UGM3_PER_MIN 2.0f      // at or above: sample at the minimum interval
+#define PM25_STABLE_RATE_UGM3_PER_MIN 0.1f    // at or below: double the interval
+#define PM25_THRESHOLDS_UGM3 {15, 35, 55, 150} // crossing any of these samples at the minimum interval
+#define PM25_DEADBAND_UGM3 1                  // changes up to this are PMS jitter: no change, no threshold crossing
+#define SAMPLING_CONFIRM_CYCLES 2             // consecutive stable (or drifting) readings before the interval doubles (halves)
+// Longest acquisition cycle: full warm-up, every burst window, sleep settle
+#define SAMPLING_CYCLE_MAX_MS (PMS_WARMUP_MAX_MS + PMS_BURST_ATTEMPTS * (PMS_BURST_FRAMES * PMS_STABILITY_READ_INTERVAL_MS + PMS_READ_TIMEOUT_MS) + PMS_CMD_SETTLE_MS)
+
+// PAYLOAD ENCODING (defaults, overridable in /config.json)
+// Compact CBOR sample records, see src/utils/sample_record.h and scripts/sample_records.py
+#define BINARY_BACKLOG false // store payloads that failed to send as CBOR records instead of JSON lines
+#define CBOR_UPLINK false    // POST application/cbor records instead of JSON; the endpoint must accept them
+// Gzip request bodies (Content-Encoding: gzip), per endpoint; only for servers that decode them
+#define STAGING_GZIP false
+#define PRODUCTION_GZIP false
+#define GZIP_MIN_BODY_BYTES 128  // smaller bodies are sent as they are
+#define GZIP_BODY_MAX_BYTES 4096 // compressed body buffer; larger results are sent uncompressed
+// Batch upload: several JSON payloads per request body as a JSON array; only for servers that accept arrays,
+// single-record posts are used again for an endpoint that rejects a batch, see src/utils/upload_batch.h
+#define BATCH_UPLOAD false
+#define BATCH_MAX_RECORDS 10          // payloads per body, at most UPLOAD_BATCH_MAX_RECORDS
+#define BATCH_MAX_BYTES 2048          // body length limit, at most BATCH_BODY_BUFFER_BYTES - 1
+#define BATCH_BODY_BUFFER_BYTES 4096
+// Fan-out: send every payload to both productionUrl and stagingUrl, each with its own retry stores
+#define FAN_OUT false
+// Offline queue: sample records kept in PSRAM while no link is up, see src/utils/offline_queue.h
+#define PSRAM_QUEUE_BYTES (1024 * 1024UL)             // 0 = off
+#define PSRAM_QUEUE_FLUSH_MS (24 * 60 * 60 * 1000UL) // what a reset can lose at most; 0 = only when the queue is full
+// Queue checkpoint: the JSON memory logger survives restarts in RTC memory and a LittleFS file, see
+// src/utils/queue_checkpoint.h
+#define QUEUE_CHECKPOINT_PATH "/queue_checkpoint.bin"
+#define QUEUE_CHECKPOINT_FLASH_MS (60 * 60 * 1000UL) // LittleFS copy while records change; 0 = only before restarts
+// Aggregation: upload count/mean/min/max/p95 per window instead of every reading, see src/utils/aggregation.h
+#define AGGREGATION_MODE 0        // 0 = off, 1 = always, 2 = only while the uplink is GSM
+#define AGGREGATION_WINDOW_S 3600 // 3600 hourly, 86400 daily
+
 // PIN DEFINITIONS
 #define MCU_RXD 17
 #define MCU_TXD 18
@@ -64,4 +136,5 @@ static int SD_CS = 39;
 #define MQTT_PASSWORD "" // set to enable MQTT authentication
 #define MQTT_CLIENT_ID 5
 #define MQTT_SUBSCRIBE_TOPIC "devices/nodes/configuration"
+#define MQTT_TELEMETRY_MAX_BYTES 4096 // telemetry JSON buffer; a typical payload is about 1.8 KB
 #endif
\ No newline at end of file
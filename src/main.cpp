@@ -59,6 +59,25 @@
 #include "webserver/asyncserver.h"
 #include "utils/mqtt_wifi.h"
 #include "utils/mozilla_ca_bundle.h"
+#include "utils/acquisition.h"
+#include "utils/pms_burst.h"
+#include "utils/datetime.h"
+#include "utils/sensor_registry.h"
+#include "utils/sensor_sample.h"
+#include "utils/adaptive_sampling.h"
+#include "utils/sensor_retry.h"
+#include "utils/payload_template.h"
+#include "utils/csv_writer.h"
+#include "utils/sample_record.h"
+#include "utils/gzip.h"
+#include "utils/upload_batch.h"
+#include "utils/upload_target.h"
+#include "utils/aggregation.h"
+#include "utils/log_arena.h"
+#include "utils/offline_queue.h"
+#include "utils/queue_checkpoint.h"
+#include "utils/sample_queue.h"
+#include <atomic>
 
 size_t max_wifi_hotspots_size = sizeof(struct_wifiInfo) * 20;
 struct struct_wifiInfo *wifiInfo = (struct_wifiInfo *)malloc(max_wifi_hotspots_size);
@@ -72,8 +91,9 @@ const unsigned long DURATION_BEFORE_FORCED_RESTART_MS = ONE_DAY_IN_MS * 28; // f
 const unsigned long SEND_TELEMETRY_INTERVAL_MS = 30 * 60 * 1000;            // 30 minutes
 
 unsigned long act_milli;
-unsigned long last_read_sensors_data = 0;
-int sampling_interval = 5 * 60 * 1000; // 5 minutes
+// shared by the sampling task and loop()
+std::atomic<unsigned long> last_read_sensors_data{0};
+std::atomic<unsigned long> sampling_interval{SAMPLING_INTERVAL_DEFAULT_MS}; // adapted by SamplingScheduler
 unsigned long starttime, boottime = 0;
 unsigned sending_intervall_ms = 30 * 60 * 1000; // 30 minutes
 unsigned long count_sends = 0;
@@ -92,30 +112,35 @@ char CURRENT_SENSORS_DATA_DIR[128] = {};
 char SENSORS_JSON_DATA_PATH[128] = {};
 char SENSORS_CSV_DATA_PATH[128] = {};
 char SENSORS_FAILED_DATA_SEND_STORE_FILE[40] = "failed_send_payloads.txt";
-char SENSORS_FAILED_DATA_SEND_STORE_PATH[128] = {};
+char SENSORS_FAILED_RECORDS_STORE_FILE[40] = "failed_send_records.cbor";
 char MQTT_TELEMETRY_TOPIC[128] = {};
 
 char esp_chipid[18] = {};
-bool send_now = false;
+GzipEncoder GzipBody;
+uint8_t gzip_body[GZIP_BODY_MAX_BYTES];
+size_t gzip_body_length = 0;   // 0 if the source did not compress
+size_t gzip_source_length = 0; // body gzip_body was compressed from, 0 = none
+uint32_t gzip_source_crc = 0;
+char batch_body[BATCH_BODY_BUFFER_BYTES];
+int LastHTTPStatus = 0; // status of the last response sendData() got, 0 if none
+UploadTarget UploadTargets[UPLOAD_TARGET_COUNT] = {{"staging", DeviceConfig.staging_url},
+                                                   {"production", DeviceConfig.production_url}};
+SampleAggregator Aggregator;
+char aggregate_body[AGGREGATE_PAYLOAD_MAX_BYTES];
+char telemetry_payload[MQTT_TELEMETRY_MAX_BYTES]; // telemetry JSON, too large for the loop() stack
+bool aggregates_due = false; // an aggregation window closed; sent with the next pass, without holding up sampling
+std::atomic<bool> send_now{false}; // read by the sampling task in power saving mode
 char incoming_topic_store[64];
 char incoming_message_store[256];
 
 ESP32Time RTC;
 char time_buff[32] = {};
-const char *ISO_time_format = "%Y-%m-%dT%H:%M:%S"; // ISO 8601 format
 struct datetimetz
 {
-    tmElements_t datetime;
-    time_t timestamp;
-    char timezone[6] = {}; // e.g. +0300 // +03
+    time_t timestamp; // local wall clock seconds, as the RTC is set
+    int16_t tz_offset_min = TZ_OFFSET_UNKNOWN; // e.g. 180 for +03; unknown when the clock was set over NTP
 } esp_datetime_tz;
 
-enum SensorAPI_PIN
-{
-    PMS = PMS_API_PIN,
-    DHT = DHT_API_PIN
-};
-
 enum DATA_LOGGERS
 {
     JSON,
@@ -127,11 +152,15 @@ struct LOGGER
     const char *name;
     char *path;
     DATA_LOGGERS type;
-    static const int MAX_ENTRIES = 48;
-    static const int ENTRY_SIZE = 255;
-    char DATA_STORE[MAX_ENTRIES][ENTRY_SIZE] = {};
-    int log_count = 0;
+    static const int MAX_ENTRIES = 96;  // sample records held
+    static const int ENTRY_SIZE = 255;  // longest JSON payload or CSV rows rendered from a record
+    static const size_t STORE_BYTES = MAX_ENTRIES * (sizeof(SampleRecord) + LogRing::RECORD_OVERHEAD);
+    LogArena<STORE_BYTES, MAX_ENTRIES> DATA_STORE; // SampleRecord bytes, rendered when sent or written to the SD card
 } JSON_PAYLOAD_LOGGER, CSV_PAYLOAD_LOGGER;
+struct OfflineQueue OfflineQueue; // sample records the memory logger had no room for while offline
+RTC_NOINIT_ATTR QueueImage<LOGGER::MAX_ENTRIES> PendingQueueImage; // JSON_PAYLOAD_LOGGER across restarts
+struct QueueCheckpointState QueueCheckpointState;
+
 
 struct GSMRuntimeInfo GSMRuntimeInfo;
 JsonDocument gsm_info;
@@ -190,25 +219,93 @@ struct CommsManagerState
     }
 } CommsManagerState;
 
-void readDHT();
-void getPMSREADINGS();
-void printPM_values();
+struct AcquisitionState AcquisitionState;
+PMBurstAccumulator<PMS_BURST_FRAMES> PMSBurst; // frames of the current reading
+struct SensorSample PendingSample;             // PMS + DHT readings of the current cycle
+struct AdaptiveSampler SamplingScheduler;                // owned by the sampling task
+std::atomic<bool> sampling_config_changed{false};        // DeviceConfig reloaded: the sampling task applies it
+SpscQueue<QueuedSample, SAMPLE_QUEUE_DEPTH> SampleQueue; // finished cycles, sampling task -> loop()
+struct SampleQueueState SampleQueueState;
+SemaphoreHandle_t SpillLock = nullptr; // SAMPLE_SPILL_PATH between the sampling task and loop()
+
+static_assert(DHT_READ_RETRY_MS >= 2000, "the DHT22 needs 2 s between reads");
+RetryPolicy DHTRetry(DHT_READ_ATTEMPTS, DHT_READ_RETRY_MS);
+RetryPolicy PMSRetry(PMS_BURST_ATTEMPTS, 0); // a new burst window starts right after an empty one
+SensorErrorCounters<10> DHTErrors;           // index = -DHTLIB status code, 9 = other
+SensorErrorCounters<9> PMSErrors;            // index = SerialPM::STATUS
+
+/// @brief State the sampling task owns and telemetry reports, copied by publishSamplingState() under SamplingLock
+struct SamplingTelemetry
+{
+    struct AdaptiveSampler scheduler;
+    struct AcquisitionState acquisition;
+    SensorErrorCounters<10> dht;
+    SensorErrorCounters<9> pms;
+    uint32_t parserCksumErrors = 0;
+    uint32_t parserLengthErrors = 0;
+    uint32_t queueBlocked = 0; // SampleQueueState counters written by the sampling task
+    uint32_t queueDropped = 0;
+    uint32_t queueSpilled = 0;
+} SamplingSnapshot;
+SemaphoreHandle_t SamplingLock = nullptr;
+
+// RTC epoch and esp_datetime_tz offset are set together under TimeLock, so a timestamp never mixes old and new
+SemaphoreHandle_t TimeLock = nullptr;
+
+bool readDHT(SensorSample &sample);
+bool getPMSREADINGS(SensorSample &sample);
+void logSensorSample(const SensorSample &sample, const PMBurstSummary &burst);
+void samplingTask(void *);
+void queueSample(const SensorSample &sample);
+bool spillSample(const SensorSample &sample);
+void drainSampleQueue();
+void ingestSpilledSamples();
+void publishSamplingState();
+void applySamplingConfig();
+void updateSamplingInterval(const SensorSample &sample);
+void printPM_values(const uint16_t pm[3]);
 void printPM_Error();
-void generateJSON_payload(char *res, JsonDocument &data, const char *timestamp, SensorAPI_PIN pin, size_t size);
+void readDHTWithRetry(unsigned long now);
+void addSensorErrorTelemetry(JsonObject errors, const SamplingTelemetry &sampling);
+bool generateJSON_payload(char *res, uint8_t sensor, const float *values, const char *timestamp, size_t size);
+bool generateCSV_row(CsvWriter &csv, const char *timestamp, const SensorDescriptor &sensor, uint8_t index, float value);
 bool sendData(const char *data, const int _pin, const char *url);
-datetimetz extractDateTime(String datetimeStr);
-String formatDateTime(time_t t, String timezone);
-String getRTCdatetimetz(const char *format, char *timezone);
+bool sendData(const char *data, size_t data_length, const char *content_type, const int _pin, const char *url);
+datetimetz extractDateTime(const char *datetimeStr);
+Timestamp captureTimestamp();
 void init_memory_loggers();
 void init_SD_loggers();
 void getMonthName(int month_num, char *month);
-void readSendDelete(const char *datafile);
+void readSendDelete(UploadTarget &target);
+void readSendDeleteRecords(UploadTarget &target);
+SampleRecord storedSample(const char *stored);
+size_t renderSamplePayload(char *buf, size_t size, const SampleRecord &record);
+bool renderSampleRows(char *buf, size_t size, const SampleRecord &record);
+void uploadSample(const char *stored, UploadTarget &target, UploadBatch &batch, bool batching);
+void storeFailedSample(UploadTarget &target, const char *retry_file, const SampleRecord &record);
+bool sendSampleRecord(const SampleRecord &record, const uint8_t *cbor, size_t cbor_length, const char *url);
+void storeFailedRecord(UploadTarget &target, const uint8_t *cbor, size_t cbor_length);
+void storeFailedPayload(UploadTarget &target, const char *retry_file, const char *payload, size_t length);
+void uploadBatched(UploadBatch &batch, const char *payload, uint8_t api_pin, UploadTarget &target, const char *retry_file,
+                   const char *source = nullptr);
+void sendBatch(UploadBatch &batch, UploadTarget &target, const char *retry_file);
+UploadTarget &uploadTargetFor(const char *url);
+uint8_t uploadTargets(UploadTarget *targets[UPLOAD_TARGET_COUNT]);
 void initCalender(int year, int month);
 void updateCalendarFromRTC();
-void memoryDataLog(LOGGER &logger, const char *data);
+void memoryDataLog(LOGGER &logger, const SampleRecord &record);
 void fileDataLog(LOGGER &logger);
 void resetLogger(LOGGER &logger);
 void sendFromMemoryLog(LOGGER &logger);
+void queueOffline(LOGGER &logger);
+void checkpointQueue(bool to_flash);
+void saveQueueCheckpoint();
+void restoreQueueCheckpoint();
+void restartDevice(const char *reason);
+void spillOfflineQueue();
+void sendOfflineQueue(UploadTarget *targets[], uint8_t target_count);
+bool aggregateUplink();
+void sendAggregates(UploadBatch &batch, UploadTarget &target);
 void captureGSMInfo();
 void captureWiFiInfo();
 void loadInitialConfigs();
@@ -231,6 +328,8 @@ void buildDeviceInfoJSON();
 void checkIncomingMQTTMessages();
 void wifiMQTTCallback(char *topic, byte *payload, unsigned int length);
 void processIncomingData();
+void startAcquisitionCycle(unsigned long now);
+void acquisitionManager();
 
 enum Month
 {
@@ -259,6 +358,8 @@ void setup()
     Serial.begin(115200);
     boottime = millis();
     DeviceConfigState.state = CONFIG_BOOT_INIT;
+    SamplingLock = xSemaphoreCreateMutex();
+    TimeLock = xSemaphoreCreateMutex();
 
     uint64_t chipid_num;
     chipid_num = ESP.getEfuseMac();
@@ -280,11 +381,14 @@ void setup()
     strcat(AP_SSID, esp_chipid);
 
     init_memory_loggers();
+    if (OfflineQueue.begin(PSRAM_QUEUE_BYTES))
+        Serial.printf("Offline queue: %u bytes in %s\n", (unsigned)OfflineQueue.records.capacity(), OfflineQueue.psram ? "PSRAM" : "heap");
     Serial.println("Initializing PMS5003 sensor");
     pms.init();
     delay(2000);
     pms.sleep();
     dht.setType(DHTTYPE);
+    dht.setEdgeCapture(DHT_EDGE_CAPTURE);
 
     loadInitialConfigs(); // from global config file after compilation
 
@@ -299,6 +403,8 @@ void setup()
         loadSavedDeviceConfigs(false);
         DeviceConfigState.configurationRequired = (!DeviceConfig.useGSM && !DeviceConfig.useWiFi);
     }
+    // before any sampling, the memory logger of the previous run
+    restoreQueueCheckpoint();
 
     // Device configuration
 
@@ -363,7 +469,14 @@ void setup()
         DeviceConfigState.sdCardInitialized = false;
     }
 
+    applySamplingConfig();
     buildDeviceInfoJSON();
+
+    // Sampling runs in its own task from here on, loop() logs and sends what it reads
+    SpillLock = xSemaphoreCreateMutex();
+    SampleQueueState.spillPending = SD_Attached && SD.exists(SAMPLE_SPILL_PATH); // left by the previous run
+    xTaskCreatePinnedToCore(samplingTask, "SamplingTask", SAMPLING_TASK_STACK, nullptr, SAMPLING_TASK_PRIORITY, nullptr,
+                            SAMPLING_TASK_CORE);
     starttime = millis();
 }
 
@@ -378,10 +491,10 @@ void loop()
     {
 
         loadSavedDeviceConfigs();
+        sampling_config_changed = true;
         if (DeviceConfigState.restartRequired)
         {
-            Serial.println("New config(s) requries a restart. Restarting...\n\n");
-            ESP.restart();
+            restartDevice("new config(s) require a restart");
         }
         DeviceConfigState.configurationRequired = false;
     }
@@ -390,35 +503,41 @@ void loop()
 
     act_milli = millis();
 
-    if (DeviceConfig.power_saving_mode)
+    // In power saving mode data is only sent after the memory logger is full, see memoryDataLog()
+    if (!DeviceConfig.power_saving_mode)
+        send_now = act_milli - starttime > sending_intervall_ms;
+
+    // Log the cycles the sampling task has finished since the last pass
+    drainSampleQueue();
+
+    // PSRAM does not survive a reset: payloads do not stay there longer than PSRAM_QUEUE_FLUSH_MS
+    if (OfflineQueue.flushDue(millis(), PSRAM_QUEUE_FLUSH_MS))
     {
-        if (act_milli - last_read_sensors_data > sampling_interval && !send_now) // only send data after the memory logger is full
-        {
-            getPMSREADINGS();
-            readDHT();
-            last_read_sensors_data = millis();
-        }
+        OfflineQueue.flushes++;
+        spillOfflineQueue();
     }
-    else
-    {
-        send_now = act_milli - starttime > sending_intervall_ms;
 
-        if (act_milli - last_read_sensors_data > sampling_interval)
-        {
-            getPMSREADINGS();
-            readDHT();
-            last_read_sensors_data = millis();
-        }
+    // RTC memory does not survive a power loss: the LittleFS copy of the memory logger is at most this old
+    if (QueueCheckpointState.flashStale && QUEUE_CHECKPOINT_FLASH_MS > 0 &&
+        millis() - QueueCheckpointState.flashSavedAt >= QUEUE_CHECKPOINT_FLASH_MS)
+    {
+        saveQueueCheckpoint();
     }
 
-    if (send_now && CommsManagerState.preferredComm != CommsManagerState.PreferredComm::NONE)
+    if ((send_now || aggregates_due) && CommsManagerState.preferredComm != CommsManagerState.PreferredComm::NONE)
     {
 
         init_SD_loggers(); // Refresh SD paths in case DeviceConfig.isLive changed at runtime.
         // Send data from memory loggers
         sendFromMemoryLog(JSON_PAYLOAD_LOGGER);
-        // send payloads from the files that stores data that failed posting previously
-        readSendDelete(SENSORS_FAILED_DATA_SEND_STORE_PATH);
+        // send payloads from the files that stores data that failed posting previously, per endpoint
+        UploadTarget *targets[UPLOAD_TARGET_COUNT];
+        uint8_t target_count = uploadTargets(targets);
+        for (uint8_t t = 0; t < target_count; t++)
+        {
+            readSendDelete(*targets[t]);
+            readSendDeleteRecords(*targets[t]);
+        }
 
         if (DeviceConfigState.gsmConnected && DeviceConfigState.gsmInternetAvailable)
         {
@@ -426,6 +545,10 @@ void loop()
         }
 
         starttime = millis();
+        aggregates_due = false;
+        // the memory logger has been sent: the sampling task takes the next reading again
+        if (DeviceConfig.power_saving_mode)
+            send_now = false;
     }
 
     if (DeviceConfigState.isMQTTConfigured && !CommsManagerState.allCommsUnavailable)
@@ -485,19 +608,405 @@ void loop()
 
     if (millis() - boottime > DURATION_BEFORE_FORCED_RESTART_MS)
     {
-        ESP.restart();
+        restartDevice("forced monthly restart");
     }
 }
 
-void readDHT()
+/**
+ * @brief Sensor acquisition manager - runs in the sampling task
+ * @details Drives AcquisitionState through IDLE -> WARMING -> READING -> SLEEPING. The PMS fan warm-up and the
+ *          wake/sleep settle times are waited out across passes of the task, one every SAMPLING_TASK_PERIOD_MS,
+ *          instead of with delay().
+ *          During warm-up the PMS is read in passive mode every PMS_STABILITY_READ_INTERVAL_MS; the reading is taken
+ *          as soon as consecutive frames agree (bounded by PMS_WARMUP_MIN_MS/PMS_WARMUP_MAX_MS). A burst of
+ *          PMS_BURST_FRAMES frames is then collected and summarised by PMSBurst, and the sensor is put back to sleep.
+ *          The DHT is read while the fan warms up; both readings are logged as one SensorSample stamped when the
+ *          PMS reading starts.
+ */
+void acquisitionManager()
 {
+    static unsigned long last_frame_request = 0;
+    unsigned long now = millis();
+    AcquisitionPhase previous = AcquisitionState.phase;
 
-    delay(2000);
-    char resultDHT[255] = {};
+    // Passive PMS reads while the fan is running (warm-up frames and the burst)
+    bool new_frame = false;
+    if ((previous == ACQ_WARMING && AcquisitionState.elapsed(now) >= AcquisitionState.settleMs) ||
+        (previous == ACQ_READING && !PMSBurst.full()))
+    {
+        if (pms.waiting() && pms.poll())
+        {
+            new_frame = pms;
+            PMSErrors.record(pms.status);
+            if (!new_frame)
+                printPM_Error();
+        }
+        else if ((!pms.waiting() || pms.waiting_ms() > PMS_READ_TIMEOUT_MS) &&
+                 now - last_frame_request >= PMS_STABILITY_READ_INTERVAL_MS)
+        {
+            if (pms.waiting())
+            {
+                PMSErrors.record(pms.expire());
+                printPM_Error();
+            }
+            pms.trigger();
+            last_frame_request = now;
+        }
+    }
+
+    switch (previous)
+    {
+    case ACQ_WARMING:
+        if (new_frame)
+            AcquisitionState.addWarmupFrame(pms.pm);
+        // The DHT needs no warm-up: read it while the fan runs
+        if (AcquisitionState.elapsed(now) >= AcquisitionState.settleMs)
+            readDHTWithRetry(now);
+        break;
+    case ACQ_READING:
+        if (new_frame)
+            PMSBurst.add(pms.data);
+        readDHTWithRetry(now);
+        break;
+    case ACQ_IDLE:
+    case ACQ_SLEEPING:
+        break;
+    }
+
+    switch (AcquisitionState.step(now))
+    {
+    case ACQ_READING:
+        if (previous == ACQ_WARMING)
+        {
+            Serial.print("Acquisition: PMS warm-up took ");
+            Serial.print(AcquisitionState.lastWarmupMs);
+            Serial.println(AcquisitionState.lastWarmupConverged ? " ms (stable)" : " ms (max warm-up reached)");
+            // One capture timestamp for the PMS and DHT readings of this cycle
+            PendingSample.stamp(captureTimestamp(), now);
+            // The last warm-up frame opens the burst once the values have converged
+            PMSBurst.reset();
+            if (AcquisitionState.lastWarmupConverged && pms)
+                PMSBurst.add(pms.data);
+            // The first burst window counts against PMS_BURST_ATTEMPTS
+            PMSRetry.attempt(now);
+        }
+        // Burst window over without a single frame: keep the fan on and try another window
+        if (PMSBurst.count == 0 && AcquisitionState.elapsed(now) > PMS_BURST_FRAMES * PMS_STABILITY_READ_INTERVAL_MS + PMS_READ_TIMEOUT_MS &&
+            !PMSRetry.exhausted())
+        {
+            PMSRetry.attempt(now);
+            PMSErrors.retries++;
+            AcquisitionState.restartPhase(now);
+            Serial.printf("Acquisition: no PMS frame, retrying burst (%u/%u)\n", PMSRetry.attempts, PMSRetry.maxAttempts);
+        }
+        // Burst complete, or give up on the missing frames; the DHT gets its remaining attempts first
+        if ((PMSBurst.full() || AcquisitionState.elapsed(now) > PMS_BURST_FRAMES * PMS_STABILITY_READ_INTERVAL_MS + PMS_READ_TIMEOUT_MS) &&
+            (PendingSample.has(SENSOR_DHT) || DHTRetry.exhausted()))
+        {
+            pms.sleep(false);
+            Serial.print("Acquisition: PMS burst of ");
+            Serial.print(PMSBurst.count);
+            Serial.println(" frame(s)");
+            if (getPMSREADINGS(PendingSample))
+            {
+                if (PMSRetry.attempts > 1)
+                    PMSErrors.recovered++;
+            }
+            else
+            {
+                PMSErrors.lostSamples++;
+            }
+            if (!PendingSample.has(SENSOR_DHT))
+                DHTErrors.lostSamples++;
+            queueSample(PendingSample);
+            updateSamplingInterval(PendingSample);
+            last_read_sensors_data = millis();
+            AcquisitionState.finishReading(millis());
+        }
+        break;
+    case ACQ_IDLE:
+    case ACQ_WARMING:
+    case ACQ_SLEEPING:
+        break;
+    }
+
+    if (previous != AcquisitionState.phase)
+    {
+        publishSamplingState();
+        Serial.print("Acquisition: ");
+        Serial.print(AcquisitionState.phaseName(previous));
+        Serial.print(" -> ");
+        Serial.println(AcquisitionState.phaseName(AcquisitionState.phase));
+    }
+}
+
+/**
+ * @brief Sampling task: starts acquisition cycles and steps them every SAMPLING_TASK_PERIOD_MS
+ * @details The task owns the PMS, the DHT, the acquisition state and SamplingScheduler; finished cycles reach loop()
+ *          through SampleQueue, so a GSM post that takes a minute no longer delays a reading, nor a reading a send.
+ *          A new DeviceConfig reaches the scheduler through sampling_config_changed; loop() reads the task's state
+ *          only through SamplingSnapshot.
+ */
+void samplingTask(void *)
+{
+    for (;;)
+    {
+        if (sampling_config_changed.exchange(false))
+            applySamplingConfig();
+        unsigned long now = millis();
+        // in power saving mode the next cycle waits until the memory logger has been sent
+        if (now - last_read_sensors_data > sampling_interval && !(DeviceConfig.power_saving_mode && send_now))
+            startAcquisitionCycle(now);
+        acquisitionManager();
+        vTaskDelay(pdMS_TO_TICKS(SAMPLING_TASK_PERIOD_MS));
+    }
+}
+
+/**
+ * @brief Hand a finished cycle to loop(); runs in the sampling task
+ * @details When loop() is SAMPLE_QUEUE_DEPTH cycles behind, DeviceConfig.sample_queue_policy decides: block waits for a
+ *          free place, drop-oldest gives up the oldest queued cycle and spill writes the cycle to the SD card. Once a
+ *          cycle has been spilled the following ones are spilled too until loop() has taken them, so cycles are always
+ *          logged in the order they were read.
+ */
+void queueSample(const SensorSample &sample)
+{
+    QueuedSample queued;
+    queued.sample = sample;
+    queued.burst = PMSBurst.summary();
+    if (SampleQueueState.spillPending && spillSample(sample))
+        return;
+
+    bool waiting = false;
+    while (!SampleQueue.push(queued))
+    {
+        uint8_t policy = DeviceConfig.sample_queue_policy;
+        if (policy == SAMPLE_QUEUE_SPILL && spillSample(sample))
+            return;
+        // not full: loop() is still copying out the oldest cycle, the push succeeds once it is done
+        if (SampleQueue.full())
+        {
+            if (policy == SAMPLE_QUEUE_BLOCK)
+            {
+                if (!waiting)
+                {
+                    SampleQueueState.blocked++;
+                    Serial.println("Sample queue full, sampling waits for loop()");
+                }
+                waiting = true;
+            }
+            else if (SampleQueue.dropOldest())
+            {
+                SampleQueueState.dropped++;
+                Serial.println("Sample queue full, oldest cycle dropped");
+                continue;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(SAMPLING_TASK_PERIOD_MS));
+    }
+}
+
+/**
+ * @brief Append the readings of a cycle to SAMPLE_SPILL_PATH as CBOR sample records; runs in the sampling task
+ * @return false if there is no SD card or the write failed
+ */
+bool spillSample(const SensorSample &sample)
+{
+    if (!SD_Attached || SpillLock == nullptr)
+        return false;
+    uint8_t cbor[SENSOR_COUNT * SAMPLE_RECORD_MAX_SIZE];
+    size_t length = 0;
+    for (uint8_t id = 0; id < SENSOR_COUNT; id++)
+    {
+        if (!sample.readings[id].valid)
+            continue;
+        SampleRecord record;
+        record.sensor = id;
+        record.time = sample.time;
+        memcpy(record.values, sample.readings[id].values, sizeof(record.values));
+        length += encodeSampleRecord(cbor + length, sizeof(cbor) - length, record);
+    }
+
+    xSemaphoreTake(SpillLock, portMAX_DELAY);
+    File file = SD.open(SAMPLE_SPILL_PATH, FILE_APPEND);
+    bool written = file && file.write(cbor, length) == length;
+    if (file)
+        file.close();
+    if (written)
+        SampleQueueState.spillPending = true;
+    xSemaphoreGive(SpillLock);
+
+    if (written)
+    {
+        SampleQueueState.spilled++;
+        Serial.println("Sample queue full, cycle spilled to " SAMPLE_SPILL_PATH);
+    }
+    return written;
+}
+
+/// @brief Log the cycles the sampling task has finished, then the ones it spilled; runs in loop()
+void drainSampleQueue()
+{
+    QueuedSample queued;
+    while (SampleQueue.pop(queued))
+        logSensorSample(queued.sample, queued.burst);
+    // spilled cycles are newer than every queued one taken above
+    if (SampleQueueState.spillPending)
+        ingestSpilledSamples();
+}
+
+/**
+ * @brief Log the cycles in SAMPLE_SPILL_PATH, oldest first, and remove the file
+ * @note : The sampling task waits for the lock if it has to spill meanwhile. The records of a cycle follow each other
+ *         with the same timestamp, which puts them back together.
+ */
+void ingestSpilledSamples()
+{
+    xSemaphoreTake(SpillLock, portMAX_DELAY);
+    File file = SD.open(SAMPLE_SPILL_PATH);
+    PMBurstSummary no_burst;
+    SensorSample sample;
+    uint8_t buf[SAMPLE_RECORD_MAX_SIZE];
+    size_t len = 0;
+    uint32_t cycles = 0;
+    while (file)
+    {
+        len += file.read(buf + len, sizeof(buf) - len);
+        if (len == 0) // End of file reached
+            break;
+
+        SampleRecord record;
+        size_t used = decodeSampleRecord(buf, len, record);
+        if (used == 0)
+        {
+            // torn write, resynchronise on the next byte
+            used = 1;
+        }
+        else
+        {
+            SensorId id = (SensorId)record.sensor;
+            if (!sample.empty() && (record.time.epoch != sample.time.epoch || sample.has(id)))
+            {
+                logSensorSample(sample, no_burst);
+                cycles++;
+                sample.reset();
+            }
+            sample.stamp(record.time, millis());
+            for (uint8_t i = 0; i < SENSOR_REGISTRY[id].value_count; i++)
+                sample.set(id, i, record.values[i]);
+        }
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+    if (!sample.empty())
+    {
+        logSensorSample(sample, no_burst);
+        cycles++;
+    }
+    if (file)
+    {
+        file.close();
+        SD.remove(SAMPLE_SPILL_PATH);
+    }
+    SampleQueueState.spillPending = false;
+    xSemaphoreGive(SpillLock);
+
+    SampleQueueState.ingested += cycles;
+    Serial.printf("Logged %u cycles spilled to " SAMPLE_SPILL_PATH "\n", (unsigned)cycles);
+}
+
+/// @brief Wake the PMS and start an acquisition cycle unless one is already running
+/// @param now : current millis()
+void startAcquisitionCycle(unsigned long now)
+{
+    if (AcquisitionState.start(now))
+    {
+        Serial.println("Acquisition: idle -> warming (PMS5003 fan on)");
+        PendingSample.reset();
+        DHTRetry.reset();
+        PMSRetry.reset();
+        pms.wake(false);
+    }
+}
+
+/// @brief Copy the scheduler, acquisition state and read counters to SamplingSnapshot, which loop() reads instead
+/// @note Runs in the sampling task after a config change and on every phase change, so telemetry is at most one
+///       phase behind
+void publishSamplingState()
+{
+    xSemaphoreTake(SamplingLock, portMAX_DELAY);
+    SamplingSnapshot.scheduler = SamplingScheduler;
+    SamplingSnapshot.acquisition = AcquisitionState;
+    SamplingSnapshot.dht = DHTErrors;
+    SamplingSnapshot.pms = PMSErrors;
+    SamplingSnapshot.parserCksumErrors = pms.parser().cksum_errors;
+    SamplingSnapshot.parserLengthErrors = pms.parser().length_errors;
+    SamplingSnapshot.queueBlocked = SampleQueueState.blocked;
+    SamplingSnapshot.queueDropped = SampleQueueState.dropped;
+    SamplingSnapshot.queueSpilled = SampleQueueState.spilled;
+    xSemaphoreGive(SamplingLock);
+}
+
+/// @brief Copy the sampling bounds and rates from DeviceConfig into the scheduler
+/// @note Runs in the sampling task once it has started; loop() sets sampling_config_changed instead
+void applySamplingConfig()
+{
+    SamplingScheduler.enabled = DeviceConfig.adaptive_sampling;
+    SamplingScheduler.minMs = DeviceConfig.sampling_interval_min_ms;
+    SamplingScheduler.maxMs = DeviceConfig.sampling_interval_max_ms;
+    SamplingScheduler.fastRate = DeviceConfig.pm25_fast_rate;
+    SamplingScheduler.stableRate = DeviceConfig.pm25_stable_rate;
+    memcpy(SamplingScheduler.thresholds, DeviceConfig.pm25_thresholds, sizeof(SamplingScheduler.thresholds));
+    if (!SamplingScheduler.enabled)
+        SamplingScheduler.intervalMs = SAMPLING_INTERVAL_DEFAULT_MS;
+    SamplingScheduler.applyBounds();
+    sampling_interval = SamplingScheduler.intervalMs;
+    publishSamplingState();
+
+    Serial.printf("Sampling interval: %lu ms (adaptive %s, %lu - %lu ms)\n", SamplingScheduler.intervalMs,
+                  SamplingScheduler.enabled ? "on" : "off", SamplingScheduler.minMs, SamplingScheduler.maxMs);
+}
+
+/// @brief Adapt the sampling interval to the PM2.5 reading of the cycle
+/// @param sample : readings of the cycle that just finished
+void updateSamplingInterval(const SensorSample &sample)
+{
+    if (!sample.has(SENSOR_PMS))
+        return;
+    uint16_t pm25 = sample.value(SENSOR_PMS, PMS_PM25);
+    unsigned long previous = SamplingScheduler.intervalMs;
+    SamplingChangeReason reason = SamplingScheduler.update(pm25, sample.capturedAt);
+    if (reason == SAMPLING_UNCHANGED)
+        return;
+    sampling_interval = SamplingScheduler.intervalMs;
+    Serial.printf("Sampling interval: %lu -> %lu ms (%s, PM2.5 %u ug/m3, %.2f ug/m3/min)\n", previous,
+                  SamplingScheduler.intervalMs,
+                  SamplingScheduler.reasonName(reason), pm25, SamplingScheduler.lastRate);
+}
+
+/// @brief Read the DHT22 into the pending sample if it has not answered yet and an attempt is due
+/// @param now : current millis()
+void readDHTWithRetry(unsigned long now)
+{
+    if (PendingSample.has(SENSOR_DHT) || !DHTRetry.due(now))
+        return;
+    if (DHTRetry.attempts > 0)
+        DHTErrors.retries++;
+    DHTRetry.attempt(now);
+    if (readDHT(PendingSample) && DHTRetry.attempts > 1)
+        DHTErrors.recovered++;
+}
+
+/// @brief Read the DHT22 into a sample
+/// @param sample : receives temperature and humidity on success
+/// @return true if the sensor answered
+bool readDHT(SensorSample &sample)
+{
     Serial.print("Reading DHT22...");
     uint32_t start = millis();
     int chk = dht.read();
     uint32_t stop = millis();
+    DHTErrors.record(chk <= 0 && chk > -9 ? -chk : 9);
 
     switch (chk)
     {
@@ -509,36 +1018,12 @@ void readDHT()
         char buf[128] = {};
         float temperature = dht.getTemperature();
         float humidity = dht.getHumidity();
-        String datetime = getRTCdatetimetz(ISO_time_format, esp_datetime_tz.timezone);
+        sample.set(SENSOR_DHT, DHT_TEMPERATURE, temperature);
+        sample.set(SENSOR_DHT, DHT_HUMIDITY, humidity);
         sprintf(buf, "Temperature %0.1f C, Humidity %0.1f %% RH", temperature, humidity);
 
         Serial.println(buf);
-        if (datetime != "")
-        {
-            updateCalendarFromRTC(); // In case we roll into a new year or month.
-            // Generate JSON data
-            JsonDocument DHT_data_doc;
-            JsonArray DHT_data = DHT_data_doc.to<JsonArray>();
-            add_value2JSON_array(DHT_data, "temperature", temperature);
-            add_value2JSON_array(DHT_data, "humidity", humidity);
-            // serializeJsonPretty(DHT_data_doc, Serial);
-            generateJSON_payload(resultDHT, DHT_data_doc, datetime.c_str(), SensorAPI_PIN::DHT, sizeof(resultDHT));
-            memoryDataLog(JSON_PAYLOAD_LOGGER, resultDHT);
-
-            // Generate CSV data and log to memory
-            generateCSV_payload(resultDHT, sizeof(resultDHT), datetime.c_str(), "temperature", temperature, "°C", "DHT22");
-            generateCSV_payload(resultDHT, sizeof(resultDHT), datetime.c_str(), "humidity", humidity, "%", "DHT22");
-            memoryDataLog(CSV_PAYLOAD_LOGGER, resultDHT);
-
-            // update current sensor data
-            JsonObject dht_obj = DHT_data_doc.to<JsonObject>();
-            dht_obj["temperature"] = temperature;
-            dht_obj["humidity"] = humidity;
-            current_sensor_data["DHT"] = dht_obj;
-            serializeJsonPretty(current_sensor_data, Serial);
-        }
-
-        break;
+        return true;
     }
     case DHTLIB_ERROR_CHECKSUM:
         Serial.print("Checksum error,\t");
@@ -570,80 +1055,131 @@ void readDHT()
         Serial.print(",\t");
         break;
     }
+    return false;
 }
 
-void getPMSREADINGS()
+/// @brief Take the burst summary of the last PMS reading into a sample
+/// @param sample : receives the burst medians
+/// @return true if at least one frame was read
+/// @note The sensor is woken, read and put back to sleep by acquisitionManager(). The median of the burst is logged
+///       and sent; mean, min and max are kept in current_sensor_data.
+bool getPMSREADINGS(SensorSample &sample)
 {
-    pms.wake();
-    delay(30000); // wait for 30 seconds warm-up to get an accurate reading
-
-    // pms.sleep();
-    char result_PMS[255] = {};
-    pms.read();
-    if (pms) // Successfull read
+    if (PMSBurst.count == 0) // something went wrong
     {
-        pms.sleep();
-        String datetime = getRTCdatetimetz(ISO_time_format, esp_datetime_tz.timezone);
-
-        // print the results
-        printPM_values();
-
-        if (datetime == "") // ! extra validation needed now that RTC is being used
-        {
-            Serial.println("Datetime is empty...discarding data point");
-        }
-        else
-        {
-            updateCalendarFromRTC(); // In case we roll into a new year or month.
+        printPM_Error();
+        return false;
+    }
 
-            // Generate JSON data
-            JsonDocument PM_data_doc;
-            JsonArray PM_data = PM_data_doc.to<JsonArray>();
+    uint16_t pm_median[PMSBurst.CHANNELS];
+    PMSBurst.medians(pm_median);
+    sample.set(SENSOR_PMS, PMS_PM1, pm_median[0]);
+    sample.set(SENSOR_PMS, PMS_PM25, pm_median[1]);
+    sample.set(SENSOR_PMS, PMS_PM10, pm_median[2]);
 
-            add_value2JSON_array(PM_data, "P0", pms.pm01);
-            add_value2JSON_array(PM_data, "P1", pms.pm10);
-            add_value2JSON_array(PM_data, "P2", pms.pm25);
+    // print the results
+    printPM_values(pm_median);
+    return true;
+}
 
-            // serializeJsonPretty(PM_data_doc, Serial);
-            generateJSON_payload(result_PMS, PM_data_doc, datetime.c_str(), SensorAPI_PIN::PMS, sizeof(result_PMS));
+/// @brief Log one acquisition cycle to the JSON and CSV memory loggers and update current_sensor_data
+/// @param sample : sensor readings sharing one capture timestamp
+/// @param burst : PMS burst statistics of the cycle; count 0 leaves those in current_sensor_data as they are
+/// @details Payloads, CSV rows and current_sensor_data entries are generated from SENSOR_REGISTRY. The API takes one
+///          payload per sensor pin, so each sensor gets its own payload, all carrying the same timestamp.
+///          Both loggers keep the readings as SampleRecords; payloads and rows are only rendered when they are sent or
+///          written to the SD card. While aggregateUplink() holds, the payloads go to the monthly JSON file on the SD
+///          card instead of the upload log and only the window aggregates of Aggregator are uploaded.
+void logSensorSample(const SensorSample &sample, const PMBurstSummary &burst)
+{
+    if (sample.empty())
+        return;
+    if (!sample.isStamped()) // ! extra validation needed now that RTC is being used
+    {
+        Serial.println("Datetime is empty...discarding data point");
+        return;
+    }
+    updateCalendarFromRTC(); // In case we roll into a new year or month.
 
-            memoryDataLog(JSON_PAYLOAD_LOGGER, result_PMS);
+    char datetime[32];
+    formatISO8601(datetime, sizeof(datetime), sample.time);
+    bool aggregate = aggregateUplink();
+    if (aggregate && SD_Attached)
+        refreshLoggerPath(JSON_PAYLOAD_LOGGER);
+    if (DeviceConfig.aggregation != AGGREGATION_OFF)
+        Aggregator.setWindow(DeviceConfig.aggregation_window_s);
 
-            // Generate CSV data and log to memory
+    for (uint8_t id = 0; id < SENSOR_COUNT; id++)
+    {
+        const SensorReading &reading = sample.readings[id];
+        if (!reading.valid)
+            continue;
+        const SensorDescriptor &sensor = SENSOR_REGISTRY[id];
+        SampleRecord record;
+        record.sensor = id;
+        record.time = sample.time;
+        memcpy(record.values, reading.values, sizeof(record.values));
 
-            generateCSV_payload(result_PMS, sizeof(result_PMS), datetime.c_str(), "PM0", pms.pm01, "ug/m3", "PMS");
-            memoryDataLog(CSV_PAYLOAD_LOGGER, result_PMS);
-            generateCSV_payload(result_PMS, sizeof(result_PMS), datetime.c_str(), "PM2.5", pms.pm25, "ug/m3", "PMS");
-            memoryDataLog(CSV_PAYLOAD_LOGGER, result_PMS);
-            generateCSV_payload(result_PMS, sizeof(result_PMS), datetime.c_str(), "PM10", pms.pm10, "ug/m3", "PMS");
-            memoryDataLog(CSV_PAYLOAD_LOGGER, result_PMS);
+        if (!aggregate)
+        {
+            memoryDataLog(JSON_PAYLOAD_LOGGER, record);
+        }
+        else if (SD_Attached)
+        {
+            // raw readings stay on the SD card
+            char payload[LOGGER::ENTRY_SIZE];
+            if (renderSamplePayload(payload, sizeof(payload), record) > 0)
+                appendFile(SD, JSON_PAYLOAD_LOGGER.path, payload);
+        }
+        memoryDataLog(CSV_PAYLOAD_LOGGER, record);
 
-            // update current sensor data
-            JsonObject pm_obj = PM_data_doc.to<JsonObject>();
-            pm_obj["PM2.5"] = pms.pm25;
-            pm_obj["PM10"] = pms.pm10;
-            pm_obj["PM1"] = pms.pm01;
+        // A reading in the next window closes the current one; its aggregates go out right away
+        if (DeviceConfig.aggregation != AGGREGATION_OFF && Aggregator.add(id, reading.values, sample.time, aggregate))
+            aggregates_due = true;
 
-            current_sensor_data["PM"] = pm_obj;
+        // update current sensor data
+        JsonObject obj = current_sensor_data[sensor.current_group].to<JsonObject>();
+        for (uint8_t i = 0; i < sensor.value_count; i++)
+        {
+            if (sensor.values[i].decimals == 0)
+                obj[sensor.values[i].current_key] = (int)reading.values[i];
+            else
+                obj[sensor.values[i].current_key] = reading.values[i];
         }
     }
-    else // something went wrong
+
+    if (sample.has(SENSOR_PMS) && burst.count > 0)
     {
-        pms.sleep();
-        printPM_Error();
+        // burst statistics (SerialPM::data order)
+        static const char *const channel_names[PMBurstSummary::CHANNELS] = {"PM1", "PM2.5", "PM10", "N0.3", "N0.5", "N1.0", "N2.5", "N5.0", "N10"};
+        JsonObject burst_stats = current_sensor_data[SENSOR_REGISTRY[SENSOR_PMS].current_group]["burst"].to<JsonObject>();
+        burst_stats["count"] = burst.count;
+        for (uint8_t ch = 0; ch < PMBurstSummary::CHANNELS; ch++)
+        {
+            const PMBurstStats &st = burst.channels[ch];
+            JsonObject channel = burst_stats[channel_names[ch]].to<JsonObject>();
+            channel["median"] = st.median;
+            channel["mean"] = st.mean;
+            channel["min"] = st.min;
+            channel["max"] = st.max;
+        }
     }
+
+    current_sensor_data["timestamp"] = datetime;
+    serializeJsonPretty(current_sensor_data, Serial);
 }
 
-void printPM_values()
+/// @param pm : PM1.0, PM2.5 and PM10 [ug/m3] (SerialPM::pm order)
+void printPM_values(const uint16_t pm[3])
 {
     Serial.print(F("PM1.0 "));
-    Serial.print(pms.pm01);
+    Serial.print(pm[0]);
     Serial.print(F(", "));
     Serial.print(F("PM2.5 "));
-    Serial.print(pms.pm25);
+    Serial.print(pm[1]);
     Serial.print(F(", "));
     Serial.print(F("PM10 "));
-    Serial.print(pms.pm10);
+    Serial.print(pm[2]);
     Serial.println(F(" [ug/m3]"));
 }
 
@@ -684,159 +1220,82 @@ void printPM_Error()
 /**
     @brief Generate JSON payload
     @param res : buffer to store the generated JSON payload
-    @param data : JSON document containing the sensor data
+    @param sensor : SensorId of the sensor
+    @param values : sensor values, in the order of the sensor's SENSOR_REGISTRY values
     @param timestamp : timestamp of the data
-    @param pin : sensor pin type as configured in the API
     @param size : size of the buffer
-    @return : void
+    @return : false if the payload does not fit, res is then empty
+    @note : rendered from the sensor's compile-time template (payload_template.h); only the timestamp and the values
+            are written at runtime
 **/
-void generateJSON_payload(char *res, JsonDocument &data, const char *timestamp, SensorAPI_PIN pin, size_t size)
+bool generateJSON_payload(char *res, uint8_t sensor, const float *values, const char *timestamp, size_t size)
 {
-    JsonDocument payload;
-
-    payload["software_version"] = "NRZ-2020-129";
-    payload["timestamp"] = timestamp;
-    payload["sensordatavalues"] = data;
-
-    // char sensor_type[24] = ",\"type\":\"";
-    switch (pin)
-    {
-    case SensorAPI_PIN::PMS:
-        // strcat(res, "PMS\"");
-        payload["sensor_type"] = "PMS";
-        payload["API_PIN"] = pin;
-        break;
-    case SensorAPI_PIN::DHT:
-        // strcat(res, "DHT\"");
-        payload["sensor_type"] = "DHT";
-        payload["API_PIN"] = pin;
-        break;
-    default:
-        Serial.println("Unsupported sensor pin");
-        break;
-    }
+    return renderPayload(res, size, sensor, timestamp, values) > 0;
+}
 
-    serializeJson(payload, res, size);
+/**
+    @brief Append one CSV row for a sensor value
+    @param csv : batch the row is appended to
+    @param timestamp : timestamp of the data
+    @param sensor : registry entry of the sensor
+    @param index : index of the value in sensor.values
+    @param value : the value
+    @return : false if the row does not fit in the batch; the batch is left unchanged
+**/
+bool generateCSV_row(CsvWriter &csv, const char *timestamp, const SensorDescriptor &sensor, uint8_t index, float value)
+{
+    const SensorValueDescriptor &desc = sensor.values[index];
+    return csv.row(timestamp, desc.csv_key, value, desc.decimals, desc.unit, sensor.csv_sensor);
 }
 
-datetimetz extractDateTime(String datetimeStr)
+/// @brief Parse the modem clock (AT+CCLK, "yy/MM/dd,hh:mm:ss±zz", quotes allowed)
+/// @param datetimeStr : modem time string
+/// @return local timestamp and timezone offset; timestamp 0 if the string could not be parsed
+datetimetz extractDateTime(const char *datetimeStr)
 {
     datetimetz dtz;
-    dtz.datetime = {0, 0, 0, 0, 0, 0, 0};
     dtz.timestamp = 0;
 
-    // Serial.println("Received date string: " + datetimeStr); //! format looks like "25/02/24,05:55:53+00" and may include the quotes!
-
-    // check if received string is empty
-    if (datetimeStr == "")
-    {
-        Serial.println("Datetime string is empty");
-
-        return dtz;
-    }
-
-    // check if the datetime string has leading or trailing quotes
-    if (datetimeStr[0] == '"', datetimeStr[datetimeStr.length() - 1] == '"')
-    {
-        // remove the first and last character of the string (")
-        datetimeStr = datetimeStr.substring(1, datetimeStr.length() - 1);
-    }
-
-    // Parse the datetime string
-
-    int _year = datetimeStr.substring(0, 2).toInt();
-    int _month = datetimeStr.substring(3, 5).toInt();
-    int _day = datetimeStr.substring(6, 8).toInt();
-    int _hour = datetimeStr.substring(9, 11).toInt();
-    int _minute = datetimeStr.substring(12, 14).toInt();
-    int _second = datetimeStr.substring(15, 17).toInt();
-
-    // perform sanity check on the parsed values
-    if (_year < 0 || _year > 99 || _month < 1 || _month > 12 || _day < 1 || _day > 31 ||
-        _hour < 0 || _hour > 23 || _minute < 0 || _minute > 59 || _second < 0 || _second > 59)
-    {
-        Serial.println("Invalid date/time values");
-        return dtz;
-    }
-
+    Timestamp t;
 #if defined(QUECTEL)
-
     // time zone = indicates the difference, expressed in quarters of an hour, between the local time and GMT; range: -48 to +56)
-    int tz = datetimeStr.substring(18).toInt() / 4;
-    String timezone = datetimeStr.substring(17, 18); // extract timezone sign
-    if (tz < 10)
-    {
-        timezone += "0" + String(tz);
-    }
-    else
+    bool parsed = parseModemTime(datetimeStr, t, true);
+#else
+    bool parsed = parseModemTime(datetimeStr, t, false); // +00
+#endif
+    if (!parsed)
     {
-        timezone += String(tz);
+        Serial.println("Invalid date/time string");
+        return dtz;
     }
-#else
-    String timezone = datetimeStr.substring(17); // +00
 
-#endif
-    strncpy(dtz.timezone, timezone.c_str(), 6); // copy timezone to the provided buffer
-
-    Serial.println("Day: " + String(_day));
-    Serial.println("Month: " + String(_month));
-    Serial.println("Year: " + String(_year));
-    Serial.println("Hour: " + String(_hour));
-    Serial.println("Minute: " + String(_minute));
-    Serial.println("Second: " + String(_second));
-
-    // Adjust year for TimeLib (TimeLib expects years since 1970)
-    _year += 2000; // Assuming 24 is 2024
-    _year -= 1970;
-
-    dtz.datetime.Second = _second;
-    dtz.datetime.Minute = _minute;
-    dtz.datetime.Hour = _hour;
-    dtz.datetime.Day = _day;
-    dtz.datetime.Month = _month;
-    dtz.datetime.Year = _year;
-
-    // Create a time_t value
-    dtz.timestamp = makeTime(dtz.datetime);
+    dtz.timestamp = t.localEpoch();
+    dtz.tz_offset_min = t.tzOffsetMin;
     Serial.print("Parsed timestamp: ");
-    Serial.println(dtz.timestamp); // Print the time_t value
+    Serial.println(dtz.timestamp);
 
     return dtz;
 }
 
-String formatDateTime(time_t t, String timezone)
-{
-    String yearStr = String(year(t)); // Adjust year back to 20xx
-    String monthStr = String(month(t));
-    String dayStr = String(day(t));
-    String hourStr = String(hour(t));
-    String minuteStr = String(minute(t));
-    String secondStr = String(second(t));
-
-    // Pad with leading zeros if necessary
-    if (monthStr.length() == 1)
-        monthStr = "0" + monthStr;
-    if (dayStr.length() == 1)
-        dayStr = "0" + dayStr;
-    if (hourStr.length() == 1)
-        hourStr = "0" + hourStr;
-    if (minuteStr.length() == 1)
-        minuteStr = "0" + minuteStr;
-    if (secondStr.length() == 1)
-        secondStr = "0" + secondStr;
-
-    return yearStr + "-" + monthStr + "-" + dayStr + "T" + hourStr + ":" + minuteStr + ":" + secondStr + timezone;
-}
-
-String getRTCdatetimetz(const char *format, char *timezone)
+/// @brief Current RTC time as a UTC epoch and timezone offset
+/// @return an unset Timestamp if the clock has not been set
+/// @note The RTC runs on local time when it was set from the modem clock (see extractDateTime()). Called from loop()
+///       and the sampling task: the epoch and offset are read under TimeLock, as they are set
+Timestamp captureTimestamp()
 {
-    if(!DeviceConfigState.timeSet)
-    {
-        return "";
-    }
-    String datetimetz = RTC.getTime(format);
-    datetimetz += timezone;
-    return datetimetz;
+    Timestamp t;
+    xSemaphoreTake(TimeLock, portMAX_DELAY);
+    if (DeviceConfigState.timeSet)
+    {
+        t.tzOffsetMin = esp_datetime_tz.tz_offset_min;
+        t.epoch = (int64_t)RTC.getEpoch();
+    }
+    xSemaphoreGive(TimeLock);
+    if (!t.isSet())
+        return t;
+    if (t.tzOffsetMin != TZ_OFFSET_UNKNOWN)
+        t.epoch -= (int64_t)t.tzOffsetMin * 60;
+    return t;
 }
 
 /*****************************************************************
@@ -844,12 +1303,15 @@ String getRTCdatetimetz(const char *format, char *timezone)
  *****************************************************************/
 /**
     @brief: Send data to the server via WiFi
-    @param data : JSON payload to send
+    @param data : payload to send
+    @param data_length : payload length in bytes
+    @param content_type : MIME type of the payload
+    @param content_encoding : Content-Encoding of the payload, nullptr if not encoded
     @param _pin : pin number of the sensor as configured in the API
     @param url : full URL of the server endpoint
     @return: true if data is sent successfully, false otherwise
 **/
-bool sendDataViaWiFi(const char *data, const int _pin, const char *url)
+bool sendDataViaWiFi(const char *data, size_t data_length, const char *content_type, const char *content_encoding, const int _pin, const char *url)
 {
     if (!DeviceConfigState.wifiConnected || !DeviceConfigState.wifiInternetAvailable)
     {
@@ -869,26 +1331,20 @@ bool sendDataViaWiFi(const char *data, const int _pin, const char *url)
     }
     // ToDo: Refactor to use WiFiClientSecure if useWiFiSecure is true. This will require additional handling for certificates and may increase memory usage significantly, so it should be implemented with care.
 
-    WiFiClient client;
     char pin[4];
     itoa(_pin, pin, 10);
 
     // Build HTTP request
-    char http_headers[3][40] = {};
+    char http_headers[4][40] = {};
     strcat(http_headers[0], "X-PIN: ");
     strcat(http_headers[0], pin);
 
     strcat(http_headers[1], "X-Sensor: ");
     strcat(http_headers[1], SENSOR_PREFIX);
     strcat(http_headers[1], esp_chipid);
-    strcat(http_headers[2], "Content-Type: application/json");
-
-    // Connect to server
-    if (!client.connect(host, PORT_CFA))
-    {
-        Serial.println("WiFi: Failed to connect to server");
-        return false;
-    }
+    snprintf(http_headers[2], sizeof(http_headers[2]), "Content-Type: %s", content_type);
+    if (content_encoding)
+        snprintf(http_headers[3], sizeof(http_headers[3]), "Content-Encoding: %s", content_encoding);
 
     // Build HTTP POST request
     String http_request = "POST ";
@@ -898,7 +1354,7 @@ bool sendDataViaWiFi(const char *data, const int _pin, const char *url)
     http_request += host;
     http_request += "\r\n";
     http_request += "Content-Length: ";
-    http_request += strlen(data);
+    http_request += data_length;
     http_request += "\r\n";
     http_request += http_headers[0]; // X-PIN
     http_request += "\r\n";
@@ -906,40 +1362,97 @@ bool sendDataViaWiFi(const char *data, const int _pin, const char *url)
     http_request += "\r\n";
     http_request += http_headers[2]; // Content-Type
     http_request += "\r\n";
-    http_request += "Connection: close\r\n";
+    if (content_encoding)
+    {
+        http_request += http_headers[3]; // Content-Encoding
+        http_request += "\r\n";
+    }
+    http_request += "Connection: keep-alive\r\n";
     http_request += "\r\n";
-    http_request += data;
 
-    // Send the request
-    client.print(http_request);
+    // The connection to the endpoint is kept open between requests; one the server has dropped in the meantime shows
+    // as a request without an answer and is retried once on a new connection
+    UploadTarget &target = uploadTargetFor(url);
+    WiFiClient &client = target.client;
+    int statuscode = 0;
+    for (uint8_t attempt = 0; attempt < 2 && statuscode == 0; attempt++)
+    {
+        bool reused = client.connected() && strcmp(target.client_host, host) == 0;
+        if (!reused)
+        {
+            client.stop();
+            target.client_host[0] = '\0';
+            // Connect to server
+            if (!client.connect(host, PORT_CFA))
+            {
+                Serial.println("WiFi: Failed to connect to server");
+                return false;
+            }
+            strlcpy(target.client_host, host, sizeof(target.client_host));
+        }
+        else
+        {
+            Serial.println("WiFi: Reusing connection");
+        }
 
-    // Wait for response and check status code
-    unsigned long timeout = millis() + 10000; // 10 second timeout
-    uint8_t statuscode = 0;
-    bool parsing_status = false;
+        // Send the request; the body is written as bytes, it need not be text
+        client.print(http_request);
+        client.write((const uint8_t *)data, data_length);
 
-    while (client.connected() && millis() < timeout)
-    {
-        String line = client.readStringUntil('\n');
-        if (line.length() == 0)
-            break;
+        // Wait for response and check status code
+        unsigned long timeout = millis() + 10000; // 10 second timeout
+        long content_length = -1;
+        bool keep_alive = true;
+        bool parsing_status = false;
 
-        // Parse HTTP status code (first line: HTTP/1.1 200 OK)
-        if (!parsing_status && line.startsWith("HTTP/1."))
+        while (client.connected() && millis() < timeout)
         {
-            int space_pos = line.indexOf(' ');
-            if (space_pos > 0)
+            String line = client.readStringUntil('\n');
+            line.trim();
+            if (line.length() == 0)
+                break; // end of the response headers
+
+            // Parse HTTP status code (first line: HTTP/1.1 200 OK)
+            if (!parsing_status && line.startsWith("HTTP/1."))
+            {
+                int space_pos = line.indexOf(' ');
+                if (space_pos > 0)
+                {
+                    String status_str = line.substring(space_pos + 1, space_pos + 4);
+                    statuscode = status_str.toInt();
+                    parsing_status = true;
+                    Serial.print("WiFi: HTTP Status Code: ");
+                    Serial.println(statuscode);
+                }
+                keep_alive = !line.startsWith("HTTP/1.0");
+            }
+            else if (line.startsWith("Content-Length:") || line.startsWith("content-length:"))
             {
-                String status_str = line.substring(space_pos + 1, space_pos + 4);
-                statuscode = status_str.toInt();
-                parsing_status = true;
-                Serial.print("WiFi: HTTP Status Code: ");
-                Serial.println(statuscode);
+                content_length = line.substring(15).toInt();
             }
+            else if (line.equalsIgnoreCase("Connection: close"))
+            {
+                keep_alive = false;
+            }
+        }
+
+        // Read the body so the next request starts on a clean connection; without a length the server closes it
+        for (long n = 0; n < content_length && client.connected() && millis() < timeout;)
+        {
+            if (client.read() >= 0)
+                n++;
+        }
+        if (statuscode == 0 || !keep_alive || content_length < 0)
+        {
+            client.stop();
+            target.client_host[0] = '\0';
         }
+        if (!reused)
+            break;
     }
 
-    client.stop();
+    if (statuscode != 0)
+        LastHTTPStatus = statuscode;
 
     if (statuscode == 200 || statuscode == 201)
     {
@@ -963,12 +1476,15 @@ bool sendDataViaWiFi(const char *data, const int _pin, const char *url)
  *****************************************************************/
 /**
     @brief: Send data to the server via GSM/GPRS
-    @param data : JSON payload to send
+    @param data : payload to send
+    @param data_length : payload length in bytes
+    @param content_type : MIME type of the payload
+    @param content_encoding : Content-Encoding of the payload, nullptr if not encoded
     @param _pin : pin number of the sensor as configured in the API
     @param url : full URL of the server endpoint
     @return: true if data is sent successfully, false otherwise
 **/
-bool sendDataViaGSM(const char *data, const int _pin, const char *url)
+bool sendDataViaGSM(const char *data, size_t data_length, const char *content_type, const char *content_encoding, const int _pin, const char *url)
 {
     if (!gsm_capable || !GPRS_CONNECTED)
     {
@@ -982,16 +1498,21 @@ bool sendDataViaGSM(const char *data, const int _pin, const char *url)
 #ifdef QUECTEL
     int statuscode = 0;
 
-    char http_headers[3][256] = {};
+    char http_headers[4][256] = {};
+    int header_count = 3;
     strcat(http_headers[0], "X-PIN: ");
     strcat(http_headers[0], pin);
 
     strcat(http_headers[1], "X-Sensor: ");
     strcat(http_headers[1], SENSOR_PREFIX);
     strcat(http_headers[1], esp_chipid);
-    strcat(http_headers[2], "Content-Type: application/json");
+    snprintf(http_headers[2], sizeof(http_headers[2]), "Content-Type: %s", content_type);
+    if (content_encoding)
+        snprintf(http_headers[header_count++], sizeof(http_headers[0]), "Content-Encoding: %s", content_encoding);
 
-    QUECTEL_POST(url, http_headers, 3, data, strlen(data), statuscode);
+    QUECTEL_POST(url, http_headers, header_count, data, data_length, statuscode);
+    if (statuscode != 0)
+        LastHTTPStatus = statuscode;
 
     if (statuscode == 200 || statuscode == 201)
     {
@@ -1010,20 +1531,36 @@ bool sendDataViaGSM(const char *data, const int _pin, const char *url)
 #endif
 }
 
+/// @brief Whether bodies posted to url may be gzip-compressed (stagingGzip / productionGzip config keys)
+bool gzipEnabledFor(const char *url)
+{
+    if (strcmp(url, DeviceConfig.production_url) == 0)
+        return DeviceConfig.production_gzip;
+    if (strcmp(url, DeviceConfig.staging_url) == 0)
+        return DeviceConfig.staging_gzip;
+    return false;
+}
+
 /*****************************************************************
  * send data to rest api with fallback                           *
  *****************************************************************/
 /**
     @brief: Send data to the server with communication priority and fallback
-    @param data : JSON payload to send
+    @param data : payload to send
+    @param data_length : payload length in bytes
+    @param content_type : MIME type of the payload, e.g. application/json
     @param _pin : pin number of the sensor as configured in the API
     @param url : url path to send the data
     @return: true if data is sent successfully via any method, false otherwise
     @note: Respects CommunicationPriority order and attempts fallback method if primary fails
+    @note: The body is gzip-compressed if the endpoint has gzip enabled in DeviceConfig, see gzipEnabledFor()
+    @note: LastHTTPStatus holds the status of the last response received, 0 if no server answered
 **/
-bool sendData(const char *data, const int _pin, const char *url)
+bool sendData(const char *data, size_t data_length, const char *content_type, const int _pin, const char *url)
 {
     bool send_result = false;
+    const char *content_encoding = nullptr;
+    LastHTTPStatus = 0;
 
     // Check if any communication method is available
     if (CommsManagerState.allCommsUnavailable)
@@ -1032,6 +1569,26 @@ bool sendData(const char *data, const int _pin, const char *url)
         return false;
     }
 
+    // Compress the body for endpoints configured to accept gzip; bodies that do not shrink are sent as they are.
+    // A body sent to several endpoints (fanOut) is compressed once.
+    if (data_length >= GZIP_MIN_BODY_BYTES && gzipEnabledFor(url))
+    {
+        uint32_t crc = GzipEncoder::crc32((const uint8_t *)data, data_length);
+        if (data_length != gzip_source_length || crc != gzip_source_crc)
+        {
+            gzip_body_length = GzipBody.compress((const uint8_t *)data, data_length, gzip_body, sizeof(gzip_body));
+            gzip_source_length = data_length;
+            gzip_source_crc = crc;
+        }
+        if (gzip_body_length > 0)
+        {
+            Serial.printf("SendData: gzip %u -> %u bytes\n", (unsigned)data_length, (unsigned)gzip_body_length);
+            data = (const char *)gzip_body;
+            data_length = gzip_body_length;
+            content_encoding = "gzip";
+        }
+    }
+
     // Use preferred communication method determined by CommsManager
     switch (CommsManagerState.preferredComm)
     {
@@ -1039,7 +1596,7 @@ bool sendData(const char *data, const int _pin, const char *url)
         if (DeviceConfig.useWiFi && CommsManagerState.wifiOnline)
         {
             Serial.println("SendData: Attempting WiFi (preferred)...");
-            send_result = sendDataViaWiFi(data, _pin, url);
+            send_result = sendDataViaWiFi(data, data_length, content_type, content_encoding, _pin, url);
 
             if (send_result)
             {
@@ -1052,7 +1609,7 @@ bool sendData(const char *data, const int _pin, const char *url)
 
             if (DeviceConfig.useGSM && CommsManagerState.gsmOnline)
             {
-                send_result = sendDataViaGSM(data, _pin, url);
+                send_result = sendDataViaGSM(data, data_length, content_type, content_encoding, _pin, url);
                 if (send_result)
                 {
                     CommsManagerState.wifiFailCount = 0; // Reset on success
@@ -1067,7 +1624,7 @@ bool sendData(const char *data, const int _pin, const char *url)
         if (DeviceConfig.useGSM && CommsManagerState.gsmOnline)
         {
             Serial.println("SendData: Attempting GSM (preferred)...");
-            send_result = sendDataViaGSM(data, _pin, url);
+            send_result = sendDataViaGSM(data, data_length, content_type, content_encoding, _pin, url);
 
             if (send_result)
             {
@@ -1080,7 +1637,7 @@ bool sendData(const char *data, const int _pin, const char *url)
 
             if (DeviceConfig.useWiFi && CommsManagerState.wifiOnline)
             {
-                send_result = sendDataViaWiFi(data, _pin, url);
+                send_result = sendDataViaWiFi(data, data_length, content_type, content_encoding, _pin, url);
                 if (send_result)
                 {
                     CommsManagerState.gsmFailCount = 0; // Reset on success
@@ -1096,7 +1653,7 @@ bool sendData(const char *data, const int _pin, const char *url)
         if (DeviceConfig.useWiFi && CommsManagerState.wifiOnline)
         {
             Serial.println("SendData: Attempting WiFi (no preferred)...");
-            send_result = sendDataViaWiFi(data, _pin, url);
+            send_result = sendDataViaWiFi(data, data_length, content_type, content_encoding, _pin, url);
             if (send_result)
                 return true;
             CommsManagerState.wifiFailCount++;
@@ -1105,7 +1662,7 @@ bool sendData(const char *data, const int _pin, const char *url)
         if (DeviceConfig.useGSM && CommsManagerState.gsmOnline)
         {
             Serial.println("SendData: Attempting GSM (no preferred)...");
-            send_result = sendDataViaGSM(data, _pin, url);
+            send_result = sendDataViaGSM(data, data_length, content_type, content_encoding, _pin, url);
             if (send_result)
                 return true;
             CommsManagerState.gsmFailCount++;
@@ -1121,6 +1678,13 @@ bool sendData(const char *data, const int _pin, const char *url)
     return send_result;
 }
 
+
+/// @brief Send a JSON payload, see sendData() above
+bool sendData(const char *data, const int _pin, const char *url)
+{
+    return sendData(data, strlen(data), "application/json", _pin, url);
+}
+
 void init_memory_loggers()
 {
     // Initialize memory loggers
@@ -1158,23 +1722,28 @@ void init_SD_loggers()
         createDir(SD, sensors_data_parent_dir); // Create testing directory "/ESP_CHIP_ID/SENSORSDATA/TESTING"
     }
 
-    bool use_testing_failed_store = shouldUseTestingDataDir();
-    char failed_send_payloads_parent_dir[128] = {};
-
+    // Retry stores per endpoint: production in SENSORSDATA/, staging in SENSORSDATA/TESTING/
+    bool use_testing_failed_store = shouldUseTestingDataDir() || DeviceConfig.fan_out;
+    char staging_failed_send_payloads_dir[128] = {};
+    snprintf(staging_failed_send_payloads_dir, sizeof(staging_failed_send_payloads_dir), "%s%s", sensors_data_root_dir, TESTING_SENSORS_DATA_DIR);
     if (use_testing_failed_store)
     {
-        snprintf(failed_send_payloads_parent_dir, sizeof(failed_send_payloads_parent_dir), "%s%s", sensors_data_root_dir, TESTING_SENSORS_DATA_DIR);
-        createDir(SD, failed_send_payloads_parent_dir);
+        createDir(SD, staging_failed_send_payloads_dir);
     }
-    else
+
+    // Init failed-payload paths before the calendar check so retry storage follows the runtime live/testing state.
+    const char *failed_send_payloads_dirs[UPLOAD_TARGET_COUNT] = {};
+    failed_send_payloads_dirs[UPLOAD_STAGING] = staging_failed_send_payloads_dir;
+    failed_send_payloads_dirs[UPLOAD_PRODUCTION] = sensors_data_root_dir;
+    for (uint8_t t = 0; t < UPLOAD_TARGET_COUNT; t++)
     {
-        strcpy(failed_send_payloads_parent_dir, sensors_data_root_dir);
+        UploadTarget &target = UploadTargets[t];
+        snprintf(target.failed_payloads_path, sizeof(target.failed_payloads_path), "%s/%s",
+                 failed_send_payloads_dirs[t], SENSORS_FAILED_DATA_SEND_STORE_FILE);
+        snprintf(target.failed_records_path, sizeof(target.failed_records_path), "%s/%s",
+                 failed_send_payloads_dirs[t], SENSORS_FAILED_RECORDS_STORE_FILE);
     }
 
-    // Init failed-payload path before the calendar check so retry storage follows the runtime live/testing state.
-    snprintf(SENSORS_FAILED_DATA_SEND_STORE_PATH, sizeof(SENSORS_FAILED_DATA_SEND_STORE_PATH), "%s/%s",
-             failed_send_payloads_parent_dir, SENSORS_FAILED_DATA_SEND_STORE_FILE);
-
     if (current_year != 0 && current_month != 0)
     {
         char _year[5] = {};
@@ -1210,7 +1779,7 @@ void init_SD_loggers()
 
     // write files to SD
     // writeFile(SD, SENSORS_JSON_DATA_PATH, "");                   // create file if it does not exist
-    // writeFile(SD, SENSORS_FAILED_DATA_SEND_STORE_PATH, ""); // create file if it does not exist
+    // writeFile(SD, UploadTargets[UPLOAD_PRODUCTION].failed_payloads_path, ""); // create file if it does not exist
 
     // Debug runtime logger;
 }
@@ -1290,16 +1859,19 @@ void getMonthName(int month_num, char *month)
 }
 
 /// @brief : Read data from SD card and send it to the server
-/// @param datafile : file name to read from
+/// @param target : endpoint whose retry store (failed_send_payloads.txt) is read and sent to
 /// @return : void
 /// @note : The function will read the data from the file and send it to the server. If the send fails, the data will be appended to a temporary file for later sending.
 /// @note : The function will also update the file contents to remove the data that was sent successfully.
-void readSendDelete(const char *datafile)
+void readSendDelete(UploadTarget &target)
 {
     String data;
+    const char *datafile = target.failed_payloads_path;
     const char *tempFile = "/temp_sensor_payload.txt";
+    bool batching = DeviceConfig.batch_upload;
+    UploadBatch batch(batch_body, sizeof(batch_body), DeviceConfig.batch_max_records, DeviceConfig.batch_max_bytes);
 
-    Serial.println("Attempting to send data that previoudly failed to send.");
+    Serial.printf("Attempting to send data that previoudly failed to send to %s.\n", target.name);
 
     int next_byte = -1;
     int next_line_index = 0;
@@ -1315,32 +1887,33 @@ void readSendDelete(const char *datafile)
             Serial.println("End of file read");
         }
 
-        if (!validateJson(data.c_str()))
-        {
-            Serial.println("Invalid JSON data: " + data);
-            continue;
-        }
-
         if (data != "")
         {
-            JsonDocument doc;
-            deserializeJson(doc, data);        // Extract API_PIN from the JSON data
-            int api_pin = doc["API_PIN"] | -1; // Default to -1 if not found
+            int api_pin = payloadApiPin(data.c_str(), data.length()); // the line is sent as it is, not parsed
 
             if (api_pin == -1)
             {
-                Serial.println("API_PIN not found in JSON data ");
+                Serial.println("Not a complete payload with API_PIN: " + data);
                 continue; // Skip this data if API_PIN is not found
             }
             // Attempt send payload
             // Serial.println("Attempting to send data from SD card: " + data);
-            if (!sendData(data.c_str(), api_pin, DeviceConfig.active_api_url))
+            if (batching)
+            {
+                uploadBatched(batch, data.c_str(), api_pin, target, tempFile);
+            }
+            else if (sendData(data.c_str(), api_pin, target.url))
+            {
+                target.sent++;
+            }
+            else
             {
                 // store data in temp file
-                appendFile(SD, tempFile, data.c_str(), true);
+                storeFailedPayload(target, tempFile, data.c_str(), data.length());
             }
         }
     } while (next_byte != -1);
+    sendBatch(batch, target, tempFile);
 
     updateFileContents(SD, datafile, tempFile);
 
@@ -1348,6 +1921,295 @@ void readSendDelete(const char *datafile)
     closeFile(SD, datafile);
 }
 
+/// @brief : Read CBOR sample records from SD card and send them to the server
+/// @param target : endpoint whose binary backlog (failed_send_records.cbor) is read and sent to
+/// @return : void
+/// @note : Counterpart of readSendDelete() for the binary backlog. Records that fail again are kept; a file that
+///         does not exist is skipped.
+void readSendDeleteRecords(UploadTarget &target)
+{
+    const char *datafile = target.failed_records_path;
+    if (!SD.exists(datafile))
+        return;
+    File file = SD.open(datafile);
+    if (!file)
+    {
+        Serial.println("Failed to open record file");
+        return;
+    }
+    const char *tempFile = "/temp_sensor_records.cbor";
+    Serial.printf("Attempting to send records that previously failed to send to %s.\n", target.name);
+
+    uint8_t buf[SAMPLE_RECORD_MAX_SIZE];
+    size_t len = 0;
+    while (true)
+    {
+        len += file.read(buf + len, sizeof(buf) - len);
+        if (len == 0) // End of file reached
+            break;
+
+        SampleRecord record;
+        size_t used = decodeSampleRecord(buf, len, record);
+        if (used == 0)
+        {
+            // torn write or unknown record, resynchronise on the next byte
+            Serial.println("Invalid sample record, skipping a byte");
+            used = 1;
+        }
+        else if (sendSampleRecord(record, buf, used, target.url))
+        {
+            target.sent++;
+        }
+        else
+        {
+            appendFileBytes(SD, tempFile, buf, used);
+            target.stored++;
+        }
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+    file.close();
+
+    updateFileContents(SD, datafile, tempFile);
+}
+
+/// @brief Copy of a sample record stored by memoryDataLog() or queueOffline()
+/// @param stored : the log record's bytes, not aligned for SampleRecord
+SampleRecord storedSample(const char *stored)
+{
+    SampleRecord record;
+    memcpy(&record, stored, sizeof(record));
+    return record;
+}
+
+/// @brief Render the JSON push payload of a sample record
+/// @return length written excluding the terminator; 0 if it does not fit
+size_t renderSamplePayload(char *buf, size_t size, const SampleRecord &record)
+{
+    char datetime[32];
+    formatISO8601(datetime, sizeof(datetime), record.time);
+    return generateJSON_payload(buf, record.sensor, record.values, datetime, size) ? strlen(buf) : 0;
+}
+
+/// @brief Render the CSV rows of a sample record, one per value
+/// @return false if they do not all fit
+bool renderSampleRows(char *buf, size_t size, const SampleRecord &record)
+{
+    if (record.sensor >= SENSOR_COUNT)
+        return false;
+    char datetime[32];
+    formatISO8601(datetime, sizeof(datetime), record.time);
+    const SensorDescriptor &sensor = SENSOR_REGISTRY[record.sensor];
+    CsvWriter csv(buf, size);
+    for (uint8_t i = 0; i < sensor.value_count; i++)
+    {
+        if (!generateCSV_row(csv, datetime, sensor, i, record.values[i]))
+            return false;
+    }
+    return true;
+}
+
+/// @brief Send a sample record, as application/cbor if DeviceConfig.cbor_uplink is set and as the JSON payload otherwise
+/// @param cbor : the record as encoded by encodeSampleRecord(), sent as it is
+/// @return true if the record was sent
+bool sendSampleRecord(const SampleRecord &record, const uint8_t *cbor, size_t cbor_length, const char *url)
+{
+    const SensorDescriptor &sensor = SENSOR_REGISTRY[record.sensor];
+    if (DeviceConfig.cbor_uplink)
+        return sendData((const char *)cbor, cbor_length, "application/cbor", sensor.api_pin, url);
+
+    char datetime[32];
+    char payload[LOGGER::ENTRY_SIZE];
+    formatISO8601(datetime, sizeof(datetime), record.time);
+    return generateJSON_payload(payload, record.sensor, record.values, datetime, sizeof(payload)) &&
+           sendData(payload, sensor.api_pin, url);
+}
+
+/// @brief Append an encoded sample record to the binary backlog of target on the SD card
+void storeFailedRecord(UploadTarget &target, const uint8_t *cbor, size_t cbor_length)
+{
+    appendFileBytes(SD, target.failed_records_path, cbor, cbor_length);
+    target.stored++;
+}
+
+/// @brief Keep a JSON payload that failed to send to target for a later attempt
+/// @param retry_file : payload file to append the line to; nullptr for the target's payload retry store
+void storeFailedPayload(UploadTarget &target, const char *retry_file, const char *payload, size_t length)
+{
+    appendFileBytes(SD, retry_file ? retry_file : target.failed_payloads_path, (const uint8_t *)payload, length, true);
+    target.stored++;
+}
+
+/// @brief Keep a sample record that failed to send to target for a later attempt
+/// @param retry_file : payload file to append its JSON payload to; nullptr for the target's retry store, which is the
+///                     binary backlog if DeviceConfig.binary_backlog is set
+void storeFailedSample(UploadTarget &target, const char *retry_file, const SampleRecord &record)
+{
+    if (!retry_file && DeviceConfig.binary_backlog)
+    {
+        uint8_t cbor[SAMPLE_RECORD_MAX_SIZE];
+        size_t cbor_length = encodeSampleRecord(cbor, sizeof(cbor), record);
+        if (cbor_length > 0)
+        {
+            storeFailedRecord(target, cbor, cbor_length);
+            return;
+        }
+    }
+    char payload[LOGGER::ENTRY_SIZE];
+    size_t length = renderSamplePayload(payload, sizeof(payload), record);
+    if (length > 0)
+        storeFailedPayload(target, retry_file, payload, length);
+}
+
+/// @brief Keep batch payload i for a later attempt, as a binary record if it was rendered from one and the target's
+///        retry store is the binary backlog
+static void storeFailedBatchRecord(const UploadBatch &batch, uint8_t i, UploadTarget &target, const char *retry_file)
+{
+    if (batch.recordSource(i) && !retry_file && DeviceConfig.binary_backlog)
+        storeFailedSample(target, retry_file, storedSample(batch.recordSource(i)));
+    else
+        storeFailedPayload(target, retry_file, batch.record(i), batch.recordLength(i));
+}
+
+/// @brief Upload target of an endpoint URL; DeviceConfig.active_api_url is the target isLive selects (also when staging
+///        and production share the URL), any URL other than DeviceConfig.staging_url is treated as production
+UploadTarget &uploadTargetFor(const char *url)
+{
+    if (strcmp(url, DeviceConfig.active_api_url) == 0)
+        return UploadTargets[DeviceConfig.isLive ? UPLOAD_PRODUCTION : UPLOAD_STAGING];
+    if (strcmp(url, DeviceConfig.staging_url) == 0)
+        return UploadTargets[UPLOAD_STAGING];
+    return UploadTargets[UPLOAD_PRODUCTION];
+}
+
+/// @brief Targets to send to: the one of DeviceConfig.active_api_url, or production and staging with DeviceConfig.fan_out
+/// @return number of targets written to targets
+uint8_t uploadTargets(UploadTarget *targets[UPLOAD_TARGET_COUNT])
+{
+    if (!DeviceConfig.fan_out || strcmp(DeviceConfig.staging_url, DeviceConfig.production_url) == 0)
+    {
+        targets[0] = &uploadTargetFor(DeviceConfig.active_api_url);
+        return 1;
+    }
+    targets[0] = &UploadTargets[UPLOAD_PRODUCTION];
+    targets[1] = &UploadTargets[UPLOAD_STAGING];
+    return 2;
+}
+
+/// @brief Statuses of an endpoint that does not take JSON arrays, or not this large a body
+static bool isBatchRejection(int status)
+{
+    return status == 400 || status == 404 || status == 405 || status == 411 || status == 413 || status == 415 || status == 422;
+}
+
+/**
+    @brief Send a batch to target, then clear it
+    @param retry_file : payload file for records that could not be sent, nullptr for the target's retry store; see
+                        storeFailedPayload()
+    @note : A batch the endpoint rejects is sent again record by record, and batches stay off for that endpoint until
+            restart; only the records that fail on their own are stored. If the batch fails for any other reason (no
+            connection, server error) all its records are stored.
+**/
+void sendBatch(UploadBatch &batch, UploadTarget &target, const char *retry_file)
+{
+    if (batch.empty())
+        return;
+
+    if (batch.count > 1 && !target.batch_rejected)
+    {
+        size_t length = batch.finish();
+        Serial.printf("SendData: batch of %u payloads, %u bytes\n", batch.count, (unsigned)length);
+        if (sendData(batch.body(), length, "application/json", 0, target.url))
+        {
+            target.sent += batch.count;
+            batch.clear();
+            return;
+        }
+        if (!isBatchRejection(LastHTTPStatus))
+        {
+            for (uint8_t i = 0; i < batch.count; i++)
+                storeFailedBatchRecord(batch, i, target, retry_file);
+            batch.clear();
+            return;
+        }
+        Serial.printf("SendData: %s rejected the batch with HTTP %d, sending payloads one by one\n", target.name, LastHTTPStatus);
+        target.batch_rejected = true;
+    }
+
+    for (uint8_t i = 0; i < batch.count; i++)
+    {
+        if (sendData(batch.record(i), batch.recordLength(i), "application/json", batch.recordPin(i), target.url))
+            target.sent++;
+        else
+            storeFailedBatchRecord(batch, i, target, retry_file);
+    }
+    batch.clear();
+}
+
+/// @brief Add a JSON payload to batch, sending the batch to target first when the payload does not fit any more
+/// @param source : stored sample record the payload was rendered from, see storedSample(); nullptr for a payload line
+void uploadBatched(UploadBatch &batch, const char *payload, uint8_t api_pin, UploadTarget &target, const char *retry_file,
+                   const char *source)
+{
+    size_t length = strlen(payload);
+    if (batch.add(payload, length, api_pin, source))
+        return;
+    sendBatch(batch, target, retry_file);
+    if (batch.add(payload, length, api_pin, source))
+        return;
+
+    // larger than a whole batch body
+    if (sendData(payload, length, "application/json", api_pin, target.url))
+        target.sent++;
+    else if (source)
+        storeFailedSample(target, retry_file, storedSample(source));
+    else
+        storeFailedPayload(target, retry_file, payload, length);
+}
+
+/**
+    @brief Send a stored sample record to target, rendered the way the endpoint takes it
+    @param stored : record bytes in a memory logger or the offline queue, see storedSample()
+    @note : With cborUplink the record goes out as application/cbor, when batching its JSON payload is added to batch,
+            otherwise the JSON payload is posted on its own. A record that is not sent goes to the target's retry store.
+**/
+void uploadSample(const char *stored, UploadTarget &target, UploadBatch &batch, bool batching)
+{
+    SampleRecord record = storedSample(stored);
+    if (record.sensor >= SENSOR_COUNT)
+        return;
+    const SensorDescriptor &sensor = SENSOR_REGISTRY[record.sensor];
+
+    bool sent;
+    if (DeviceConfig.cbor_uplink)
+    {
+        uint8_t cbor[SAMPLE_RECORD_MAX_SIZE];
+        size_t cbor_length = encodeSampleRecord(cbor, sizeof(cbor), record);
+        sent = cbor_length > 0 && sendData((const char *)cbor, cbor_length, "application/cbor", sensor.api_pin, target.url);
+    }
+    else
+    {
+        char payload[LOGGER::ENTRY_SIZE];
+        size_t length = renderSamplePayload(payload, sizeof(payload), record);
+        if (length == 0)
+        {
+            Serial.printf("%s payload does not fit in %u bytes, not sent\n", sensor.sensor_type, (unsigned)sizeof(payload));
+            return;
+        }
+        if (batching)
+        {
+            uploadBatched(batch, payload, sensor.api_pin, target, nullptr, stored);
+            return;
+        }
+        sent = sendData(payload, length, "application/json", sensor.api_pin, target.url);
+    }
+    // Otherwise keep it for sending later // ToDo: Check the state of DeviceConfigState.sdCardInitialized before attempting to write to SD card
+    if (sent)
+        target.sent++;
+    else
+        storeFailedSample(target, nullptr, record);
+}
+
 void updateCalendarFromRTC()
 {
     bool calendarUpdated = false;
@@ -1397,18 +2259,18 @@ void initCalender(int year, int month)
 /**
     @brief Log data to memory
     @param logger : logger to log the data to
-    @param data : data to log
+    @param record : reading to log, kept as it is until it is sent or written to a file
     @return : void
-    @note : The function will log the data to the logger. If the logger is full, it will append the data to a file.
+    @note : The function will log the data to the logger. If the JSON logger is full while no link is up, its records
+            move to the offline queue (if there is one); otherwise the logger is appended to a file.
 **/
-void memoryDataLog(LOGGER &logger, const char *data)
+void memoryDataLog(LOGGER &logger, const SampleRecord &record)
 {
+    const char *data = (const char *)&record;
 
-    if (logger.log_count < logger.MAX_ENTRIES)
+    if (logger.DATA_STORE.push(data, sizeof(record)))
     {
-        strcpy(logger.DATA_STORE[logger.log_count], data);
-        Serial.println("Logged data: " + String(logger.DATA_STORE[logger.log_count]));
-        logger.log_count++;
+        Serial.printf("Logged %s sample to %s logger\n", SENSOR_REGISTRY[record.sensor].sensor_type, logger.name);
     }
     else
     {
@@ -1416,16 +2278,30 @@ void memoryDataLog(LOGGER &logger, const char *data)
         switch (logger.type)
         {
         case DATA_LOGGERS::JSON:
-            // Append to JSON file
-            fileDataLog(logger);
+            if (OfflineQueue.enabled() && CommsManagerState.preferredComm == CommsManagerState.PreferredComm::NONE)
+            {
+                // no link: wait in PSRAM for one instead of going to the SD card
+                queueOffline(logger);
+                resetLogger(logger);
+                logger.DATA_STORE.push(data, sizeof(record));
+            }
+            else
+            {
+                // Append to JSON file
+                fileDataLog(logger);
+            }
             send_now = true;
             break;
         case DATA_LOGGERS::CSV:
             fileDataLog(logger);
             resetLogger(logger);
+            // keep the new entry
+            logger.DATA_STORE.push(data, sizeof(record));
             break;
         }
     }
+    if (logger.type == DATA_LOGGERS::JSON)
+        checkpointQueue(false);
 }
 
 /**
@@ -1438,11 +2314,16 @@ void fileDataLog(LOGGER &logger)
 {
     refreshLoggerPath(logger);
     Serial.println("Logging data to file: " + String(logger.path));
-    for (int i = 0; i < logger.MAX_ENTRIES; i++)
-    {
-        if (strlen(logger.DATA_STORE[i]) != 0)
+    // rendered here, the loggers keep sample records
+    char text[LOGGER::ENTRY_SIZE];
+    for (LogRecord stored : logger.DATA_STORE)
+    {
+        SampleRecord record = storedSample(stored.data);
+        bool rendered = logger.type == DATA_LOGGERS::JSON ? renderSamplePayload(text, sizeof(text), record) > 0
+                                                          : renderSampleRows(text, sizeof(text), record);
+        if (rendered)
         {
-            appendFile(SD, logger.path, logger.DATA_STORE[i]);
+            appendFile(SD, logger.path, text);
         }
     }
 }
@@ -1451,12 +2332,165 @@ void fileDataLog(LOGGER &logger)
     @brief Reset logger
     @param logger : logger to reset
     @return : void
-    @note : The function will reset the logger. It will clear the data store and set the log count to 0.
+    @note : The function will reset the logger. It will clear the data store.
 **/
 void resetLogger(LOGGER &logger)
 {
-    logger.log_count = 0;
-    memset(logger.DATA_STORE, 0, sizeof(logger.DATA_STORE));
+    logger.DATA_STORE.clear();
+}
+
+/// @brief Move the records of a memory logger to the offline queue; a full queue is written to the SD card first
+void queueOffline(LOGGER &logger)
+{
+    if (OfflineQueue.records.empty())
+        OfflineQueue.queuedSince = millis();
+    for (LogRecord record : logger.DATA_STORE)
+    {
+        if (OfflineQueue.records.push(record.data, record.length))
+            continue;
+        spillOfflineQueue();
+        OfflineQueue.records.push(record.data, record.length);
+    }
+    Serial.printf("Offline queue: %u records, %u of %u bytes\n", (unsigned)OfflineQueue.records.size(),
+                  (unsigned)OfflineQueue.records.bytesUsed(), (unsigned)OfflineQueue.records.capacity());
+}
+
+/// @brief Write the offline queue to the retry stores of the upload targets and empty it
+void spillOfflineQueue()
+{
+    UploadTarget *targets[UPLOAD_TARGET_COUNT];
+    uint8_t target_count = uploadTargets(targets);
+    Serial.printf("Offline queue: writing %u records to the SD card\n", (unsigned)OfflineQueue.records.size());
+    for (LogRecord stored : OfflineQueue.records)
+    {
+        SampleRecord record = storedSample(stored.data);
+        for (uint8_t t = 0; t < target_count; t++)
+            storeFailedSample(*targets[t], nullptr, record);
+        OfflineQueue.spilled++;
+    }
+    OfflineQueue.records.clear();
+}
+
+/// @brief Copy the JSON memory logger to RTC memory, and to LittleFS with to_flash
+void checkpointQueue(bool to_flash)
+{
+    if (!PendingQueueImage.capture(JSON_PAYLOAD_LOGGER.DATA_STORE))
+        Serial.println("Queue checkpoint: the memory logger holds more than sample records, checkpoint left empty");
+    QueueCheckpointState.saved++;
+    QueueCheckpointState.flashStale = true;
+    if (to_flash)
+        saveQueueCheckpoint();
+}
+
+/// @brief Write the RTC checkpoint to LittleFS; an empty checkpoint removes the file
+void saveQueueCheckpoint()
+{
+    if (PendingQueueImage.count == 0)
+    {
+        if (LittleFS.exists(QUEUE_CHECKPOINT_PATH))
+            LittleFS.remove(QUEUE_CHECKPOINT_PATH);
+    }
+    else
+    {
+        File file = LittleFS.open(QUEUE_CHECKPOINT_PATH, "w");
+        size_t length = PendingQueueImage.bytes();
+        if (!file || file.write((const uint8_t *)&PendingQueueImage, length) != length)
+            Serial.println("Queue checkpoint: failed to write " QUEUE_CHECKPOINT_PATH);
+        if (file)
+            file.close();
+    }
+    QueueCheckpointState.flashStale = false;
+    QueueCheckpointState.flashSavedAt = millis();
+    QueueCheckpointState.flashSaved++;
+}
+
+/**
+    @brief Put the JSON memory logger of the previous run back, from RTC memory or else from the LittleFS copy
+    @note : Called in setup() once LittleFS is mounted and before sampling starts. The RTC image is the latest state after
+            any restart that kept the power on; the file covers a power loss and is at most QUEUE_CHECKPOINT_FLASH_MS old.
+**/
+void restoreQueueCheckpoint()
+{
+    unsigned long started = micros();
+    if (PendingQueueImage.valid())
+    {
+        QueueCheckpointState.restoredFrom = "rtc";
+    }
+    else if (LittleFS.exists(QUEUE_CHECKPOINT_PATH))
+    {
+        // read into the RTC image, which holds nothing usable
+        File file = LittleFS.open(QUEUE_CHECKPOINT_PATH, "r");
+        size_t length = file ? file.read((uint8_t *)&PendingQueueImage, sizeof(PendingQueueImage)) : 0;
+        if (file)
+            file.close();
+        if (PendingQueueImage.valid() && length == PendingQueueImage.bytes())
+            QueueCheckpointState.restoredFrom = "flash";
+        else
+            Serial.println("Queue checkpoint: " QUEUE_CHECKPOINT_PATH " is not a valid checkpoint, ignored");
+    }
+
+    if (strcmp(QueueCheckpointState.restoredFrom, "none") != 0)
+        QueueCheckpointState.restored = PendingQueueImage.restore(JSON_PAYLOAD_LOGGER.DATA_STORE);
+    checkpointQueue(false);
+    // the file matches unless the RTC image was newer
+    QueueCheckpointState.flashStale = strcmp(QueueCheckpointState.restoredFrom, "rtc") == 0;
+    QueueCheckpointState.restoreUs = micros() - started;
+    Serial.printf("Queue checkpoint: %u records restored from %s in %lu us\n", QueueCheckpointState.restored,
+                  QueueCheckpointState.restoredFrom, (unsigned long)QueueCheckpointState.restoreUs);
+}
+
+/**
+    @brief Restart the device without losing the readings that are not sent yet
+    @note : Finished cycles are taken from the sample queue first. The JSON memory logger is checkpointed to RTC memory
+            and LittleFS and restored by setup(). The CSV logger is
+            written to its file and the PSRAM offline queue to the retry stores, as neither survives the restart.
+**/
+void restartDevice(const char *reason)
+{
+    Serial.printf("Restarting (%s)...\n", reason);
+    drainSampleQueue();
+    checkpointQueue(true);
+    if (SD_Attached)
+    {
+        if (!CSV_PAYLOAD_LOGGER.DATA_STORE.empty())
+        {
+            fileDataLog(CSV_PAYLOAD_LOGGER);
+            resetLogger(CSV_PAYLOAD_LOGGER);
+        }
+        if (!OfflineQueue.records.empty())
+            spillOfflineQueue();
+    }
+    ESP.restart();
+}
+
+/// @brief Send the offline queue to the targets, oldest payload first; the queue is empty afterwards
+/// @details A target that stops answering gets the rest of the queue in its retry store without further requests.
+void sendOfflineQueue(UploadTarget *targets[], uint8_t target_count)
+{
+    if (OfflineQueue.records.empty())
+        return;
+    Serial.printf("Sending %u readings queued while offline\n", (unsigned)OfflineQueue.records.size());
+    bool batching = DeviceConfig.batch_upload && !DeviceConfig.cbor_uplink;
+
+    for (uint8_t t = 0; t < target_count; t++)
+    {
+        UploadTarget &target = *targets[t];
+        UploadBatch batch(batch_body, sizeof(batch_body), DeviceConfig.batch_max_records, DeviceConfig.batch_max_bytes);
+        bool answering = true;
+        for (LogRecord stored : OfflineQueue.records)
+        {
+            if (!answering)
+            {
+                storeFailedSample(target, nullptr, storedSample(stored.data));
+                continue;
+            }
+            uint32_t kept = target.stored;
+            uploadSample(stored.data, target, batch, batching);
+            answering = target.stored == kept || LastHTTPStatus != 0;
+        }
+        sendBatch(batch, target, nullptr);
+    }
+    OfflineQueue.records.clear();
 }
 
 /**
@@ -1467,29 +2501,70 @@ void resetLogger(LOGGER &logger)
 **/
 void sendFromMemoryLog(LOGGER &logger)
 {
-    for (int i = 0; i < logger.log_count; i++)
+    UploadTarget *targets[UPLOAD_TARGET_COUNT];
+    uint8_t target_count = uploadTargets(targets);
+    sendOfflineQueue(targets, target_count); // older than the memory log
+    // CBOR records go out one per request
+    bool batching = DeviceConfig.batch_upload && !DeviceConfig.cbor_uplink;
+
+    Timestamp now = captureTimestamp();
+    if (now.isSet())
+        Aggregator.closeDue(now.epoch);
+
+    // One endpoint after the other, so each one's connection / modem session is reused for all its requests. The
+    // records are rendered for each endpoint as they go out; nothing is parsed.
+    for (uint8_t t = 0; t < target_count; t++)
+    {
+        UploadTarget &target = *targets[t];
+        UploadBatch batch(batch_body, sizeof(batch_body), DeviceConfig.batch_max_records, DeviceConfig.batch_max_bytes);
+        for (LogRecord stored : logger.DATA_STORE)
+            uploadSample(stored.data, target, batch, batching);
+        sendAggregates(batch, target);
+        sendBatch(batch, target, nullptr);
+    }
+    while (Aggregator.peek())
+        Aggregator.pop();
+
+    resetLogger(logger);
+    checkpointQueue(true); // sent records must not come back after a power loss
+}
+
+/// @brief Whether readings are uploaded as window aggregates (DeviceConfig.aggregation) rather than one by one
+bool aggregateUplink()
+{
+    switch (DeviceConfig.aggregation)
     {
-        if (strlen(logger.DATA_STORE[i]) != 0)
-        {
-            JsonDocument doc;
-            deserializeJson(doc, logger.DATA_STORE[i]); // Extract API_PIN from the JSON data
-            int api_pin = doc["API_PIN"] | -1;
-            if (api_pin != -1)
-            {
-                if (!sendData(logger.DATA_STORE[i], api_pin, DeviceConfig.active_api_url))
-                {
-                    // Append to file for sending later // ToDo: Check the state of DeviceConfigState.sdCardInitialized before attempting to write to SD card
-                    appendFile(SD, SENSORS_FAILED_DATA_SEND_STORE_PATH, logger.DATA_STORE[i]);
-                }
-            }
+    case AGGREGATION_ALWAYS:
+        return true;
+    case AGGREGATION_GSM:
+        return CommsManagerState.preferredComm == CommsManagerState.PreferredComm::GSM;
+    default:
+        return false;
+    }
+}
 
-            memset(logger.DATA_STORE[i], '\0', 255);
+/// @brief Send the queued window aggregates to a target, in the batch when batching; failures go to its retry store
+/// @details The results stay queued, sendFromMemoryLog() drops them once every target had them.
+void sendAggregates(UploadBatch &batch, UploadTarget &target)
+{
+    bool batching = DeviceConfig.batch_upload && !DeviceConfig.cbor_uplink;
+    for (uint8_t i = 0; i < Aggregator.pending; i++)
+    {
+        const AggregateResult &result = Aggregator.at(i);
+        size_t length = renderAggregatePayload(aggregate_body, sizeof(aggregate_body), result);
+        if (length == 0)
+        {
+            Serial.println("Aggregate payload does not fit, not sent");
+            continue;
         }
+        uint8_t api_pin = SENSOR_REGISTRY[result.sensor].api_pin;
+        if (batching)
+            uploadBatched(batch, aggregate_body, api_pin, target, nullptr);
+        else if (sendData(aggregate_body, length, "application/json", api_pin, target.url))
+            target.sent++;
+        else
+            storeFailedPayload(target, nullptr, aggregate_body, length);
     }
-    logger.log_count = 0;
-
-    //? call resetLogger(logger) to reset the logger
-    //? or just clear the memory
 }
 
 // Get current sensor data;
@@ -1522,9 +2597,11 @@ void configDeviceFromWiFiConn()
         // synchronise system clock over NTP
         configTime(0, 0, "pool.ntp.org", "time.nist.gov");
         time_t now = time(nullptr);
+        xSemaphoreTake(TimeLock, portMAX_DELAY);
         RTC.setTime(now);
-        initCalender(RTC.getYear(), RTC.getMonth() + 1);
         DeviceConfigState.timeSet = true;
+        xSemaphoreGive(TimeLock);
+        initCalender(RTC.getYear(), RTC.getMonth() + 1);
     }
 }
 
@@ -1610,10 +2687,16 @@ void initializeAndConfigGSM()
         {
             // Update RTC time and calendar
             Serial.println("GSM Network Time: " + String(time_buff));
-            esp_datetime_tz = extractDateTime(String(time_buff));
-            RTC.setTime(esp_datetime_tz.timestamp);
-            initCalender(RTC.getYear(), RTC.getMonth() + 1);
-            DeviceConfigState.timeSet = true;
+            struct datetimetz network_time = extractDateTime(time_buff);
+            if (network_time.timestamp != 0)
+            {
+                xSemaphoreTake(TimeLock, portMAX_DELAY);
+                esp_datetime_tz = network_time;
+                RTC.setTime(network_time.timestamp);
+                DeviceConfigState.timeSet = true;
+                xSemaphoreGive(TimeLock);
+                initCalender(RTC.getYear(), RTC.getMonth() + 1);
+            }
         }
         else
         {
@@ -2094,8 +3177,7 @@ void listenSerial()
 
         if (command == "restart")
         {
-            Serial.println("Restarting device...");
-            ESP.restart();
+            restartDevice("serial command");
         }
         else if (command == "sendNow")
         {
@@ -2114,6 +3196,43 @@ void listenSerial()
     }
 }
 
+/// @brief Add the DHT and PMS read counters to the telemetry payload
+/// @param errors : object to fill; only status codes that occurred are listed
+/// @param sampling : counters last published by the sampling task
+void addSensorErrorTelemetry(JsonObject errors, const SamplingTelemetry &sampling)
+{
+    static const char *const dht_status[10] = {"ok", "checksum", "timeout_a", "bit_shift", "not_ready",
+                                               "timeout_c", "timeout_d", "timeout_b", "waiting_for_read", "other"};
+    static const char *const pms_status[9] = {"ok", "timeout", "pms_type", "msg_unknown", "msg_header",
+                                              "msg_body", "msg_start", "msg_length", "msg_cksum"};
+
+    JsonObject dht_errors = errors["DHT"].to<JsonObject>();
+    dht_errors["reads"] = sampling.dht.reads;
+    dht_errors["retries"] = sampling.dht.retries;
+    dht_errors["recovered"] = sampling.dht.recovered;
+    dht_errors["lost_samples"] = sampling.dht.lostSamples;
+    JsonObject dht_codes = dht_errors["status"].to<JsonObject>();
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        if (sampling.dht.counts[i])
+            dht_codes[dht_status[i]] = sampling.dht.counts[i];
+    }
+
+    JsonObject pms_errors = errors["PMS"].to<JsonObject>();
+    pms_errors["reads"] = sampling.pms.reads;
+    pms_errors["burst_retries"] = sampling.pms.retries;
+    pms_errors["recovered"] = sampling.pms.recovered;
+    pms_errors["lost_samples"] = sampling.pms.lostSamples;
+    pms_errors["parser_cksum"] = sampling.parserCksumErrors;
+    pms_errors["parser_length"] = sampling.parserLengthErrors;
+    JsonObject pms_codes = pms_errors["status"].to<JsonObject>();
+    for (uint8_t i = 0; i < 9; i++)
+    {
+        if (sampling.pms.counts[i])
+            pms_codes[pms_status[i]] = sampling.pms.counts[i];
+    }
+}
+
 /// @brief Build MQTT telemetry JSON payload with device, GSM, WiFi, and sensor information
 /// @param mqtt_payload Buffer to store the JSON payload
 /// @param payload_size Size of the payload buffer
@@ -2124,8 +3243,14 @@ bool buildMQTTTelemetryPayload(char *mqtt_payload, size_t payload_size)
     {
         JsonDocument telemetry_doc;
 
+        // the sampling task owns the sensors and their counters: report its last published copy
+        xSemaphoreTake(SamplingLock, portMAX_DELAY);
+        SamplingTelemetry sampling_state = SamplingSnapshot;
+        xSemaphoreGive(SamplingLock);
+
         // Timestamp
-        String datetime = getRTCdatetimetz(ISO_time_format, esp_datetime_tz.timezone);
+        char datetime[32];
+        formatISO8601(datetime, sizeof(datetime), captureTimestamp());
         telemetry_doc["timestamp"] = datetime;
 
         telemetry_doc["device_id"] = esp_chipid;
@@ -2164,8 +3289,15 @@ bool buildMQTTTelemetryPayload(char *mqtt_payload, size_t payload_size)
         config["power_saving_mode"] = DeviceConfig.power_saving_mode;
         config["wifi_enabled"] = DeviceConfig.useWiFi;
         config["gsm_enabled"] = DeviceConfig.useGSM;
-        config["sampling_interval_ms"] = sampling_interval;
+        config["sampling_interval_ms"] = sampling_interval.load();
         config["sending_interval_ms"] = sending_intervall_ms;
+        JsonObject sampling = config["adaptive_sampling"].to<JsonObject>();
+        sampling["enabled"] = sampling_state.scheduler.enabled;
+        sampling["min_ms"] = sampling_state.scheduler.minMs;
+        sampling["max_ms"] = sampling_state.scheduler.maxMs;
+        sampling["pm25_rate"] = sampling_state.scheduler.lastRate;
+        sampling["last_reason"] = AdaptiveSampler::reasonName(sampling_state.scheduler.lastReason);
+        sampling["changes"] = sampling_state.scheduler.changes;
 
         // Communication Status
         JsonObject comms = telemetry_doc["communications"].to<JsonObject>();
@@ -2180,14 +3312,83 @@ bool buildMQTTTelemetryPayload(char *mqtt_payload, size_t payload_size)
         system["uptime_ms"] = millis();
         system["free_heap"] = ESP.getFreeHeap();
         system["data_sends_count"] = count_sends;
-        system["data_points_logged"] = JSON_PAYLOAD_LOGGER.log_count;
+        system["data_points_logged"] = JSON_PAYLOAD_LOGGER.DATA_STORE.size();
+        system["log_bytes_used"] = JSON_PAYLOAD_LOGGER.DATA_STORE.bytesUsed();
+        system["log_bytes_capacity"] = JSON_PAYLOAD_LOGGER.DATA_STORE.capacity();
+
+        // PMS warm-up / fan time
+        JsonObject pms_warmup = telemetry_doc["pms_warmup"].to<JsonObject>();
+        pms_warmup["last_ms"] = sampling_state.acquisition.lastWarmupMs;
+        pms_warmup["last_converged"] = sampling_state.acquisition.lastWarmupConverged;
+        pms_warmup["cycles"] = sampling_state.acquisition.warmupCycles;
+        pms_warmup["total_ms"] = sampling_state.acquisition.totalWarmupMs;
+        pms_warmup["saved_ms"] = sampling_state.acquisition.totalWarmupSavedMs;
+
+        // Sensor read outcomes per status code
+        addSensorErrorTelemetry(telemetry_doc["sensor_errors"].to<JsonObject>(), sampling_state);
+
+        // Records accepted and kept for retry per endpoint
+        JsonObject uplink = telemetry_doc["uplink"].to<JsonObject>();
+        uplink["fan_out"] = DeviceConfig.fan_out;
+        uplink["gsm_sessions_reused"] = HTTP_SESSION_REUSED;
+        for (const UploadTarget &target : UploadTargets)
+        {
+            JsonObject endpoint = uplink[target.name].to<JsonObject>();
+            endpoint["sent"] = target.sent;
+            endpoint["stored"] = target.stored;
+            endpoint["batch_rejected"] = target.batch_rejected;
+        }
+
+        // PSRAM offline queue
+        JsonObject offline = telemetry_doc["offline_queue"].to<JsonObject>();
+        offline["psram"] = OfflineQueue.psram;
+        offline["capacity"] = OfflineQueue.records.capacity();
+        offline["used"] = OfflineQueue.records.bytesUsed();
+        offline["records"] = OfflineQueue.records.size();
+        offline["spilled"] = OfflineQueue.spilled;
+        offline["flushes"] = OfflineQueue.flushes;
+
+        // Sampling task -> loop() queue
+        JsonObject sample_queue = telemetry_doc["sample_queue"].to<JsonObject>();
+        static const char *const sample_queue_policies[] = {"block", "dropOldest", "spill"};
+        sample_queue["policy"] = sample_queue_policies[DeviceConfig.sample_queue_policy < 3 ? DeviceConfig.sample_queue_policy : 0];
+        sample_queue["queued"] = SampleQueue.size();
+        sample_queue["capacity"] = SampleQueue.capacity();
+        sample_queue["blocked"] = sampling_state.queueBlocked;
+        sample_queue["dropped"] = sampling_state.queueDropped;
+        sample_queue["spilled"] = sampling_state.queueSpilled;
+        sample_queue["ingested"] = SampleQueueState.ingested;
+
+        // On-device aggregation
+        JsonObject aggregation = telemetry_doc["aggregation"].to<JsonObject>();
+        aggregation["mode"] = DeviceConfig.aggregation;
+        aggregation["active"] = aggregateUplink();
+        aggregation["window_s"] = Aggregator.window_s;
+        aggregation["pending"] = Aggregator.pending;
+        aggregation["dropped"] = Aggregator.dropped;
+
+        // What the restart kept, in the boot telemetry only
+        if (!boot_telemetry_sent)
+        {
+            JsonObject boot = telemetry_doc["boot"].to<JsonObject>();
+            boot["reset_reason"] = (int)esp_reset_reason();
+            boot["queue_restored_from"] = QueueCheckpointState.restoredFrom;
+            boot["queue_records_restored"] = QueueCheckpointState.restored;
+            boot["queue_restore_us"] = QueueCheckpointState.restoreUs;
+        }
+        JsonObject checkpoint = telemetry_doc["queue_checkpoint"].to<JsonObject>();
+        checkpoint["rtc_saves"] = QueueCheckpointState.saved;
+        checkpoint["flash_saves"] = QueueCheckpointState.flashSaved;
 
-        // Serialize to buffer
-        if (serializeJson(telemetry_doc, mqtt_payload, payload_size) == 0)
+        // Serialize to buffer; serializeJson() truncates silently, so the length is checked first
+        size_t length = measureJson(telemetry_doc);
+        if (length >= payload_size)
         {
-            Serial.println("buildMQTTTelemetryPayload: Failed to serialize JSON - buffer too small");
+            Serial.printf("buildMQTTTelemetryPayload: %u byte payload does not fit the %u byte buffer\n",
+                          (unsigned)length, (unsigned)payload_size);
             return false;
         }
+        serializeJson(telemetry_doc, mqtt_payload, payload_size);
 
         return true;
     }
@@ -2242,22 +3443,21 @@ bool sendGsmMQTTTelemetry(const char *broker, uint16_t port, uint8_t client_id,
     }
 
     // Build telemetry payload
-    char mqtt_payload[2048] = {}; // Large buffer for comprehensive telemetry
-    if (!buildMQTTTelemetryPayload(mqtt_payload, sizeof(mqtt_payload)))
+    if (!buildMQTTTelemetryPayload(telemetry_payload, sizeof(telemetry_payload)))
     {
         Serial.println("sendMQTTTelemetry: Failed to build telemetry payload");
         return false;
     }
 
     Serial.print("sendMQTTTelemetry: Payload size: ");
-    Serial.print(strlen(mqtt_payload));
+    Serial.print(strlen(telemetry_payload));
     Serial.println(" bytes");
 
     // Publish telemetry
     Serial.print("sendMQTTTelemetry: Publishing to topic: ");
     Serial.println(topic);
 
-    if (!MQTT_publish(client_id, 1, topic, mqtt_payload, 1, 0))
+    if (!MQTT_publish(client_id, 1, topic, telemetry_payload, 1, 0))
     {
         Serial.println("sendMQTTTelemetry: Failed to publish telemetry");
         return false;
@@ -2314,19 +3514,18 @@ bool sendWiFiMQTTTelemetry(const char *broker, uint16_t port, const char *client
     Serial.println("sendWiFiMQTTTelemetry: WiFi connected, proceeding with MQTT publish");
 
     // Build telemetry payload
-    char mqtt_payload[2048] = {}; // Large buffer for comprehensive telemetry
-    if (!buildMQTTTelemetryPayload(mqtt_payload, sizeof(mqtt_payload)))
+    if (!buildMQTTTelemetryPayload(telemetry_payload, sizeof(telemetry_payload)))
     {
         Serial.println("sendWiFiMQTTTelemetry: Failed to build telemetry payload");
         return false;
     }
 
     Serial.print("sendWiFiMQTTTelemetry: Payload size: ");
-    Serial.print(strlen(mqtt_payload));
+    Serial.print(strlen(telemetry_payload));
     Serial.println(" bytes");
 
     // Send telemetry via WiFi MQTT
-    bool result = wifiMQTTSendTelemetry(broker, port, topic, client_id, mqtt_payload, username, password, false);
+    bool result = wifiMQTTSendTelemetry(broker, port, topic, client_id, telemetry_payload, username, password, false);
 
     if (result)
     {
@@ -2495,7 +3694,7 @@ void processIncomingData()
         {
             Serial.println("Device restarting from remote command...");
             delay(2000);
-            ESP.restart();
+            restartDevice("remote command");
         }
     }
 
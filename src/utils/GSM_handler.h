@@ -24,6 +24,8 @@ int HTTPCFG_CONNECT_FAIL = 0;
 #endif
 int GPRS_INIT_FAIL_COUNT = 0;
 int HTTP_POST_FAIL = 0;
+uint32_t HTTP_SESSION_CONFIG = 0; // hash of the URL and headers the modem's HTTP(S) stack is set up with, 0 = none
+int HTTP_SESSION_REUSED = 0;      // posts that skipped the AT+QHTTPCFG set-up
 int REGISTER_TO_NETWORK_FAIL = 0;
 
 uint16_t HTTPOST_RESPONSE_STATUS;
@@ -97,7 +99,7 @@ void QUECTEL_POST(const char *url, char headers[][256], int header_size, const c
 bool extractText(char *input, const char *target, char *output, uint8_t output_size, char _until);
 void get_raw_response(const char *cmd, char *res_buff, size_t buff_size, bool wait_timeout = false, unsigned long timeout = 3000);
 int16_t getNumber(const char *AT_cmd, const char *expected_reply, uint8_t index_from, uint8_t length);
-void get_http_response_status(String data, char *HTTP_RESPONSE_STATUS);
+void get_http_response_status(const char *data, size_t data_length, char *HTTP_RESPONSE_STATUS);
 bool sendAndCheck(const char *AT_cmd, const char *expected_reply = "OK", unsigned long timeout = 10000);
 bool sendAndCheck(const char *AT_cmd, const char *expected_reply, String &response, unsigned long timeout = 10000);
 bool waitForReply(const char *expectedReply, unsigned long timeout);
@@ -109,6 +111,7 @@ void GSMreset(RST_SEQ seq, uint8_t timing_delay = 120);
 bool reset_http_config();
 bool http_preconfig();
 bool https_preconfig();
+bool configure_http_session(const char *url, char headers[][256], int header_size);
 void GSM_sleep();
 void troubleshoot_GSM();
 String getNetworkName();
@@ -473,6 +476,7 @@ bool GPRS_init()
 /// @brief Perform soft reset of GSM module with AT commands
 void GSM_soft_reset()
 {
+    HTTP_SESSION_CONFIG = 0;
     deactivateGPRS();
 
     if (!sendAndCheck("AT+CFUN=1,1", "OK"))
@@ -674,29 +678,39 @@ bool https_preconfig()
     return configured;
 }
 
-/// @brief Send HTTP POST request via Quectel module
-/// @param url Target URL including http:// or https://
-/// @param headers Array of HTTP headers
-/// @param header_size Number of headers
-/// @param data Request body data
-/// @param data_length Length of request body
-/// @param response_status HTTP response status code
-void QUECTEL_POST(const char *url, char headers[][256], int header_size, const char *data, size_t data_length, int &response_status)
+/// @brief FNV-1a hash of an HTTP(S) session set-up; never 0
+uint32_t http_session_hash(const char *url, char headers[][256], int header_size)
+{
+    uint32_t hash = 2166136261u;
+    auto add = [&hash](const char *text)
+    {
+        for (; *text; text++)
+            hash = (hash ^ (uint8_t)*text) * 16777619u;
+        hash = (hash ^ 0xff) * 16777619u; // separator
+    };
+    add(url);
+    for (int i = 0; i < header_size; i++)
+        add(headers[i]);
+    return hash == 0 ? 1 : hash;
+}
+
+/// @brief Reset the modem's HTTP(S) configuration and set it up for a URL and request headers
+/// @return true if every setting was accepted
+bool configure_http_session(const char *url, char headers[][256], int header_size)
 {
-    response_status = 0;
     String resp;
     bool is_https = (strncmp(url, "https://", 8) == 0);
 
     if (!reset_http_config())
     {
         HTTPCFG_CONNECT_FAIL += 1;
-        return;
+        return false;
     }
 
     if (!http_preconfig())
     {
         HTTPCFG_CONNECT_FAIL += 1;
-        return;
+        return false;
     }
 
     if (is_https)
@@ -706,7 +720,7 @@ void QUECTEL_POST(const char *url, char headers[][256], int header_size, const c
         if (!https_preconfig())
         {
             HTTPCFG_CONNECT_FAIL += 1;
-            return;
+            return false;
         }
     }
 
@@ -716,7 +730,7 @@ void QUECTEL_POST(const char *url, char headers[][256], int header_size, const c
     {
         Serial.println("HTTP URL config command too long");
         HTTPCFG_CONNECT_FAIL += 1;
-        return;
+        return false;
     }
 
     if (!sendAndCheck(HTTP_CFG, "OK", resp, 2000))
@@ -724,7 +738,7 @@ void QUECTEL_POST(const char *url, char headers[][256], int header_size, const c
         Serial.println("Failed to set HTTP(S) URL");
         Serial.println(resp);
         HTTPCFG_CONNECT_FAIL += 1;
-        return;
+        return false;
     }
     Serial.println(resp);
 
@@ -739,7 +753,7 @@ void QUECTEL_POST(const char *url, char headers[][256], int header_size, const c
         {
             Serial.println("HTTP header config command too long");
             HTTPCFG_CONNECT_FAIL += 1;
-            return;
+            return false;
         }
 
         Serial.println("Setting header: " + String(headers[i]));
@@ -750,10 +764,40 @@ void QUECTEL_POST(const char *url, char headers[][256], int header_size, const c
         else
         {
             Serial.println("Failed to set header");
-            return;
+            return false;
         }
     }
 
+    return true;
+}
+
+/// @brief Send HTTP POST request via Quectel module
+/// @param url Target URL including http:// or https://
+/// @param headers Array of HTTP headers
+/// @param header_size Number of headers
+/// @param data Request body data
+/// @param data_length Length of request body
+/// @param response_status HTTP response status code
+void QUECTEL_POST(const char *url, char headers[][256], int header_size, const char *data, size_t data_length, int &response_status)
+{
+    response_status = 0;
+    String resp;
+
+    // The modem keeps its HTTP(S) set-up between posts; it is only redone for another URL or other headers
+    uint32_t session = http_session_hash(url, headers, header_size);
+    if (session != HTTP_SESSION_CONFIG)
+    {
+        HTTP_SESSION_CONFIG = 0;
+        if (!configure_http_session(url, headers, header_size))
+            return;
+        HTTP_SESSION_CONFIG = session;
+    }
+    else
+    {
+        Serial.println("Reusing HTTP(S) session set-up");
+        HTTP_SESSION_REUSED += 1;
+    }
+
     char HTTP_POST_RESPONSE_STATUS[4] = "000";
 
     // Prepare POST request
@@ -765,16 +809,19 @@ void QUECTEL_POST(const char *url, char headers[][256], int header_size, const c
     if (sendAndCheck(http_post_prepare, "CONNECT", resp, 10000))
     {
         Serial.println("Posting gprs data..");
-        get_http_response_status(data, HTTP_POST_RESPONSE_STATUS);
+        get_http_response_status(data, data_length, HTTP_POST_RESPONSE_STATUS);
         response_status = atoi(HTTP_POST_RESPONSE_STATUS);
     }
     else
     {
         Serial.println("HTTP POST CONNECT FAIL");
         HTTPCFG_CONNECT_FAIL += 1;
+        HTTP_SESSION_CONFIG = 0;
         Serial.println(resp);
         return;
     }
+    if (response_status == 0)
+        HTTP_SESSION_CONFIG = 0; // no answer, set the session up again next time
 
     if (response_status >= 200 && response_status < 300)
     {
@@ -1034,19 +1081,20 @@ bool waitForURC(const char *urcPrefix, char *response,
     return false;
 }
 
-/// @brief Parse HTTP response status from data
-/// @param data Response data to parse
+/// @brief Write the POST body after CONNECT and parse the HTTP response status
+/// @param data POST body
+/// @param data_length Body length in bytes, as announced in AT+QHTTPPOST
 /// @param HTTP_RESPONSE_STATUS Buffer for status code
-void get_http_response_status(String data, char *HTTP_RESPONSE_STATUS)
+void get_http_response_status(const char *data, size_t data_length, char *HTTP_RESPONSE_STATUS)
 {
     strcpy(HTTP_RESPONSE_STATUS, "000");
-    const char *data_copy = data.c_str();
-    char gprs_data[strlen(data_copy) + 1];
-    strcpy(gprs_data, data_copy);
 
     // Check HTTP RESPONSE status (0 = Operation successful)
     const char *expected_reply = "+QHTTPPOST: 0,";
-    sendAndCheck(gprs_data);
+    // Exactly data_length bytes as announced in AT+QHTTPPOST; written as bytes so binary bodies pass unchanged
+    flushSerial();
+    GSMSerial.write((const uint8_t *)data, data_length);
+    waitForReply("OK", 10000);
 
     char qurc[32];
     // Note: Space after colon is significant for URC matching
@@ -1117,6 +1165,7 @@ bool activateGPRS()
 /// @return true if deactivation successful
 bool deactivateGPRS()
 {
+    HTTP_SESSION_CONFIG = 0;
     if (GPRS_status() == 0)
     {
         Serial.println("GPRS already inactive");
@@ -1347,6 +1396,7 @@ bool GSM_Serial_begin()
 /// @param timing_delay :  Delay in milliseconds for each pin state change for the reset to happen
 void GSMreset(RST_SEQ seq, uint8_t timing_delay)
 {
+    HTTP_SESSION_CONFIG = 0;
 
     pinMode(GSM_RST_PIN, OUTPUT);
 
@@ -1373,6 +1423,7 @@ void GSMreset(RST_SEQ seq, uint8_t timing_delay)
 /// @brief Put GSM module into low-power sleep mode
 void GSM_sleep()
 {
+    HTTP_SESSION_CONFIG = 0;
 
     if (sendAndCheck("AT+QSCLK=2", "OK"))
     {
@@ -119,6 +119,31 @@ static void appendFile(fs::FS &fs, const char *path, const char *message, bool n
     file.close();
 }
 
+static void appendFileBytes(fs::FS &fs, const char *path, const uint8_t *data, size_t length, bool newline = false)
+{
+    Serial.print("Appending to file: ");
+    Serial.println(path);
+    File file = fs.open(path, FILE_APPEND);
+    if (!file)
+    {
+        Serial.println("Failed to open file for appending");
+        return;
+    }
+    if (file.write(data, length) == length)
+    {
+        Serial.println("Bytes appended");
+        if (newline)
+        {
+            file.println();
+        }
+    }
+    else
+    {
+        Serial.println("Append failed");
+    }
+    file.close();
+}
+
 static void deleteFile(fs::FS &fs, const char *path)
 {
     Serial.printf("Deleting file: %s\n", path);
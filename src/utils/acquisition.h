@@ -0,0 +1,165 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <Arduino.h>
+#include "../global_configs.h"
+
+/// @brief Phases of a sensor acquisition cycle
+enum AcquisitionPhase
+{
+    ACQ_IDLE,    ///< PMS asleep, waiting for the next sampling interval
+    ACQ_WARMING, ///< PMS fan running, waiting for the airflow to settle
+    ACQ_READING, ///< Reading the PMS and DHT sensors
+    ACQ_SLEEPING ///< PMS sleep command sent, waiting for the sensor to settle
+};
+
+/**
+ * @brief Cooperative sensor acquisition state machine
+ * @details Replaces the blocking wake/delay/read sequence. loop() advances the cycle on every pass
+ *          (see acquisitionManager() in main.cpp) so comms, MQTT and the web server keep running
+ *          while the PMS fan warms up. Time is passed in by the caller, never read here.
+ */
+struct AcquisitionState
+{
+    AcquisitionPhase phase = ACQ_IDLE;
+    unsigned long phaseStartedAt = 0;
+    unsigned long warmupMinMs = PMS_WARMUP_MIN_MS;  // never read before this, even if frames agree
+    unsigned long warmupMaxMs = PMS_WARMUP_MAX_MS;  // read at this point even if frames never agree
+    unsigned long settleMs = PMS_CMD_SETTLE_MS;     // time the sensor needs after a wake/sleep command
+    uint8_t stableFramesRequired = PMS_STABLE_FRAMES;
+    uint16_t tolerancePct = PMS_STABLE_TOLERANCE_PCT;
+    uint16_t toleranceAbs = PMS_STABLE_TOLERANCE_UGM3;
+    unsigned long cyclesCompleted = 0;
+
+    // Stabilization tracking for the running cycle
+    uint16_t lastPM[3] = {};  // PM1.0, PM2.5, PM10 of the previous warm-up frame
+    bool hasFrame = false;    // lastPM holds a valid frame
+    uint8_t stableFrames = 0; // consecutive frames within tolerance of their predecessor
+
+    // Warm-up statistics (fan time before the reading)
+    unsigned long lastWarmupMs = 0;
+    bool lastWarmupConverged = false;
+    unsigned long totalWarmupMs = 0;
+    unsigned long totalWarmupSavedMs = 0; // against always warming up for warmupMaxMs
+    unsigned long warmupCycles = 0;
+
+    void enter(AcquisitionPhase next, unsigned long now)
+    {
+        if (phase == ACQ_WARMING && next == ACQ_READING)
+        {
+            lastWarmupMs = now - phaseStartedAt;
+            lastWarmupConverged = isStable();
+            totalWarmupMs += lastWarmupMs;
+            if (lastWarmupMs < warmupMaxMs)
+                totalWarmupSavedMs += warmupMaxMs - lastWarmupMs;
+            warmupCycles++;
+        }
+        phase = next;
+        phaseStartedAt = now;
+    }
+
+    unsigned long elapsed(unsigned long now) const
+    {
+        return now - phaseStartedAt;
+    }
+
+    bool isIdle() const
+    {
+        return phase == ACQ_IDLE;
+    }
+
+    /// @brief Start a new cycle if none is running
+    /// @return true if a cycle was started
+    bool start(unsigned long now)
+    {
+        if (phase != ACQ_IDLE)
+            return false;
+        hasFrame = false;
+        stableFrames = 0;
+        enter(ACQ_WARMING, now);
+        return true;
+    }
+
+    /// @brief Record a PMS frame read during warm-up
+    /// @param pm : PM1.0, PM2.5 and PM10 of the frame [ug/m3]
+    /// @details A frame counts towards stability when every PM value is within tolerancePct of the previous frame,
+    ///          or within toleranceAbs ug/m3 for clean air where a percentage is meaningless.
+    void addWarmupFrame(const uint16_t pm[3])
+    {
+        bool within = hasFrame;
+        for (uint8_t i = 0; i < 3 && within; i++)
+        {
+            uint16_t diff = pm[i] > lastPM[i] ? pm[i] - lastPM[i] : lastPM[i] - pm[i];
+            uint32_t allowed = (uint32_t)lastPM[i] * tolerancePct / 100;
+            if (allowed < toleranceAbs)
+                allowed = toleranceAbs;
+            within = diff <= allowed;
+        }
+        if (!within)
+            stableFrames = 0;
+        else if (stableFrames < 0xFF)
+            stableFrames++;
+        memcpy(lastPM, pm, sizeof(lastPM));
+        hasFrame = true;
+    }
+
+    bool isStable() const
+    {
+        return stableFrames >= stableFramesRequired;
+    }
+
+    /// @brief Advance the timed phases
+    /// @return the phase the cycle is in after the step
+    /// @note ACQ_READING is left by the caller through finishReading() once the sensors have been read
+    AcquisitionPhase step(unsigned long now)
+    {
+        switch (phase)
+        {
+        case ACQ_WARMING:
+            if (elapsed(now) >= warmupMaxMs || (isStable() && elapsed(now) >= warmupMinMs))
+                enter(ACQ_READING, now);
+            break;
+        case ACQ_SLEEPING:
+            if (elapsed(now) >= settleMs)
+            {
+                enter(ACQ_IDLE, now);
+                cyclesCompleted++;
+            }
+            break;
+        case ACQ_IDLE:
+        case ACQ_READING:
+            break;
+        }
+        return phase;
+    }
+
+    /// @brief Restart the timer of the current phase without changing phase (e.g. to retry a read window)
+    void restartPhase(unsigned long now)
+    {
+        phaseStartedAt = now;
+    }
+
+    void finishReading(unsigned long now)
+    {
+        if (phase == ACQ_READING)
+            enter(ACQ_SLEEPING, now);
+    }
+
+    static const char *phaseName(AcquisitionPhase p)
+    {
+        switch (p)
+        {
+        case ACQ_IDLE:
+            return "idle";
+        case ACQ_WARMING:
+            return "warming";
+        case ACQ_READING:
+            return "reading";
+        case ACQ_SLEEPING:
+            return "sleeping";
+        }
+        return "unknown";
+    }
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef ADAPTIVE_SAMPLING_H
+#define ADAPTIVE_SAMPLING_H
+
+#include <Arduino.h>
+#include "../global_configs.h"
+
+/// @brief Why the sampling interval was last changed
+enum SamplingChangeReason
+{
+    SAMPLING_UNCHANGED,
+    SAMPLING_THRESHOLD, ///< PM2.5 crossed a configured threshold -> minimum interval
+    SAMPLING_FAST,      ///< PM2.5 changing faster than fastRate -> minimum interval
+    SAMPLING_CHANGING,  ///< PM2.5 drifting -> interval halved
+    SAMPLING_STABLE     ///< PM2.5 stable -> interval doubled
+};
+
+/**
+ * @brief Adaptive sampling interval driven by the PM2.5 rate of change
+ * @details Called once per acquisition cycle with the new PM2.5 reading. The interval drops to minMs when PM2.5
+ *          crosses one of the thresholds or changes faster than fastRate, is halved while it keeps drifting and
+ *          doubles, up to maxMs, while it is stable. Bounds and rates come from DeviceConfig.
+ *          A change of at most deadband ug/m3 is taken as no change, so the 1 ug/m3 flicker of the PMS neither
+ *          crosses a threshold nor counts as drift. Halving and doubling wait for confirmCycles consecutive readings
+ *          of the same kind; a threshold or a fast change still drops to minMs at once. minMs is never below
+ *          cycleMs, the longest acquisition cycle.
+ *          Time is passed in by the caller, never read here.
+ */
+struct AdaptiveSampler
+{
+    static const uint8_t MAX_THRESHOLDS = 4;
+
+    unsigned long intervalMs = SAMPLING_INTERVAL_DEFAULT_MS;
+    unsigned long minMs = SAMPLING_INTERVAL_MIN_MS;
+    unsigned long maxMs = SAMPLING_INTERVAL_MAX_MS;
+    float fastRate = PM25_FAST_RATE_UGM3_PER_MIN;     // at or above: sample as fast as allowed
+    float stableRate = PM25_STABLE_RATE_UGM3_PER_MIN; // at or below: stretch the interval
+    uint16_t thresholds[MAX_THRESHOLDS] = {};         // PM2.5 levels [ug/m3], 0 = unused
+    uint16_t deadband = PM25_DEADBAND_UGM3;           // [ug/m3]
+    uint8_t confirmCycles = SAMPLING_CONFIRM_CYCLES;
+    unsigned long cycleMs = SAMPLING_CYCLE_MAX_MS;
+    bool enabled = true;
+
+    // Last reading and change
+    bool hasReading = false;
+    uint16_t lastPM25 = 0;
+    unsigned long lastAt = 0;
+    float lastRate = 0.0f; // [ug/m3 per minute]
+    SamplingChangeReason lastReason = SAMPLING_UNCHANGED;
+    unsigned long changes = 0;
+
+    // Readings in a row classified as pendingReason (stable or changing), not acted on yet
+    SamplingChangeReason pendingReason = SAMPLING_UNCHANGED;
+    uint8_t pendingCount = 0;
+
+    /// @brief Keep the bounds usable and the interval inside them
+    void applyBounds()
+    {
+        if (minMs > maxMs)
+        {
+            unsigned long tmp = minMs;
+            minMs = maxMs;
+            maxMs = tmp;
+        }
+        if (minMs < cycleMs)
+            minMs = cycleMs;
+        if (maxMs < minMs)
+            maxMs = minMs;
+        intervalMs = constrain(intervalMs, minMs, maxMs);
+    }
+
+    /// @return true if value and reference lie on different sides of a threshold
+    bool crossesThreshold(uint16_t reference, uint16_t value) const
+    {
+        for (uint8_t i = 0; i < MAX_THRESHOLDS; i++)
+        {
+            if (thresholds[i] == 0)
+                continue;
+            if ((reference < thresholds[i]) != (value < thresholds[i]))
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief Feed a PM2.5 reading and adapt the interval
+    /// @param pm25 : PM2.5 of the cycle [ug/m3]
+    /// @param now : millis() of the reading
+    /// @return the reason if the interval changed, SAMPLING_UNCHANGED otherwise
+    SamplingChangeReason update(uint16_t pm25, unsigned long now)
+    {
+        SamplingChangeReason reason = SAMPLING_UNCHANGED;
+        unsigned long next = intervalMs;
+
+        uint16_t moved = pm25 > lastPM25 ? pm25 - lastPM25 : lastPM25 - pm25;
+        if (enabled && hasReading && now != lastAt)
+        {
+            uint16_t diff = moved > deadband ? moved : 0;
+            lastRate = diff * 60000.0f / (now - lastAt);
+
+            if (diff > 0 && crossesThreshold(lastPM25, pm25))
+                reason = SAMPLING_THRESHOLD;
+            else if (lastRate >= fastRate)
+                reason = SAMPLING_FAST;
+            else if (lastRate <= stableRate)
+                reason = SAMPLING_STABLE;
+            else
+                reason = SAMPLING_CHANGING;
+
+            if (reason == pendingReason)
+            {
+                if (pendingCount < 0xFF)
+                    pendingCount++;
+            }
+            else
+            {
+                pendingReason = reason;
+                pendingCount = 1;
+            }
+
+            if (reason == SAMPLING_THRESHOLD || reason == SAMPLING_FAST)
+                next = minMs;
+            else if (pendingCount < confirmCycles)
+                next = intervalMs;
+            else if (reason == SAMPLING_STABLE)
+                next = intervalMs * 2 > maxMs ? maxMs : intervalMs * 2;
+            else
+                next = intervalMs / 2 < minMs ? minMs : intervalMs / 2;
+        }
+
+        // a reading within the deadband keeps the reference reading, so a slow drift still adds up
+        if (!hasReading || !enabled || moved > deadband)
+        {
+            lastPM25 = pm25;
+            lastAt = now;
+        }
+        hasReading = true;
+
+        if (next == intervalMs)
+            return SAMPLING_UNCHANGED;
+        intervalMs = next;
+        lastReason = reason;
+        changes++;
+        return reason;
+    }
+
+    static const char *reasonName(SamplingChangeReason r)
+    {
+        switch (r)
+        {
+        case SAMPLING_UNCHANGED:
+            return "unchanged";
+        case SAMPLING_THRESHOLD:
+            return "threshold crossed";
+        case SAMPLING_FAST:
+            return "fast change";
+        case SAMPLING_CHANGING:
+            return "changing";
+        case SAMPLING_STABLE:
+            return "stable";
+        }
+        return "unknown";
+    }
+};
+
+#endif
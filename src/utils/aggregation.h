@@ -0,0 +1,400 @@
+#ifndef AGGREGATION_H
+#define AGGREGATION_H
+
+#include <Arduino.h>
+#include "../global_configs.h"
+#include "datetime.h"
+#include "sensor_registry.h"
+#include "json_writer.h"
+
+/**
+ * @brief On-device aggregation of sensor readings over fixed time windows (hourly, daily, ...)
+ * @details Every reading feeds running statistics per sensor value: count, mean, min, max and a streaming p95 from the
+ *          P² algorithm (Jain & Chlamtac, 1985), which tracks a quantile with five markers instead of storing every
+ *          sample. Windows are aligned to local time, so a daily window runs from midnight to midnight. When a reading
+ *          falls into the next window, or closeDue() finds the window over, the statistics of every sensor that had
+ *          readings are moved into a small queue of AggregateResult until the next upload renders them with
+ *          renderAggregatePayload(). Everything lives in the SampleAggregator object; nothing is allocated.
+ */
+
+enum AggregationMode : uint8_t
+{
+    AGGREGATION_OFF,    // upload every reading
+    AGGREGATION_ALWAYS, // upload aggregates, raw readings stay on the SD card
+    AGGREGATION_GSM     // aggregates while the uplink is GSM, raw readings over WiFi
+};
+
+#define AGGREGATE_QUEUE_SIZE 16        // closed windows waiting for upload, all sensors together
+#define AGGREGATE_PAYLOAD_MAX_BYTES 768 // rendered aggregate; a PMS one is about 590 bytes
+
+#define P2_EXACT_VALUES 16 // values kept as they are before the P² markers take over
+
+/**
+ * @brief Streaming quantile estimate (P² algorithm) in constant memory
+ * @details P² alone starts from the first five values and needs a few dozen before its estimate settles, while an
+ *          hourly window of 5-minute samples has twelve. The first P2_EXACT_VALUES values are therefore kept sorted and
+ *          give the exact (nearest rank) quantile; the five markers are then seeded from them at their ranks.
+ */
+struct P2Quantile
+{
+    float p = 0.95f;
+    uint32_t n = 0;
+    float exact[P2_EXACT_VALUES] = {}; // sorted, while n <= P2_EXACT_VALUES
+    float q[5] = {};                   // marker heights
+    int32_t pos[5] = {};               // marker positions, 1-based
+    float desired[5] = {};             // desired marker positions
+    float inc[5] = {};                 // desired position increments
+
+    explicit P2Quantile(float quantile = 0.95f) : p(quantile) {}
+
+    void reset()
+    {
+        n = 0;
+    }
+
+    void add(float x)
+    {
+        if (n < P2_EXACT_VALUES)
+        {
+            uint8_t i = n++;
+            for (; i > 0 && exact[i - 1] > x; i--)
+                exact[i] = exact[i - 1];
+            exact[i] = x;
+            return;
+        }
+        if (n == P2_EXACT_VALUES)
+            seedMarkers();
+
+        // cell of x, widening the extreme markers if needed
+        uint8_t k;
+        if (x < q[0])
+        {
+            q[0] = x;
+            k = 0;
+        }
+        else if (x >= q[4])
+        {
+            q[4] = x;
+            k = 3;
+        }
+        else
+        {
+            k = 0;
+            while (x >= q[k + 1])
+                k++;
+        }
+        for (uint8_t i = k + 1; i < 5; i++)
+            pos[i]++;
+        for (uint8_t i = 0; i < 5; i++)
+            desired[i] += inc[i];
+        n++;
+
+        // move the middle markers towards their desired positions
+        for (uint8_t i = 1; i < 4; i++)
+        {
+            float d = desired[i] - pos[i];
+            if ((d >= 1 && pos[i + 1] - pos[i] > 1) || (d <= -1 && pos[i - 1] - pos[i] < -1))
+            {
+                int8_t s = d >= 0 ? 1 : -1;
+                float h = parabolic(i, s);
+                q[i] = (q[i - 1] < h && h < q[i + 1]) ? h : linear(i, s);
+                pos[i] += s;
+            }
+        }
+    }
+
+    /// @return the quantile estimate, NaN for no values
+    float value() const
+    {
+        if (n == 0)
+            return NAN;
+        if (n <= P2_EXACT_VALUES)
+        {
+            uint32_t rank = (uint32_t)ceilf(p * n);
+            return exact[rank > 0 ? rank - 1 : 0];
+        }
+        return q[2];
+    }
+
+private:
+    /// @brief Markers at the ranks of min, p/2, p, (1+p)/2 and max among the exact values
+    void seedMarkers()
+    {
+        const float f[5] = {0, p / 2, p, (1 + p) / 2, 1};
+        for (uint8_t i = 0; i < 5; i++)
+        {
+            desired[i] = 1 + (n - 1) * f[i];
+            inc[i] = f[i];
+            int32_t rank = (int32_t)lroundf(desired[i]);
+            int32_t lowest = i == 0 ? 1 : pos[i - 1] + 1; // strictly increasing
+            int32_t highest = (int32_t)n - (4 - i);
+            pos[i] = rank < lowest ? lowest : rank > highest ? highest : rank;
+            q[i] = exact[pos[i] - 1];
+        }
+    }
+
+    float parabolic(uint8_t i, int8_t s) const
+    {
+        float a = (float)(pos[i] - pos[i - 1] + s) * (q[i + 1] - q[i]) / (pos[i + 1] - pos[i]);
+        float b = (float)(pos[i + 1] - pos[i] - s) * (q[i] - q[i - 1]) / (pos[i] - pos[i - 1]);
+        return q[i] + (float)s / (pos[i + 1] - pos[i - 1]) * (a + b);
+    }
+
+    float linear(uint8_t i, int8_t s) const
+    {
+        return q[i] + s * (q[i + s] - q[i]) / (pos[i + s] - pos[i]);
+    }
+};
+
+/// @brief count, mean, min, max and p95 of one sensor value
+struct RunningStats
+{
+    uint32_t count = 0;
+    double sum = 0;
+    float min = 0;
+    float max = 0;
+    P2Quantile p95{0.95f};
+
+    void reset()
+    {
+        count = 0;
+        sum = 0;
+        p95.reset();
+    }
+
+    void add(float x)
+    {
+        if (isnan(x))
+            return;
+        if (count == 0 || x < min)
+            min = x;
+        if (count == 0 || x > max)
+            max = x;
+        count++;
+        sum += x;
+        p95.add(x);
+    }
+
+    float mean() const
+    {
+        return count > 0 ? (float)(sum / count) : NAN;
+    }
+};
+
+/// @brief Statistics of one sensor over a closed window
+struct AggregateResult
+{
+    uint8_t sensor = SENSOR_COUNT; // SensorId
+    Timestamp start;               // window start
+    uint32_t window_s = 0;
+    uint16_t count = 0; // readings in the window
+    float mean[SENSOR_MAX_VALUES] = {};
+    float min[SENSOR_MAX_VALUES] = {};
+    float max[SENSOR_MAX_VALUES] = {};
+    float p95[SENSOR_MAX_VALUES] = {};
+};
+
+struct SampleAggregator
+{
+    uint32_t window_s = AGGREGATION_WINDOW_S;
+    int64_t windowStart = 0; // UTC epoch of the open window, 0 = none
+    int16_t tzOffsetMin = TZ_OFFSET_UNKNOWN;
+    RunningStats stats[SENSOR_COUNT][SENSOR_MAX_VALUES];
+    uint16_t readings[SENSOR_COUNT] = {};
+    bool withheld[SENSOR_COUNT] = {}; // a raw reading of the window was kept off the uplink
+
+    AggregateResult queue[AGGREGATE_QUEUE_SIZE];
+    uint8_t head = 0;
+    uint8_t pending = 0;
+    uint32_t dropped = 0; // results overwritten while the queue was full
+
+    /// @brief Start of the window holding t, aligned to local time
+    int64_t windowOf(const Timestamp &t) const
+    {
+        int64_t offset = t.tzOffsetMin == TZ_OFFSET_UNKNOWN ? 0 : (int64_t)t.tzOffsetMin * 60;
+        int64_t local = t.epoch + offset;
+        int64_t start = local - ((local % (int64_t)window_s) + window_s) % window_s;
+        return start - offset;
+    }
+
+    /**
+     * @brief Add a reading
+     * @param withheld_raw : the raw reading was not queued for upload; only windows with such readings produce a result
+     * @return true if this closed the previous window
+     */
+    bool add(uint8_t sensor, const float *values, const Timestamp &t, bool withheld_raw)
+    {
+        if (sensor >= SENSOR_COUNT || window_s == 0)
+            return false;
+        bool closed = false;
+        int64_t start = windowOf(t);
+        if (windowStart != 0 && start != windowStart)
+            closed = close();
+        if (windowStart == 0)
+        {
+            windowStart = start;
+            tzOffsetMin = t.tzOffsetMin;
+        }
+        const SensorDescriptor &desc = SENSOR_REGISTRY[sensor];
+        for (uint8_t i = 0; i < desc.value_count; i++)
+            stats[sensor][i].add(values[i]);
+        if (readings[sensor] < UINT16_MAX)
+            readings[sensor]++;
+        withheld[sensor] |= withheld_raw;
+        return closed;
+    }
+
+    /// @brief Close the open window if it ended before epoch
+    bool closeDue(int64_t epoch)
+    {
+        return windowStart != 0 && epoch >= windowStart + (int64_t)window_s && close();
+    }
+
+    /// @brief Change the window length; the open window is closed first
+    void setWindow(uint32_t seconds)
+    {
+        if (seconds == window_s)
+            return;
+        close();
+        window_s = seconds;
+    }
+
+    /// @brief Queue the results of the open window and start over
+    /// @return true if a result was queued
+    bool close()
+    {
+        bool queued = false;
+        for (uint8_t id = 0; id < SENSOR_COUNT; id++)
+        {
+            if (readings[id] > 0 && withheld[id])
+            {
+                AggregateResult &r = slot();
+                r.sensor = id;
+                r.start.epoch = windowStart;
+                r.start.tzOffsetMin = tzOffsetMin;
+                r.window_s = window_s;
+                r.count = readings[id];
+                for (uint8_t i = 0; i < SENSOR_REGISTRY[id].value_count; i++)
+                {
+                    const RunningStats &s = stats[id][i];
+                    r.mean[i] = s.mean();
+                    r.min[i] = s.count > 0 ? s.min : NAN;
+                    r.max[i] = s.count > 0 ? s.max : NAN;
+                    r.p95[i] = s.p95.value();
+                }
+                queued = true;
+            }
+            for (RunningStats &s : stats[id])
+                s.reset();
+            readings[id] = 0;
+            withheld[id] = false;
+        }
+        windowStart = 0;
+        return queued;
+    }
+
+    /// @brief Oldest queued result, nullptr if none
+    const AggregateResult *peek() const
+    {
+        return pending > 0 ? &queue[head] : nullptr;
+    }
+
+    /// @brief i-th queued result, oldest first; i < pending
+    const AggregateResult &at(uint8_t i) const
+    {
+        return queue[(head + i) % AGGREGATE_QUEUE_SIZE];
+    }
+
+    void pop()
+    {
+        if (pending == 0)
+            return;
+        head = (head + 1) % AGGREGATE_QUEUE_SIZE;
+        pending--;
+    }
+
+private:
+    AggregateResult &slot()
+    {
+        if (pending == AGGREGATE_QUEUE_SIZE)
+        {
+            pop(); // oldest result lost
+            dropped++;
+        }
+        AggregateResult &r = queue[(head + pending) % AGGREGATE_QUEUE_SIZE];
+        pending++;
+        r = AggregateResult();
+        return r;
+    }
+};
+
+/**
+ * @brief Render the push payload of an aggregate
+ * @details The payload of a raw reading with the window mean as value, plus <value_type>_min, _max and _p95 entries and
+ *          an "aggregate" object with the window length and the number of readings:
+ *
+ *              {"software_version":"…","timestamp":"<window start>","sensordatavalues":[{"value_type":"P2","value":…},
+ *               {"value_type":"P2_min",…},…],"sensor_type":"PMS","API_PIN":1,"aggregate":{"window_s":3600,"count":12}}
+ *
+ *          Min and max are readings and keep the registry decimals; mean and p95 get one more.
+ * @return length written excluding the terminator; 0 (empty string) if the payload does not fit
+ */
+static size_t renderAggregatePayload(char *buf, size_t size, const AggregateResult &r)
+{
+    if (r.sensor >= SENSOR_COUNT)
+    {
+        if (size > 0)
+            buf[0] = '\0';
+        return 0;
+    }
+    const SensorDescriptor &sensor = SENSOR_REGISTRY[r.sensor];
+    char timestamp[32];
+    formatISO8601(timestamp, sizeof(timestamp), r.start);
+
+    JsonWriter json(buf, size);
+    json.beginObject();
+    json.key("software_version");
+    json.value(SOFTWARE_VERSION);
+    json.key("timestamp");
+    json.value(timestamp);
+    json.key("sensordatavalues");
+    json.beginArray();
+    for (uint8_t i = 0; i < sensor.value_count; i++)
+    {
+        const SensorValueDescriptor &v = sensor.values[i];
+        uint8_t decimals = v.decimals < FIXED_MAX_DECIMALS ? v.decimals + 1 : v.decimals;
+        const struct
+        {
+            const char *suffix;
+            float value;
+            uint8_t decimals;
+        } entries[4] = {{"", r.mean[i], decimals}, {"_min", r.min[i], v.decimals}, {"_max", r.max[i], v.decimals}, {"_p95", r.p95[i], decimals}};
+        for (const auto &e : entries)
+        {
+            char value_type[32];
+            snprintf(value_type, sizeof(value_type), "%s%s", v.api_key, e.suffix);
+            json.beginObject();
+            json.key("value_type");
+            json.value(value_type);
+            json.key("value");
+            json.value(e.value, e.decimals);
+            json.endObject();
+        }
+    }
+    json.endArray();
+    json.key("sensor_type");
+    json.value(sensor.sensor_type);
+    json.key("API_PIN");
+    json.value((int32_t)sensor.api_pin);
+    json.key("aggregate");
+    json.beginObject();
+    json.key("window_s");
+    json.value((int32_t)r.window_s);
+    json.key("count");
+    json.value((int32_t)r.count);
+    json.endObject();
+    json.endObject();
+    return json.finish();
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <Arduino.h>
+#include <math.h>
+
+/**
+ * @brief Minimal CBOR (RFC 8949) encoder/decoder for the sample records
+ * @details Covers the subset the records use: unsigned/negative integers up to 64 bits, definite-length arrays,
+ *          single-precision floats and null. No heap; both sides work on a caller-provided buffer and report running
+ *          past its end through overflowed()/failed().
+ */
+
+enum CborMajorType : uint8_t
+{
+    CBOR_UINT = 0,
+    CBOR_NEGINT = 1,
+    CBOR_ARRAY = 4,
+    CBOR_SIMPLE = 7, // floats, null
+};
+
+static const uint8_t CBOR_NULL = 0xf6;
+static const uint8_t CBOR_FLOAT32 = 0xfa;
+
+struct CborWriter
+{
+    uint8_t *buf;
+    size_t size;
+    size_t len = 0;
+    bool overflow = false;
+
+    CborWriter(uint8_t *buffer, size_t buffer_size) : buf(buffer), size(buffer_size) {}
+
+    bool overflowed() const
+    {
+        return overflow;
+    }
+
+    /// @return bytes written, 0 on overflow
+    size_t length() const
+    {
+        return overflow ? 0 : len;
+    }
+
+    void array(uint8_t count)
+    {
+        head(CBOR_ARRAY, count);
+    }
+
+    void uint(uint64_t v)
+    {
+        head(CBOR_UINT, v);
+    }
+
+    void integer(int64_t v)
+    {
+        if (v < 0)
+            head(CBOR_NEGINT, (uint64_t)(-(v + 1)));
+        else
+            head(CBOR_UINT, (uint64_t)v);
+    }
+
+    void float32(float v)
+    {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        put(CBOR_FLOAT32);
+        bigEndian(bits, 4);
+    }
+
+    void null()
+    {
+        put(CBOR_NULL);
+    }
+
+private:
+    void head(CborMajorType type, uint64_t v)
+    {
+        uint8_t major = type << 5;
+        if (v < 24)
+        {
+            put(major | v);
+        }
+        else if (v <= 0xff)
+        {
+            put(major | 24);
+            bigEndian(v, 1);
+        }
+        else if (v <= 0xffff)
+        {
+            put(major | 25);
+            bigEndian(v, 2);
+        }
+        else if (v <= 0xffffffffULL)
+        {
+            put(major | 26);
+            bigEndian(v, 4);
+        }
+        else
+        {
+            put(major | 27);
+            bigEndian(v, 8);
+        }
+    }
+
+    void bigEndian(uint64_t v, uint8_t bytes)
+    {
+        while (bytes--)
+            put((uint8_t)(v >> (bytes * 8)));
+    }
+
+    void put(uint8_t b)
+    {
+        if (overflow || len >= size)
+        {
+            overflow = true;
+            return;
+        }
+        buf[len++] = b;
+    }
+};
+
+struct CborReader
+{
+    const uint8_t *buf;
+    size_t size;
+    size_t pos = 0;
+    bool fail = false;
+
+    CborReader(const uint8_t *buffer, size_t buffer_size) : buf(buffer), size(buffer_size) {}
+
+    /// @brief true once a read ran past the buffer or met an unexpected type
+    bool failed() const
+    {
+        return fail;
+    }
+
+    /// @return element count of a definite-length array
+    uint8_t array()
+    {
+        uint64_t n;
+        if (!head(CBOR_ARRAY, n) || n > 0xff)
+            return error();
+        return (uint8_t)n;
+    }
+
+    uint64_t uint()
+    {
+        uint64_t v;
+        return head(CBOR_UINT, v) ? v : error();
+    }
+
+    int64_t integer()
+    {
+        if (pos < size && (buf[pos] >> 5) == CBOR_NEGINT)
+        {
+            uint64_t v = 0;
+            head(CBOR_NEGINT, v);
+            return -1 - (int64_t)v;
+        }
+        return (int64_t)uint();
+    }
+
+    /// @brief Next item if it is null (consumed), false otherwise (not consumed)
+    bool null()
+    {
+        if (pos < size && buf[pos] == CBOR_NULL)
+        {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief An integer or single-precision float as a float
+    float number()
+    {
+        if (pos < size && buf[pos] == CBOR_FLOAT32)
+        {
+            if (size - pos < 5)
+                return error();
+            uint32_t bits = (uint32_t)bigEndian(pos + 1, 4);
+            pos += 5;
+            float v;
+            memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+        return (float)integer();
+    }
+
+private:
+    uint8_t error()
+    {
+        fail = true;
+        return 0;
+    }
+
+    bool head(CborMajorType type, uint64_t &v)
+    {
+        if (fail || pos >= size || (buf[pos] >> 5) != type)
+            return error();
+        uint8_t info = buf[pos] & 0x1f;
+        uint8_t bytes = info < 24 ? 0 : info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : 0xff;
+        if (bytes == 0xff || size - pos - 1 < bytes)
+            return error();
+        v = bytes == 0 ? info : bigEndian(pos + 1, bytes);
+        pos += 1 + bytes;
+        return true;
+    }
+
+    uint64_t bigEndian(size_t at, uint8_t bytes) const
+    {
+        uint64_t v = 0;
+        for (uint8_t i = 0; i < bytes; i++)
+            v = (v << 8) | buf[at + i];
+        return v;
+    }
+};
+
+#endif
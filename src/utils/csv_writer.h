@@ -0,0 +1,114 @@
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <Arduino.h>
+#include "number_format.h"
+
+/**
+ * @brief Batch CSV encoder: the rows of a sample in one caller-provided buffer
+ * @details Rows ("timestamp,value_type,value,unit,sensor") are appended in a single pass and separated by '\n', with
+ *          no trailing newline, so the whole batch is logged with one memoryDataLog() call and lands in the CSV file
+ *          as consecutive lines. Numbers are written by formatInt()/formatFixed(). A row that does not fit is not
+ *          written at all: row() returns false and the buffer keeps the complete rows before it.
+ */
+struct CsvWriter
+{
+    char *buf;
+    size_t size;
+    size_t len = 0;
+    uint8_t rows = 0;
+
+    CsvWriter(char *buffer, size_t buffer_size) : buf(buffer), size(buffer_size)
+    {
+        if (size > 0)
+            buf[0] = '\0';
+    }
+
+    size_t length() const
+    {
+        return len;
+    }
+
+    uint8_t count() const
+    {
+        return rows;
+    }
+
+    /// @brief Drop all rows, e.g. once the batch has been logged
+    void clear()
+    {
+        len = 0;
+        rows = 0;
+        if (size > 0)
+            buf[0] = '\0';
+    }
+
+    /// @brief Row with an integer value
+    bool row(const char *timestamp, const char *value_type, int32_t value, const char *unit, const char *sensor_type)
+    {
+        size_t mark = len;
+        if (!begin(timestamp, value_type) || !number(formatInt(buf + len, size - len, value)))
+            return rollback(mark);
+        return end(mark, unit, sensor_type);
+    }
+
+    /// @brief Row with a fixed-point value
+    /// @param decimals : digits after the decimal point
+    bool row(const char *timestamp, const char *value_type, float value, uint8_t decimals, const char *unit, const char *sensor_type)
+    {
+        size_t mark = len;
+        if (!begin(timestamp, value_type) || !number(formatFixed(buf + len, size - len, value, decimals)))
+            return rollback(mark);
+        return end(mark, unit, sensor_type);
+    }
+
+private:
+    bool begin(const char *timestamp, const char *value_type)
+    {
+        return (rows == 0 || put('\n')) && field(timestamp) && put(',') && field(value_type) && put(',');
+    }
+
+    bool end(size_t mark, const char *unit, const char *sensor_type)
+    {
+        if (!(put(',') && field(unit) && put(',') && field(sensor_type)))
+            return rollback(mark);
+        buf[len] = '\0';
+        rows++;
+        return true;
+    }
+
+    /// @param n : length written by a number formatter at buf + len, 0 if it did not fit
+    bool number(size_t n)
+    {
+        len += n;
+        return n > 0;
+    }
+
+    bool rollback(size_t mark)
+    {
+        len = mark;
+        if (size > 0)
+            buf[len] = '\0';
+        return false;
+    }
+
+    bool put(char c)
+    {
+        if (len + 1 >= size) // keep room for the terminator
+            return false;
+        buf[len++] = c;
+        return true;
+    }
+
+    bool field(const char *s)
+    {
+        size_t n = s ? strlen(s) : 0;
+        if (len + n >= size)
+            return false;
+        memcpy(buf + len, s, n);
+        len += n;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef DATETIME_H
+#define DATETIME_H
+
+#include <Arduino.h>
+#include "number_format.h"
+
+/// @brief Timezone offset of a clock that was set without one (e.g. NTP); formatted without a suffix
+#define TZ_OFFSET_UNKNOWN INT16_MIN
+
+/**
+ * @brief Point in time as captured at acquisition
+ * @details 64-bit UTC epoch plus the local timezone offset in minutes. Kept in binary form until a payload or log line
+ *          is written; formatISO8601() produces the text.
+ */
+struct Timestamp
+{
+    int64_t epoch = 0;                        // seconds since 1970-01-01T00:00:00Z, 0 = clock not set
+    int16_t tzOffsetMin = TZ_OFFSET_UNKNOWN; // local time - UTC [minutes]
+
+    bool isSet() const
+    {
+        return epoch > 0;
+    }
+
+    /// @brief Seconds since 1970 on the local wall clock
+    int64_t localEpoch() const
+    {
+        return tzOffsetMin == TZ_OFFSET_UNKNOWN ? epoch : epoch + (int64_t)tzOffsetMin * 60;
+    }
+};
+
+/// @brief Gregorian date from days since 1970-01-01 (H. Hinnant's civil_from_days)
+static void civilFromDays(int64_t days, int32_t &year, uint8_t &month, uint8_t &day)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const uint32_t doe = (uint32_t)(days - era * 146097);                 // [0, 146096]
+    const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+    const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);          // [0, 365]
+    const uint32_t mp = (5 * doy + 2) / 153;                               // [0, 11]
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = (int32_t)(yoe + era * 400) + (month <= 2);
+}
+
+/// @brief Days since 1970-01-01 of a Gregorian date (H. Hinnant's days_from_civil)
+static int64_t daysFromCivil(int32_t year, uint8_t month, uint8_t day)
+{
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t yoe = (uint32_t)(year - era * 400);                         // [0, 399]
+    const uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1; // [0, 365]
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                // [0, 146096]
+    return (int64_t)era * 146097 + (int64_t)doe - 719468;
+}
+
+/// @brief Days in a month of the Gregorian calendar, with February 29 in leap years
+static uint8_t daysInMonth(int32_t year, uint8_t month)
+{
+    static const uint8_t DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))
+        return 29;
+    return DAYS[month - 1];
+}
+
+/**
+ * @brief Timezone suffix of an ISO 8601 timestamp
+ * @details Empty for TZ_OFFSET_UNKNOWN, "+HH" for whole hours (as the modem time has always been reported),
+ *          "+HH:MM" otherwise.
+ * @return length written, excluding the terminator; 0 if it does not fit
+ */
+static size_t formatTZOffset(char *buf, size_t size, int16_t tzOffsetMin)
+{
+    if (size == 0)
+        return 0;
+    buf[0] = '\0';
+    if (tzOffsetMin == TZ_OFFSET_UNKNOWN)
+        return 0;
+
+    int offset = tzOffsetMin < 0 ? -tzOffsetMin : tzOffsetMin;
+    uint8_t hours = offset / 60, minutes = offset % 60;
+    size_t n = minutes == 0 ? 3 : 6;
+    if (hours > 99 || n >= size)
+        return 0;
+    buf[0] = tzOffsetMin < 0 ? '-' : '+';
+    putTwoDigits(buf + 1, hours);
+    if (minutes != 0)
+    {
+        buf[3] = ':';
+        putTwoDigits(buf + 4, minutes);
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+/**
+ * @brief Format a timestamp as local ISO 8601 time, e.g. 2025-02-24T08:55:53+03
+ * @param buf : output buffer, 26 bytes always suffice
+ * @return length written excluding the terminator; 0 (empty string) if the timestamp is not set, lies outside
+ *         years 0000-9999 or does not fit
+ */
+static size_t formatISO8601(char *buf, size_t size, const Timestamp &t)
+{
+    static const size_t DATETIME_LEN = 19; // YYYY-MM-DDThh:mm:ss
+    if (size == 0)
+        return 0;
+    buf[0] = '\0';
+    if (!t.isSet() || size <= DATETIME_LEN)
+        return 0;
+
+    int64_t local = t.localEpoch();
+    int64_t days = local / 86400;
+    int32_t secs = (int32_t)(local % 86400);
+    if (secs < 0)
+    {
+        secs += 86400;
+        days--;
+    }
+    int32_t year;
+    uint8_t month, day;
+    civilFromDays(days, year, month, day);
+    if (year < 0 || year > 9999)
+        return 0;
+
+    putTwoDigits(buf, year / 100);
+    putTwoDigits(buf + 2, year % 100);
+    buf[4] = '-';
+    putTwoDigits(buf + 5, month);
+    buf[7] = '-';
+    putTwoDigits(buf + 8, day);
+    buf[10] = 'T';
+    putTwoDigits(buf + 11, secs / 3600);
+    buf[13] = ':';
+    putTwoDigits(buf + 14, secs / 60 % 60);
+    buf[16] = ':';
+    putTwoDigits(buf + 17, secs % 60);
+    buf[DATETIME_LEN] = '\0';
+
+    size_t n = formatTZOffset(buf + DATETIME_LEN, size - DATETIME_LEN, t.tzOffsetMin);
+    if (n == 0 && t.tzOffsetMin != TZ_OFFSET_UNKNOWN)
+    {
+        buf[0] = '\0'; // no timestamp rather than one without its offset
+        return 0;
+    }
+    return DATETIME_LEN + n;
+}
+
+/// @brief Two ASCII digits to a number, -1 if either is not a digit
+static inline int parseTwoDigits(const char *p)
+{
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9')
+        return -1;
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+/**
+ * @brief Parse the modem clock, "yy/MM/dd,hh:mm:ss±zz" (AT+CCLK), surrounding quotes allowed
+ * @param s : modem time string
+ * @param out : UTC epoch and timezone offset of the time
+ * @param quarterHours : zz counts quarters of an hour (Quectel, range -48..+56) rather than hours
+ * @return false if the string is malformed or a field is out of range (including a day past the end of the month);
+ *         out is left untouched
+ */
+static bool parseModemTime(const char *s, Timestamp &out, bool quarterHours = true)
+{
+    if (s == nullptr)
+        return false;
+    if (*s == '"')
+        s++;
+    // yy/MM/dd,hh:mm:ss±zz
+    // 01234567890123456789
+    size_t len = strnlen(s, 21);
+    if (len < 17)
+        return false;
+    static const char separators[] = "//,::";
+    static const uint8_t separatorAt[] = {2, 5, 8, 11, 14};
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        if (s[separatorAt[i]] != separators[i])
+            return false;
+    }
+
+    int year = parseTwoDigits(s);
+    int month = parseTwoDigits(s + 3);
+    int day = parseTwoDigits(s + 6);
+    int hour = parseTwoDigits(s + 9);
+    int minute = parseTwoDigits(s + 12);
+    int second = parseTwoDigits(s + 15);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > daysInMonth(2000 + year, month) ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 59)
+        return false;
+
+    int16_t offset = TZ_OFFSET_UNKNOWN;
+    char sign = s[17];
+    if (sign == '+' || sign == '-')
+    {
+        if (len < 20)
+            return false;
+        int zone = parseTwoDigits(s + 18);
+        if (zone < 0 || (s[20] != '\0' && s[20] != '"'))
+            return false;
+        offset = quarterHours ? zone * 15 : zone * 60;
+        if (sign == '-')
+            offset = -offset;
+    }
+    else if (sign != '\0' && sign != '"')
+    {
+        return false;
+    }
+
+    int64_t local = daysFromCivil(2000 + year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    out.epoch = offset == TZ_OFFSET_UNKNOWN ? local : local - (int64_t)offset * 60;
+    out.tzOffsetMin = offset;
+    return true;
+}
+
+/**
+ * @brief Parse an ISO 8601 timestamp as written by formatISO8601(), "YYYY-MM-DDThh:mm:ss[±HH[:MM]]"
+ * @param s : timestamp text
+ * @param out : UTC epoch and timezone offset; TZ_OFFSET_UNKNOWN without a suffix
+ * @return false if the text is malformed or a field is out of range (including a day past the end of the month);
+ *         out is left untouched
+ */
+static bool parseISO8601(const char *s, Timestamp &out)
+{
+    if (s == nullptr)
+        return false;
+    // YYYY-MM-DDThh:mm:ss±HH:MM
+    // 0123456789012345678901234
+    size_t len = strnlen(s, 26);
+    if (len != 19 && len != 22 && len != 25)
+        return false;
+    static const char separators[] = "--T::";
+    static const uint8_t separatorAt[] = {4, 7, 10, 13, 16};
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        if (s[separatorAt[i]] != separators[i])
+            return false;
+    }
+
+    int century = parseTwoDigits(s);
+    int year = parseTwoDigits(s + 2);
+    int month = parseTwoDigits(s + 5);
+    int day = parseTwoDigits(s + 8);
+    int hour = parseTwoDigits(s + 11);
+    int minute = parseTwoDigits(s + 14);
+    int second = parseTwoDigits(s + 17);
+    if (century < 0 || year < 0 || month < 1 || month > 12 ||
+        day < 1 || day > daysInMonth(century * 100 + year, month) ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 59)
+        return false;
+
+    int16_t offset = TZ_OFFSET_UNKNOWN;
+    if (len > 19)
+    {
+        int zoneHours = parseTwoDigits(s + 20);
+        int zoneMinutes = len == 25 ? parseTwoDigits(s + 23) : 0;
+        if ((s[19] != '+' && s[19] != '-') || zoneHours < 0 || zoneMinutes < 0 || zoneMinutes > 59 ||
+            (len == 25 && s[22] != ':'))
+            return false;
+        offset = zoneHours * 60 + zoneMinutes;
+        if (s[19] == '-')
+            offset = -offset;
+    }
+
+    int64_t local = daysFromCivil(century * 100 + year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    out.epoch = offset == TZ_OFFSET_UNKNOWN ? local : local - (int64_t)offset * 60;
+    out.tzOffsetMin = offset;
+    return true;
+}
+
+#endif
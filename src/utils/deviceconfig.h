@@ -56,9 +56,26 @@ struct DeviceConfig
     bool useWiFi;
     bool useGSM;
     bool isLive;
-    char active_api_url[128] = {};
+    char active_api_url[128] = {}; // where payloads go without fan_out: production_url if isLive, else staging_url
     char staging_url[128] = {};
     char production_url[128] = {};
+    bool adaptive_sampling = ADAPTIVE_SAMPLING;
+    unsigned long sampling_interval_min_ms = SAMPLING_INTERVAL_MIN_MS;
+    unsigned long sampling_interval_max_ms = SAMPLING_INTERVAL_MAX_MS;
+    float pm25_fast_rate = PM25_FAST_RATE_UGM3_PER_MIN;     // [ug/m3 per minute]
+    float pm25_stable_rate = PM25_STABLE_RATE_UGM3_PER_MIN; // [ug/m3 per minute]
+    uint16_t pm25_thresholds[4] = PM25_THRESHOLDS_UGM3;     // [ug/m3], 0 = unused
+    bool binary_backlog = BINARY_BACKLOG;
+    bool cbor_uplink = CBOR_UPLINK;
+    bool staging_gzip = STAGING_GZIP;       // Content-Encoding: gzip towards staging_url
+    bool production_gzip = PRODUCTION_GZIP; // Content-Encoding: gzip towards production_url
+    bool batch_upload = BATCH_UPLOAD;
+    uint8_t batch_max_records = BATCH_MAX_RECORDS;
+    uint16_t batch_max_bytes = BATCH_MAX_BYTES;
+    bool fan_out = FAN_OUT; // send to production_url and staging_url alike
+    uint8_t aggregation = AGGREGATION_MODE; // AggregationMode: 0 off, 1 always, 2 only while the uplink is GSM
+    uint32_t aggregation_window_s = AGGREGATION_WINDOW_S;
+    uint8_t sample_queue_policy = SAMPLE_QUEUE_POLICY; // SampleQueuePolicy: 0 block, 1 drop oldest, 2 spill to SD
 };
 
 extern struct DeviceConfig DeviceConfig;
@@ -87,6 +104,30 @@ static JsonDocument getRuntimeDeviceConfig()
     doc["stagingUrl"] = DeviceConfig.staging_url;
     doc["productionUrl"] = DeviceConfig.production_url;
     doc["isLive"] = DeviceConfig.isLive;
+    doc["adaptiveSampling"] = DeviceConfig.adaptive_sampling;
+    doc["samplingMinMs"] = DeviceConfig.sampling_interval_min_ms;
+    doc["samplingMaxMs"] = DeviceConfig.sampling_interval_max_ms;
+    doc["pm25FastRate"] = DeviceConfig.pm25_fast_rate;
+    doc["pm25StableRate"] = DeviceConfig.pm25_stable_rate;
+    JsonArray thresholds = doc["pm25Thresholds"].to<JsonArray>();
+    for (uint16_t t : DeviceConfig.pm25_thresholds)
+    {
+        if (t != 0)
+            thresholds.add(t);
+    }
+    doc["binaryBacklog"] = DeviceConfig.binary_backlog;
+    doc["cborUplink"] = DeviceConfig.cbor_uplink;
+    doc["stagingGzip"] = DeviceConfig.staging_gzip;
+    doc["productionGzip"] = DeviceConfig.production_gzip;
+    doc["batchUpload"] = DeviceConfig.batch_upload;
+    doc["batchMaxRecords"] = DeviceConfig.batch_max_records;
+    doc["batchMaxBytes"] = DeviceConfig.batch_max_bytes;
+    doc["fanOut"] = DeviceConfig.fan_out;
+    static const char *const aggregation_modes[] = {"off", "always", "gsm"};
+    doc["aggregation"] = aggregation_modes[DeviceConfig.aggregation < 3 ? DeviceConfig.aggregation : 0];
+    doc["aggregationWindowS"] = DeviceConfig.aggregation_window_s;
+    static const char *const sample_queue_policies[] = {"block", "dropOldest", "spill"};
+    doc["sampleQueuePolicy"] = sample_queue_policies[DeviceConfig.sample_queue_policy < 3 ? DeviceConfig.sample_queue_policy : 0];
     return doc;
 }
 
@@ -271,17 +312,101 @@ static void loadSavedDeviceConfigs(bool setConfigStates)
     }
     if (hasString(config["isLive"]))
     {
-        bool val = config["isLive"].as<bool>();
-        DeviceConfig.isLive = val;
-        if (val)
+        DeviceConfig.isLive = config["isLive"].as<bool>();
+    }
+    // after both URLs: a changed URL must not leave the old one active
+    strcpy(DeviceConfig.active_api_url, DeviceConfig.isLive ? DeviceConfig.production_url : DeviceConfig.staging_url);
+
+    if (hasString(config["adaptiveSampling"]))
+    {
+        DeviceConfig.adaptive_sampling = config["adaptiveSampling"].as<bool>();
+    }
+    if (hasString(config["samplingMinMs"]))
+    {
+        DeviceConfig.sampling_interval_min_ms = config["samplingMinMs"].as<unsigned long>();
+    }
+    if (hasString(config["samplingMaxMs"]))
+    {
+        DeviceConfig.sampling_interval_max_ms = config["samplingMaxMs"].as<unsigned long>();
+    }
+    if (hasString(config["pm25FastRate"]))
+    {
+        DeviceConfig.pm25_fast_rate = config["pm25FastRate"].as<float>();
+    }
+    if (hasString(config["pm25StableRate"]))
+    {
+        DeviceConfig.pm25_stable_rate = config["pm25StableRate"].as<float>();
+    }
+    if (config["pm25Thresholds"].is<JsonArray>())
+    {
+        JsonArray thresholds = config["pm25Thresholds"].as<JsonArray>();
+        size_t n = 0;
+        for (JsonVariant t : thresholds)
         {
-            strcpy(DeviceConfig.active_api_url, DeviceConfig.production_url);
+            if (n >= sizeof(DeviceConfig.pm25_thresholds) / sizeof(DeviceConfig.pm25_thresholds[0]))
+                break;
+            DeviceConfig.pm25_thresholds[n++] = t.as<uint16_t>();
         }
-        else
+        for (; n < sizeof(DeviceConfig.pm25_thresholds) / sizeof(DeviceConfig.pm25_thresholds[0]); n++)
         {
-            strcpy(DeviceConfig.active_api_url, DeviceConfig.staging_url);
+            DeviceConfig.pm25_thresholds[n] = 0;
         }
     }
+    if (hasString(config["binaryBacklog"]))
+    {
+        DeviceConfig.binary_backlog = config["binaryBacklog"].as<bool>();
+    }
+    if (hasString(config["cborUplink"]))
+    {
+        DeviceConfig.cbor_uplink = config["cborUplink"].as<bool>();
+    }
+    if (hasString(config["stagingGzip"]))
+    {
+        DeviceConfig.staging_gzip = config["stagingGzip"].as<bool>();
+    }
+    if (hasString(config["productionGzip"]))
+    {
+        DeviceConfig.production_gzip = config["productionGzip"].as<bool>();
+    }
+    if (hasString(config["batchUpload"]))
+    {
+        DeviceConfig.batch_upload = config["batchUpload"].as<bool>();
+    }
+    if (hasString(config["batchMaxRecords"]))
+    {
+        DeviceConfig.batch_max_records = config["batchMaxRecords"].as<uint8_t>();
+    }
+    if (hasString(config["batchMaxBytes"]))
+    {
+        DeviceConfig.batch_max_bytes = config["batchMaxBytes"].as<uint16_t>();
+    }
+    if (hasString(config["fanOut"]))
+    {
+        DeviceConfig.fan_out = config["fanOut"].as<bool>();
+    }
+    if (hasString(config["aggregation"]))
+    {
+        // "off", "always", "gsm" or the mode number
+        const char *mode = config["aggregation"].as<const char *>();
+        if (mode == nullptr)
+            DeviceConfig.aggregation = config["aggregation"].as<uint8_t>() < 3 ? config["aggregation"].as<uint8_t>() : 0;
+        else
+            DeviceConfig.aggregation = strcmp(mode, "always") == 0 ? 1 : strcmp(mode, "gsm") == 0 ? 2 : 0;
+    }
+    if (hasString(config["aggregationWindowS"]))
+    {
+        uint32_t window = config["aggregationWindowS"].as<uint32_t>();
+        DeviceConfig.aggregation_window_s = window >= 60 ? window : 60;
+    }
+    if (hasString(config["sampleQueuePolicy"]))
+    {
+        // "block", "dropOldest", "spill" or the policy number
+        const char *policy = config["sampleQueuePolicy"].as<const char *>();
+        if (policy == nullptr)
+            DeviceConfig.sample_queue_policy = config["sampleQueuePolicy"].as<uint8_t>() < 3 ? config["sampleQueuePolicy"].as<uint8_t>() : 0;
+        else
+            DeviceConfig.sample_queue_policy = strcmp(policy, "dropOldest") == 0 ? 1 : strcmp(policy, "spill") == 0 ? 2 : 0;
+    }
 
     gsmUpdated = apnPwdUpdated || apnPwdUpdated || pinUpdated;
     wiFiUpdated = wifiSSIDUpdated || wifiPwdUpdated;
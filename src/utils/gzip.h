@@ -0,0 +1,233 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Small gzip (RFC 1952) encoder for HTTP request bodies
+ * @details Deflate (RFC 1951) with a single fixed-Huffman block: LZ77 matches over a GZIP_WINDOW byte window found
+ *          through a hash chain, literal/length and distance codes from the fixed tables, so no code tables are built
+ *          or sent. The whole state is ~3 KB and lives in the encoder object; the body is read from the caller's buffer
+ *          and the bit stream written straight into the output buffer. Repetitive JSON (the keys of batched payloads)
+ *          shrinks to a fraction; short bodies may not shrink at all, see compress().
+ */
+
+#define GZIP_WINDOW 1024    // farthest match distance [bytes], power of two
+#define GZIP_HASH_BITS 9    // 512 hash chains
+#define GZIP_MAX_CHAIN 16   // candidates tried per position
+#define GZIP_HEADER_SIZE 10 // + 8 byte trailer
+
+struct GzipEncoder
+{
+    static const uint16_t MIN_MATCH = 3;
+    static const uint16_t MAX_MATCH = 258;
+    static const uint16_t MAX_INPUT_BYTES = 0xffff; // positions are kept as uint16_t; not MAX_INPUT, a <limits.h> macro
+
+    /**
+     * @brief Compress a buffer into a gzip member
+     * @return length of the gzip data; 0 if it would not be smaller than the input, does not fit in out or the input
+     *         exceeds MAX_INPUT_BYTES (send the body uncompressed then)
+     */
+    size_t compress(const uint8_t *in, size_t n, uint8_t *out, size_t size)
+    {
+        if (n == 0 || n > MAX_INPUT_BYTES || size < GZIP_HEADER_SIZE + 8)
+            return 0;
+        if (size >= n)
+            size = n - 1; // smaller than the input or nothing
+        begin(out, size);
+        static const uint8_t header[GZIP_HEADER_SIZE] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff}; // deflate, no mtime, OS unknown
+        for (uint8_t b : header)
+            putByte(b);
+
+        putBits(1, 1); // BFINAL
+        putBits(1, 2); // BTYPE = fixed Huffman
+        memset(head, 0, sizeof(head));
+        size_t pos = 0;
+        while (pos < n && !overflow)
+        {
+            uint16_t distance = 0;
+            uint16_t length = longestMatch(in, n, pos, distance);
+            if (length >= MIN_MATCH)
+            {
+                putLength(length);
+                putDistance(distance);
+                for (uint16_t i = 0; i < length; i++)
+                    insert(in, n, pos + i);
+                pos += length;
+            }
+            else
+            {
+                putLiteral(in[pos]);
+                insert(in, n, pos);
+                pos++;
+            }
+        }
+        putLiteral(256); // end of block
+        flushBits();
+
+        uint32_t crc = crc32(in, n);
+        for (uint8_t i = 0; i < 4; i++)
+            putByte(crc >> (8 * i));
+        for (uint8_t i = 0; i < 4; i++)
+            putByte((uint32_t)n >> (8 * i));
+        return overflow ? 0 : len;
+    }
+
+    /// @brief CRC-32 (IEEE 802.3) with a 16-entry table
+    static uint32_t crc32(const uint8_t *data, size_t n)
+    {
+        static const uint32_t nibble[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+        uint32_t crc = 0xffffffff;
+        for (size_t i = 0; i < n; i++)
+        {
+            crc = nibble[(crc ^ data[i]) & 0x0f] ^ (crc >> 4);
+            crc = nibble[(crc ^ (data[i] >> 4)) & 0x0f] ^ (crc >> 4);
+        }
+        return ~crc;
+    }
+
+private:
+    uint16_t head[1 << GZIP_HASH_BITS]; // last position + 1 per hash, 0 = none
+    uint16_t prev[GZIP_WINDOW];         // previous position + 1 with the same hash
+    uint8_t *out = nullptr;
+    size_t size = 0;
+    size_t len = 0;
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    bool overflow = false;
+
+    static uint16_t hash(const uint8_t *p)
+    {
+        return ((p[0] << 6) ^ (p[1] << 3) ^ p[2]) & ((1 << GZIP_HASH_BITS) - 1);
+    }
+
+    void insert(const uint8_t *in, size_t n, size_t pos)
+    {
+        if (pos + MIN_MATCH > n)
+            return;
+        uint16_t h = hash(in + pos);
+        prev[pos & (GZIP_WINDOW - 1)] = head[h];
+        head[h] = pos + 1;
+    }
+
+    uint16_t longestMatch(const uint8_t *in, size_t n, size_t pos, uint16_t &distance) const
+    {
+        if (pos + MIN_MATCH > n)
+            return 0;
+        size_t limit = n - pos < MAX_MATCH ? n - pos : MAX_MATCH;
+        uint16_t best = 0;
+        uint16_t candidate = head[hash(in + pos)];
+        for (uint8_t chain = 0; candidate != 0 && chain < GZIP_MAX_CHAIN; chain++)
+        {
+            size_t from = candidate - 1;
+            if (pos - from > GZIP_WINDOW)
+                break;
+            uint16_t l = 0;
+            while (l < limit && in[from + l] == in[pos + l])
+                l++;
+            if (l > best)
+            {
+                best = l;
+                distance = pos - from;
+                if (l == limit)
+                    break;
+            }
+            uint16_t next = prev[from & (GZIP_WINDOW - 1)];
+            if (next >= candidate) // slot reused by a newer position
+                break;
+            candidate = next;
+        }
+        return best;
+    }
+
+    void begin(uint8_t *buffer, size_t buffer_size)
+    {
+        out = buffer;
+        size = buffer_size;
+        len = 0;
+        bits = 0;
+        bitCount = 0;
+        overflow = false;
+    }
+
+    void putByte(uint8_t b)
+    {
+        if (len >= size)
+        {
+            overflow = true;
+            return;
+        }
+        out[len++] = b;
+    }
+
+    /// @brief Bits LSB first, as deflate packs data elements
+    void putBits(uint32_t value, uint8_t count)
+    {
+        bits |= value << bitCount;
+        bitCount += count;
+        while (bitCount >= 8)
+        {
+            putByte(bits);
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    /// @brief Huffman codes go MSB first
+    void putCode(uint16_t code, uint8_t count)
+    {
+        uint16_t reversed = 0;
+        for (uint8_t i = 0; i < count; i++)
+            reversed |= ((code >> i) & 1) << (count - 1 - i);
+        putBits(reversed, count);
+    }
+
+    void flushBits()
+    {
+        if (bitCount > 0)
+            putByte(bits);
+        bits = 0;
+        bitCount = 0;
+    }
+
+    /// @brief Fixed literal/length code (RFC 1951 3.2.6)
+    void putLiteral(uint16_t symbol)
+    {
+        if (symbol < 144)
+            putCode(0x30 + symbol, 8);
+        else if (symbol < 256)
+            putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+            putCode(symbol - 256, 7);
+        else
+            putCode(0xc0 + symbol - 280, 8);
+    }
+
+    void putLength(uint16_t length)
+    {
+        static const uint16_t base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint8_t extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                          3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        uint8_t i = 28;
+        while (base[i] > length)
+            i--;
+        putLiteral(257 + i);
+        putBits(length - base[i], extra[i]);
+    }
+
+    void putDistance(uint16_t distance)
+    {
+        static const uint16_t base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                          257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        uint8_t i = 29;
+        while (base[i] > distance)
+            i--;
+        putCode(i, 5);
+        putBits(distance - base[i], i < 4 ? 0 : i / 2 - 1);
+    }
+};
+
+#endif
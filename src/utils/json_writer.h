@@ -0,0 +1,312 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+#include <math.h>
+#include "number_format.h"
+
+/// @brief Decimal places ArduinoJson 7 gives a float
+static const int8_t JSON_FLOAT_DECIMALS = 6;
+
+/**
+ * @brief Bring v (> 0) into [1, 10) if it is at least 1e7 or at most 1e-5, as ArduinoJson's normalize()
+ * @details Divides or multiplies by 10^256 .. 10^1 in turn, with the same double constants and in the same order,
+ *          so the remaining mantissa is bit for bit the one ArduinoJson rounds.
+ * @return the power of ten taken out of v
+ */
+static int16_t normalizeJsonFloat(double &v)
+{
+    static const double positive[] = {1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256};
+    static const double negative[] = {1e-1, 1e-2, 1e-4, 1e-8, 1e-16, 1e-32, 1e-64, 1e-128, 1e-256};
+    int16_t exponent = 0;
+    int8_t index = 8;
+    int16_t bit = 1 << 8;
+    if (v >= 1e7)
+    {
+        for (; index >= 0; index--, bit >>= 1)
+            if (v >= positive[index])
+            {
+                v *= negative[index];
+                exponent += bit;
+            }
+    }
+    if (v > 0 && v <= 1e-5)
+    {
+        for (; index >= 0; index--, bit >>= 1)
+            if (v < negative[index] * 10)
+            {
+                v *= positive[index];
+                exponent -= bit;
+            }
+    }
+    return exponent;
+}
+
+/**
+ * @brief JSON number of a float, byte for byte as ArduinoJson 7 serializes it; NaN/inf as null
+ * @details Port of ArduinoJson's decomposeFloat(): JSON_FLOAT_DECIMALS places shared between the integral and the
+ *          decimal digits, the last one rounded half up, trailing zeros dropped, and a power of ten ("1.5e7", "2e-6")
+ *          outside (1e-5, 1e7). -0 is written as 0.
+ * @return length written excluding the terminator, 0 (empty string) if it does not fit
+ */
+static size_t formatJsonFloat(char *buf, size_t size, float v)
+{
+    if (isnan(v) || isinf(v))
+        return putFormatted(buf, size, "null", 4);
+
+    double value = v; // ArduinoJson's JsonFloat
+    bool negative = value < 0;
+    if (negative)
+        value = -value;
+    int16_t exponent = normalizeJsonFloat(value);
+
+    uint32_t integral = (uint32_t)value;
+    int8_t places = JSON_FLOAT_DECIMALS;
+    uint32_t maxDecimal = POW10[JSON_FLOAT_DECIMALS];
+    for (uint32_t digits = integral; digits >= 10; digits /= 10)
+    {
+        maxDecimal /= 10;
+        places--;
+    }
+    double remainder = (value - (double)integral) * maxDecimal;
+    uint32_t decimal = (uint32_t)remainder;
+    decimal += (uint32_t)((remainder - decimal) * 2); // half up
+    if (decimal >= maxDecimal)
+    {
+        decimal = 0;
+        integral++;
+        if (exponent && integral >= 10)
+        {
+            exponent++;
+            integral = 1;
+        }
+    }
+    while (places > 0 && decimal % 10 == 0)
+    {
+        decimal /= 10;
+        places--;
+    }
+
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    size_t n = 0;
+    if (exponent)
+    {
+        n = putDigitsBackwards(end, exponent < 0 ? -exponent : exponent);
+        if (exponent < 0)
+            tmp[sizeof(tmp) - ++n] = '-';
+        tmp[sizeof(tmp) - ++n] = 'e';
+    }
+    if (places > 0)
+    {
+        size_t digits = putDigitsBackwards(end - n, decimal);
+        for (n += digits; digits < (size_t)places; digits++) // leading zeros of the decimals
+            tmp[sizeof(tmp) - ++n] = '0';
+        tmp[sizeof(tmp) - ++n] = '.';
+    }
+    n += putDigitsBackwards(end - n, integral);
+    if (negative)
+        tmp[sizeof(tmp) - ++n] = '-';
+    return putFormatted(buf, size, end - n, n);
+}
+
+/**
+ * @brief JSON number of a sensor value with a fixed number of decimals, see formatFixed(); NaN/inf as null
+ * @return length written excluding the terminator, 0 (empty string) if it does not fit
+ */
+static size_t formatJsonFixed(char *buf, size_t size, float v, uint8_t decimals)
+{
+    if (isnan(v) || isinf(v))
+        return formatJsonFloat(buf, size, v);
+    return formatFixed(buf, size, v, decimals);
+}
+
+/**
+ * @brief Minimal JSON writer into a caller-provided buffer
+ * @details No heap, no intermediate document: tokens are appended as they are written. Output is compact and
+ *          matches serializeJson() for the types used in the sensor payloads (strings, integers, floats).
+ *          Once the buffer is full every further write is dropped and overflowed() turns true; the buffer then
+ *          holds an empty string rather than truncated JSON.
+ */
+struct JsonWriter
+{
+    char *buf;
+    size_t size;
+    size_t len = 0;
+    bool overflow = false;
+    bool needComma = false;
+
+    JsonWriter(char *buffer, size_t buffer_size) : buf(buffer), size(buffer_size)
+    {
+        if (size == 0)
+            overflow = true;
+        else
+            buf[0] = '\0';
+    }
+
+    bool overflowed() const
+    {
+        return overflow;
+    }
+
+    size_t length() const
+    {
+        return overflow ? 0 : len;
+    }
+
+    void beginObject()
+    {
+        separator();
+        put('{');
+        needComma = false;
+    }
+
+    void endObject()
+    {
+        put('}');
+        needComma = true;
+    }
+
+    void beginArray()
+    {
+        separator();
+        put('[');
+        needComma = false;
+    }
+
+    void endArray()
+    {
+        put(']');
+        needComma = true;
+    }
+
+    void key(const char *k)
+    {
+        separator();
+        string(k);
+        put(':');
+        needComma = false;
+    }
+
+    void value(const char *v)
+    {
+        separator();
+        string(v);
+        needComma = true;
+    }
+
+    void value(int32_t v)
+    {
+        separator();
+        char tmp[12];
+        int n = snprintf(tmp, sizeof(tmp), "%ld", (long)v);
+        write(tmp, n);
+        needComma = true;
+    }
+
+    /// @brief Float, see formatJsonFloat()
+    void value(float v)
+    {
+        separator();
+        char tmp[16];
+        write(tmp, formatJsonFloat(tmp, sizeof(tmp), v));
+        needComma = true;
+    }
+
+    /// @brief Float with a fixed number of decimals, see formatJsonFixed()
+    void value(float v, uint8_t decimals)
+    {
+        separator();
+        char tmp[24];
+        write(tmp, formatJsonFixed(tmp, sizeof(tmp), v, decimals));
+        needComma = true;
+    }
+
+    /// @brief Terminate the output; on overflow the buffer is left empty
+    /// @return length of the output, 0 on overflow
+    size_t finish()
+    {
+        if (overflow)
+        {
+            if (size > 0)
+                buf[0] = '\0';
+            return 0;
+        }
+        buf[len] = '\0';
+        return len;
+    }
+
+private:
+    void separator()
+    {
+        if (needComma)
+            put(',');
+    }
+
+    void put(char c)
+    {
+        if (overflow || len + 1 >= size) // keep room for the terminator
+        {
+            overflow = true;
+            return;
+        }
+        buf[len++] = c;
+    }
+
+    void write(const char *s, size_t n)
+    {
+        if (overflow || len + n >= size)
+        {
+            overflow = true;
+            return;
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+    }
+
+    void string(const char *s)
+    {
+        put('"');
+        for (; s && *s; s++)
+        {
+            char c = *s;
+            char esc = 0;
+            switch (c)
+            {
+            case '"':
+                esc = '"';
+                break;
+            case '\\':
+                esc = '\\';
+                break;
+            case '\b':
+                esc = 'b';
+                break;
+            case '\f':
+                esc = 'f';
+                break;
+            case '\n':
+                esc = 'n';
+                break;
+            case '\r':
+                esc = 'r';
+                break;
+            case '\t':
+                esc = 't';
+                break;
+            }
+            if (esc)
+            {
+                put('\\');
+                put(esc);
+            }
+            else
+            {
+                put(c);
+            }
+        }
+        put('"');
+    }
+};
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef LOG_ARENA_H
+#define LOG_ARENA_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Ring buffer of variable-length text records in a fixed byte budget
+ * @details Records are stored back to back as a 2-byte length, the bytes and a '\0', so each one can be used as a C
+ *          string where it lies; a 200-byte payload takes 203 bytes instead of a whole fixed-size slot. A record never
+ *          wraps: when it does not fit before the end of the buffer the rest of the end is skipped (marked with length
+ *          0xffff if there is room for it) and the record starts at offset 0. push() fails when neither the bytes nor
+ *          one of the record places are left; the oldest records come out with peek()/pop(), and all of them, oldest
+ *          first, with a range-for loop.
+ *          LogRing works on memory it is given with attach(), e.g. a PSRAM region; LogArena<Capacity, MaxRecords>
+ *          carries its own buffer.
+ */
+
+/// @brief A record as stored: data is '\0'-terminated, length excludes the terminator
+struct LogRecord
+{
+    const char *data;
+    uint16_t length;
+};
+
+struct LogRing
+{
+    class Iterator
+    {
+    public:
+        Iterator(const LogRing *arena, size_t pos, size_t left) : arena(arena), pos(pos), left(left)
+        {
+            if (left > 0)
+                this->pos = arena->recordStart(pos);
+        }
+
+        LogRecord operator*() const
+        {
+            return arena->recordAt(pos);
+        }
+
+        Iterator &operator++()
+        {
+            pos = arena->next(pos);
+            if (--left > 0)
+                pos = arena->recordStart(pos);
+            return *this;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return left != other.left;
+        }
+
+    private:
+        const LogRing *arena;
+        size_t pos;
+        size_t left;
+    };
+
+    static const size_t RECORD_OVERHEAD = 3; // length and terminator stored with each record
+
+    LogRing() = default;
+    LogRing(const LogRing &) = delete;
+    LogRing &operator=(const LogRing &) = delete;
+
+    /// @brief Use buffer (at least 4 bytes) for at most max_records records; the ring starts empty
+    void attach(uint8_t *buffer, size_t buffer_bytes, size_t max_records)
+    {
+        buf = buffer;
+        bytes = buffer ? buffer_bytes : 0;
+        maxRecords = max_records;
+        clear();
+    }
+
+    /// @brief Append a record; data need not be terminated
+    /// @return false if the arena has no room for it; nothing is stored then
+    bool push(const char *data, size_t length)
+    {
+        size_t need = length + RECORD_OVERHEAD;
+        if (length >= WRAP_MARKER || need > bytes || records >= maxRecords)
+            return false;
+        if (records == 0)
+            head = tail = used = 0;
+        else if (tail == head) // full
+            return false;
+
+        if (tail > head || records == 0) // free: [tail, bytes) and [0, head)
+        {
+            if (bytes - tail < need)
+            {
+                if (head < need)
+                    return false;
+                if (bytes - tail >= HEADER)
+                    writeLength(tail, WRAP_MARKER);
+                used += bytes - tail;
+                tail = 0;
+            }
+        }
+        else if (head - tail < need) // free: [tail, head)
+        {
+            return false;
+        }
+
+        writeLength(tail, length);
+        memcpy(buf + tail + HEADER, data, length);
+        buf[tail + HEADER + length] = '\0';
+        tail += need;
+        if (tail == bytes)
+            tail = 0;
+        used += need;
+        records++;
+        return true;
+    }
+
+    bool push(const char *text)
+    {
+        return push(text, strlen(text));
+    }
+
+    /// @brief Oldest record; data is nullptr if the arena is empty
+    LogRecord peek() const
+    {
+        if (records == 0)
+            return {nullptr, 0};
+        return recordAt(recordStart(head));
+    }
+
+    /// @brief Drop the oldest record
+    void pop()
+    {
+        if (records == 0)
+            return;
+        size_t start = recordStart(head);
+        if (start != head)
+            used -= bytes - head; // skipped end of the buffer
+        size_t end = next(start);
+        used -= end - start;
+        head = end == bytes ? 0 : end;
+        if (--records == 0)
+            head = tail = used = 0;
+    }
+
+    void clear()
+    {
+        head = tail = used = 0;
+        records = 0;
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(this, head, records);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(this, 0, 0);
+    }
+
+    size_t size() const
+    {
+        return records;
+    }
+
+    bool empty() const
+    {
+        return records == 0;
+    }
+
+    /// @brief Arena size in bytes, headers included; 0 if no memory is attached
+    size_t capacity() const
+    {
+        return bytes;
+    }
+
+    /// @brief Bytes taken by records, their headers and skipped buffer ends
+    size_t bytesUsed() const
+    {
+        return used;
+    }
+
+private:
+    static const size_t HEADER = 2;
+    static const uint16_t WRAP_MARKER = 0xffff;
+
+    uint8_t *buf = nullptr;
+    size_t bytes = 0;
+    size_t maxRecords = 0;
+    size_t head = 0; // oldest record, or the skipped end before it
+    size_t tail = 0; // where the next record goes
+    size_t used = 0;
+    size_t records = 0;
+
+    void writeLength(size_t pos, uint16_t length)
+    {
+        buf[pos] = length & 0xff;
+        buf[pos + 1] = length >> 8;
+    }
+
+    uint16_t readLength(size_t pos) const
+    {
+        return buf[pos] | (buf[pos + 1] << 8);
+    }
+
+    /// @brief Where the record at pos really starts: pos, or 0 if the end of the buffer was skipped
+    size_t recordStart(size_t pos) const
+    {
+        if (bytes - pos < HEADER + 1 || readLength(pos) == WRAP_MARKER)
+            return 0;
+        return pos;
+    }
+
+    /// @brief Offset just past the record starting at pos
+    size_t next(size_t pos) const
+    {
+        return pos + readLength(pos) + RECORD_OVERHEAD;
+    }
+
+    LogRecord recordAt(size_t pos) const
+    {
+        return {(const char *)buf + pos + HEADER, readLength(pos)};
+    }
+};
+
+template <size_t Capacity, size_t MaxRecords>
+struct LogArena : LogRing
+{
+    static_assert(Capacity >= 4, "LogArena capacity too small");
+
+    LogArena()
+    {
+        attach(storage, Capacity, MaxRecords);
+    }
+
+private:
+    uint8_t storage[Capacity];
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <PubSubClient.h>
 #include <WiFi.h>
+#include "../global_configs.h"
 
 // MQTT WiFi Global Variables
 WiFiClient espClient;
@@ -29,7 +30,8 @@ static bool wifiMQTTConnect(const char *broker, uint16_t port, const char *clien
         return false;
     }
 
-    if (!mqttClient.setBufferSize(2048))
+    // the buffer holds the whole packet: fixed header, topic and payload
+    if (!mqttClient.setBufferSize(MQTT_TELEMETRY_MAX_BYTES + 256))
     {
         Serial.println("wifiMQTTConnect: Failed to allocate MQTT buffer");
         return false;
@@ -0,0 +1,127 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <Arduino.h>
+#include <math.h>
+
+/**
+ * @brief Integer based number formatting for payloads and log lines
+ * @details Digits are produced two at a time from DIGIT_PAIRS; no printf, no heap. All functions write a terminated
+ *          string and return its length, or 0 with an empty string if it does not fit.
+ */
+
+/// @brief "00".."99", two characters per number
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static inline void putTwoDigits(char *p, uint8_t v)
+{
+    memcpy(p, &DIGIT_PAIRS[v * 2], 2);
+}
+
+static const uint32_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+/// @brief Largest number of decimals formatFixed() renders with integer arithmetic
+static const uint8_t FIXED_MAX_DECIMALS = 6;
+
+/// @brief Digits of v, right-aligned so that the last digit lands at end[-1]
+/// @return number of digits written
+static inline uint8_t putDigitsBackwards(char *end, uint32_t v)
+{
+    char *p = end;
+    while (v >= 100)
+    {
+        p -= 2;
+        putTwoDigits(p, v % 100);
+        v /= 100;
+    }
+    if (v >= 10)
+    {
+        p -= 2;
+        putTwoDigits(p, v);
+    }
+    else
+    {
+        *--p = '0' + v;
+    }
+    return end - p;
+}
+
+/// @brief Copy n characters and terminate, or leave an empty string if they do not fit
+static inline size_t putFormatted(char *buf, size_t size, const char *s, size_t n)
+{
+    if (size == 0)
+        return 0;
+    if (n >= size)
+    {
+        buf[0] = '\0';
+        return 0;
+    }
+    memcpy(buf, s, n);
+    buf[n] = '\0';
+    return n;
+}
+
+/// @brief Decimal integer, as "%ld"
+static size_t formatInt(char *buf, size_t size, int32_t value)
+{
+    char tmp[12];
+    char *end = tmp + sizeof(tmp);
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    size_t n = putDigitsBackwards(end, magnitude);
+    if (value < 0)
+        tmp[sizeof(tmp) - ++n] = '-';
+    return putFormatted(buf, size, end - n, n);
+}
+
+/**
+ * @brief Fixed-point decimal, as "%.*f"
+ * @details The value is scaled by 10^decimals, which is exact in a double for a float input, and rounded to an
+ *          integer (ties to even) whose digits are split around the decimal point. Output is identical to printf.
+ *          Magnitudes beyond 32 bits once scaled, NaN and inf fall back to snprintf.
+ * @param decimals : digits after the decimal point, at most FIXED_MAX_DECIMALS
+ */
+static size_t formatFixed(char *buf, size_t size, float value, uint8_t decimals)
+{
+    if (decimals > FIXED_MAX_DECIMALS)
+        decimals = FIXED_MAX_DECIMALS;
+    double scaled = fabs((double)value) * POW10[decimals]; // exact: 24-bit mantissa times at most 20 bits
+    if (!(scaled < 4294967295.0)) // also catches NaN
+    {
+        char tmp[48];
+        int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, (double)value);
+        return putFormatted(buf, size, tmp, n > 0 ? (size_t)n : 0);
+    }
+
+    uint32_t fixed = (uint32_t)scaled;
+    double remainder = scaled - fixed;
+    if (remainder > 0.5 || (remainder == 0.5 && (fixed & 1))) // ties to even, as printf
+        fixed++;
+    char tmp[20];
+    char *end = tmp + sizeof(tmp);
+    size_t n = 0;
+    if (decimals > 0)
+    {
+        uint32_t fraction = fixed % POW10[decimals];
+        n = putDigitsBackwards(end, fraction);
+        while (n < decimals) // leading zeros of the fraction
+            tmp[sizeof(tmp) - ++n] = '0';
+        tmp[sizeof(tmp) - ++n] = '.';
+        fixed /= POW10[decimals];
+    }
+    n += putDigitsBackwards(end - n, fixed);
+    if (signbit(value))
+        tmp[sizeof(tmp) - ++n] = '-';
+    return putFormatted(buf, size, end - n, n);
+}
+
+#endif
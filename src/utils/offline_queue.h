@@ -0,0 +1,61 @@
+#ifndef OFFLINE_QUEUE_H
+#define OFFLINE_QUEUE_H
+
+#include <Arduino.h>
+#include "log_arena.h"
+
+/**
+ * @brief Deep queue of pending sample records in PSRAM, between the memory logger and the SD card
+ * @details When the JSON memory logger fills up while no link is up (preferredComm NONE), its records move here
+ *          instead of to the SD card; with a link the logger is sent as before. They stay SampleRecords and are only
+ *          rendered when sent or spilled; with 1 MB this holds about 29900 of them, well over a month of 5-minute PMS
+ *          and DHT samples. The queue is sent before the memory logger once a link is back; it is written to the SD
+ *          retry stores only when it is full or, since PSRAM does not survive a reset, once its oldest record has
+ *          waited PSRAM_QUEUE_FLUSH_MS.
+ *          On the ESP32 the region comes from ps_malloc() and the tier stays off if no PSRAM was found; host builds
+ *          simulate it with a plain heap region.
+ */
+struct OfflineQueue
+{
+    LogRing records;
+    bool psram = false;            // the region is in PSRAM
+    uint32_t spilled = 0;          // records written to the SD card from here
+    uint32_t flushes = 0;          // timed flushes
+    unsigned long queuedSince = 0; // millis() when the oldest queued record arrived
+
+    /**
+     * @brief Allocate the region
+     * @param bytes : 0 leaves the tier off
+     * @return true if the tier is on
+     */
+    bool begin(size_t bytes)
+    {
+        if (bytes == 0 || records.capacity() > 0)
+            return records.capacity() > 0;
+        uint8_t *region = nullptr;
+#if defined(ESP32)
+        if (psramFound())
+        {
+            region = (uint8_t *)ps_malloc(bytes);
+            psram = region != nullptr;
+        }
+#else
+        region = (uint8_t *)malloc(bytes);
+#endif
+        records.attach(region, bytes, SIZE_MAX);
+        return region != nullptr;
+    }
+
+    bool enabled() const
+    {
+        return records.capacity() > 0;
+    }
+
+    /// @brief Whether the queue should be written to the SD card now
+    bool flushDue(unsigned long now, unsigned long interval_ms) const
+    {
+        return interval_ms > 0 && !records.empty() && now - queuedSince >= interval_ms;
+    }
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef PAYLOAD_TEMPLATE_H
+#define PAYLOAD_TEMPLATE_H
+
+#include <Arduino.h>
+#include "../global_configs.h"
+#include "sensor_registry.h"
+#include "number_format.h"
+#include "json_writer.h"
+
+/**
+ * @brief Push payloads rendered from templates assembled at compile time
+ * @details Everything in a sensors.AFRICA push payload but the timestamp and the values is fixed per sensor:
+ *
+ *              {"software_version":"…","timestamp":"<ts>","sensordatavalues":[{"value_type":"P0","value":<v>},…],
+ *               "sensor_type":"PMS","API_PIN":1}
+ *
+ *          makePayloadTemplate() builds that text from SENSOR_REGISTRY in a constant expression, recording the offsets
+ *          where the timestamp and each value go. renderPayload() copies the fragments and splices those in. Values are
+ *          written with their registry decimals by formatFixed(), the digits the CSV log shows for the same reading.
+ */
+
+#define PAYLOAD_TEMPLATE_SIZE 192 // fixed text of one sensor's payload, checked below
+
+struct PayloadTemplate
+{
+    char text[PAYLOAD_TEMPLATE_SIZE] = {};
+    uint16_t length = 0;
+    uint16_t splice[SENSOR_MAX_VALUES + 1] = {}; // text offsets of the timestamp [0] and the values [1..]
+    uint8_t value_count = 0;
+    uint8_t decimals[SENSOR_MAX_VALUES] = {};
+    bool overflow = false;
+
+    constexpr void append(char c)
+    {
+        if (length + 1 >= PAYLOAD_TEMPLATE_SIZE)
+        {
+            overflow = true;
+            return;
+        }
+        text[length++] = c;
+    }
+
+    constexpr void append(const char *s)
+    {
+        for (; *s; s++)
+            append(*s);
+    }
+
+    /// @brief Contents of a JSON string, quotes and backslashes escaped
+    constexpr void appendEscaped(const char *s)
+    {
+        for (; *s; s++)
+        {
+            if (*s == '"' || *s == '\\')
+                append('\\');
+            append(*s);
+        }
+    }
+
+    constexpr void appendUInt(uint32_t v)
+    {
+        if (v >= 10)
+            appendUInt(v / 10);
+        append('0' + v % 10);
+    }
+};
+
+static constexpr PayloadTemplate makePayloadTemplate(const SensorDescriptor &sensor)
+{
+    PayloadTemplate t;
+    t.append("{\"software_version\":\"");
+    t.appendEscaped(SOFTWARE_VERSION);
+    t.append("\",\"timestamp\":\"");
+    t.splice[0] = t.length;
+    t.append("\",\"sensordatavalues\":[");
+    for (uint8_t i = 0; i < sensor.value_count; i++)
+    {
+        t.append(i == 0 ? "{\"value_type\":\"" : ",{\"value_type\":\"");
+        t.appendEscaped(sensor.values[i].api_key);
+        t.append("\",\"value\":");
+        t.splice[i + 1] = t.length;
+        t.decimals[i] = sensor.values[i].decimals;
+        t.append('}');
+    }
+    t.append("],\"sensor_type\":\"");
+    t.appendEscaped(sensor.sensor_type);
+    t.append("\",\"API_PIN\":");
+    t.appendUInt(sensor.api_pin);
+    t.append('}');
+    t.value_count = sensor.value_count;
+    return t;
+}
+
+struct PayloadTemplates
+{
+    PayloadTemplate of[SENSOR_COUNT];
+};
+
+static constexpr PayloadTemplates makePayloadTemplates()
+{
+    PayloadTemplates all;
+    for (uint8_t id = 0; id < SENSOR_COUNT; id++)
+        all.of[id] = makePayloadTemplate(SENSOR_REGISTRY[id]);
+    return all;
+}
+
+static constexpr PayloadTemplates PAYLOAD_TEMPLATES = makePayloadTemplates();
+
+static constexpr bool payloadTemplatesFit(uint8_t id = 0)
+{
+    return id == SENSOR_COUNT || (!PAYLOAD_TEMPLATES.of[id].overflow && payloadTemplatesFit(id + 1));
+}
+
+static_assert(payloadTemplatesFit(), "PAYLOAD_TEMPLATE_SIZE too small for a sensor's payload");
+
+static inline size_t payloadOverflow(char *buf)
+{
+    buf[0] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Render the push payload of one sensor
+ * @param sensor : SensorId
+ * @param timestamp : ISO 8601 text, copied as is
+ * @param values : sensor values, in SENSOR_REGISTRY order
+ * @return length written excluding the terminator; 0 (empty string) if the payload does not fit
+ */
+static size_t renderPayload(char *buf, size_t size, uint8_t sensor, const char *timestamp, const float *values)
+{
+    if (size == 0)
+        return 0;
+    buf[0] = '\0';
+    if (sensor >= SENSOR_COUNT)
+        return 0;
+
+    const PayloadTemplate &t = PAYLOAD_TEMPLATES.of[sensor];
+    size_t len = 0, from = 0;
+    for (uint8_t i = 0; i <= t.value_count; i++)
+    {
+        size_t fixed = t.splice[i] - from;
+        if (len + fixed >= size)
+            return payloadOverflow(buf);
+        memcpy(buf + len, t.text + from, fixed);
+        len += fixed;
+        from = t.splice[i];
+
+        size_t n;
+        if (i == 0)
+        {
+            n = strlen(timestamp);
+            if (len + n >= size)
+                return payloadOverflow(buf);
+            memcpy(buf + len, timestamp, n);
+        }
+        else
+        {
+            n = formatJsonFixed(buf + len, size - len, values[i - 1], t.decimals[i - 1]);
+            if (n == 0)
+                return payloadOverflow(buf);
+        }
+        len += n;
+    }
+
+    size_t tail = t.length - from;
+    if (len + tail >= size)
+        return payloadOverflow(buf);
+    memcpy(buf + len, t.text + from, tail);
+    len += tail;
+    buf[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief API_PIN of a payload line read back from a retry store, without parsing the JSON
+ * @details Payloads rendered here (and aggregate payloads) carry "API_PIN":<n> once, outside any string. A line is
+ *          only taken as a payload if it is a complete object, so a line torn by a reset is not sent.
+ * @return the pin, -1 if the line is not a complete payload or has no API_PIN
+ */
+static int32_t payloadApiPin(const char *payload, size_t length)
+{
+    static const char key[] = "\"API_PIN\":";
+    if (length < 2 || payload[0] != '{' || payload[length - 1] != '}')
+        return -1;
+    const char *found = strstr(payload, key);
+    if (found == nullptr)
+        return -1;
+    const char *digit = found + sizeof(key) - 1;
+    int32_t pin = 0;
+    if (*digit < '0' || *digit > '9')
+        return -1;
+    for (; *digit >= '0' && *digit <= '9'; digit++)
+        pin = pin * 10 + (*digit - '0');
+    return pin;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef PMS_BURST_H
+#define PMS_BURST_H
+
+#include <Arduino.h>
+
+/// @brief Summary of a burst of PMS frames for one channel
+struct PMBurstStats
+{
+    uint16_t median;
+    uint16_t min;
+    uint16_t max;
+    float mean;
+};
+
+/// @brief Statistics of every channel of a burst, kept after the accumulator is reused for the next one
+struct PMBurstSummary
+{
+    static const uint8_t CHANNELS = 9; // same layout as SerialPM::data
+    uint8_t count = 0;                 // frames in the burst
+    PMBurstStats channels[CHANNELS] = {};
+};
+
+/**
+ * @brief Fixed-size accumulator for a burst of PMS frames
+ * @details Stores up to CAPACITY frames of the 9 SerialPM data channels (pm01, pm25, pm10, nc[6]) in place;
+ *          no heap is used. Statistics are computed on demand from a stack copy of one channel.
+ * @tparam CAPACITY : maximum number of frames per burst
+ */
+template <uint8_t CAPACITY>
+struct PMBurstAccumulator
+{
+    static const uint8_t CHANNELS = PMBurstSummary::CHANNELS;
+    uint16_t samples[CHANNELS][CAPACITY] = {};
+    uint8_t count = 0;
+
+    void reset()
+    {
+        count = 0;
+    }
+
+    bool full() const
+    {
+        return count >= CAPACITY;
+    }
+
+    /// @brief Add one frame
+    /// @param data : channel values in SerialPM::data order
+    /// @return false if the burst is already full
+    bool add(const uint16_t data[CHANNELS])
+    {
+        if (full())
+            return false;
+        for (uint8_t ch = 0; ch < CHANNELS; ch++)
+        {
+            samples[ch][count] = data[ch];
+        }
+        count++;
+        return true;
+    }
+
+    /// @brief Median, min, max and mean of one channel
+    /// @param channel : index in SerialPM::data order (0 = pm01, 1 = pm25, 2 = pm10, 3.. = nc bins)
+    PMBurstStats stats(uint8_t channel) const
+    {
+        PMBurstStats result = {0, 0, 0, 0.0f};
+        if (count == 0 || channel >= CHANNELS)
+            return result;
+
+        // insertion sort of a copy; bursts are a handful of frames
+        uint16_t sorted[CAPACITY];
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint16_t v = samples[channel][i];
+            sum += v;
+            uint8_t j = i;
+            while (j > 0 && sorted[j - 1] > v)
+            {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+
+        result.min = sorted[0];
+        result.max = sorted[count - 1];
+        result.mean = (float)sum / count;
+        if (count & 1)
+            result.median = sorted[count / 2];
+        else
+            result.median = (uint16_t)(((uint32_t)sorted[count / 2 - 1] + sorted[count / 2] + 1) / 2);
+        return result;
+    }
+
+    PMBurstSummary summary() const
+    {
+        PMBurstSummary result;
+        result.count = count;
+        for (uint8_t ch = 0; ch < CHANNELS; ch++)
+            result.channels[ch] = stats(ch);
+        return result;
+    }
+
+    /// @brief Medians of all channels, in SerialPM::data order
+    void medians(uint16_t out[CHANNELS]) const
+    {
+        for (uint8_t ch = 0; ch < CHANNELS; ch++)
+        {
+            out[ch] = stats(ch).median;
+        }
+    }
+};
+
+#endif
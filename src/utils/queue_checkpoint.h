@@ -0,0 +1,111 @@
+#ifndef QUEUE_CHECKPOINT_H
+#define QUEUE_CHECKPOINT_H
+
+#include <Arduino.h>
+#include "gzip.h"
+#include "log_arena.h"
+#include "sample_record.h"
+
+#if !defined(RTC_NOINIT_ATTR)
+#define RTC_NOINIT_ATTR // host builds: ordinary memory
+#endif
+
+#define QUEUE_CHECKPOINT_MAGIC 0x31504351 // "QCP1"
+
+/**
+ * @brief Copy of the records in a memory logger that survives a restart
+ * @details Kept in RTC slow memory (RTC_NOINIT_ATTR), which a software restart, a watchdog reset or a panic leave
+ *          alone, and written as it is to a LittleFS file for power loss. The image is plain data without constructors,
+ *          so the startup code does not clear it; whether it holds a checkpoint is decided by the magic, the record
+ *          size (a firmware with another SampleRecord layout ignores it) and a CRC-32 over the header and the records
+ *          in use. Only the bytes up to the last record are written to the file, see bytes().
+ */
+template <size_t MaxRecords>
+struct QueueImage
+{
+    uint32_t crc;
+    uint32_t magic;
+    uint16_t recordSize;
+    uint16_t count;
+    uint8_t records[MaxRecords * sizeof(SampleRecord)];
+
+    /**
+     * @brief Take the records of ring, which must all be SampleRecords
+     * @return false if one is not or there are more than MaxRecords; the image is left empty then
+     */
+    bool capture(const LogRing &ring)
+    {
+        magic = QUEUE_CHECKPOINT_MAGIC;
+        recordSize = sizeof(SampleRecord);
+        count = 0;
+        bool complete = ring.size() <= MaxRecords;
+        for (LogRecord record : ring)
+        {
+            if (!complete || record.length != sizeof(SampleRecord))
+            {
+                complete = false;
+                break;
+            }
+            memcpy(records + count * sizeof(SampleRecord), record.data, sizeof(SampleRecord));
+            count++;
+        }
+        if (!complete)
+            count = 0;
+        crc = checksum();
+        return complete;
+    }
+
+    bool valid() const
+    {
+        return magic == QUEUE_CHECKPOINT_MAGIC && recordSize == sizeof(SampleRecord) && count <= MaxRecords &&
+               crc == checksum();
+    }
+
+    /// @brief Length of the image up to its last record
+    size_t bytes() const
+    {
+        return offsetof(QueueImage, records) + (size_t)count * sizeof(SampleRecord);
+    }
+
+    /**
+     * @brief Push the records back into ring, oldest first
+     * @return records pushed; the image must be valid()
+     */
+    uint16_t restore(LogRing &ring) const
+    {
+        uint16_t pushed = 0;
+        while (pushed < count && ring.push((const char *)records + pushed * sizeof(SampleRecord), sizeof(SampleRecord)))
+            pushed++;
+        return pushed;
+    }
+
+    void invalidate()
+    {
+        magic = 0;
+    }
+
+private:
+    uint32_t checksum() const
+    {
+        // everything after the crc field, up to the last record
+        const uint8_t *start = (const uint8_t *)&magic;
+        size_t length = offsetof(QueueImage, records) - offsetof(QueueImage, magic);
+        if (count <= MaxRecords)
+            length += (size_t)count * sizeof(SampleRecord);
+        return GzipEncoder::crc32(start, length);
+    }
+};
+
+/// @brief What the checkpoint did this boot, reported in the boot telemetry
+struct QueueCheckpointState
+{
+    const char *restoredFrom = "none"; // "rtc", "flash" or "none"
+    uint16_t restored = 0;             // records put back into the memory logger
+    uint32_t restoreUs = 0;            // time taken to find and restore the checkpoint
+    uint32_t saved = 0;                // RTC checkpoints
+    uint32_t flashSaved = 0;           // LittleFS checkpoints
+    bool flashStale = false;           // the LittleFS copy is older than the RTC one
+    unsigned long flashSavedAt = 0;    // millis() of the last LittleFS checkpoint
+};
+
+#endif
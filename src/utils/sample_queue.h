@@ -0,0 +1,36 @@
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "spsc_queue.h"
+#include "sensor_sample.h"
+#include "pms_burst.h"
+
+/// @brief What the sampling task does with a finished cycle while loop() has not taken SAMPLE_QUEUE_DEPTH older ones
+enum SampleQueuePolicy : uint8_t
+{
+    SAMPLE_QUEUE_BLOCK,       // wait for a free place; the next cycle starts late
+    SAMPLE_QUEUE_DROP_OLDEST, // give up the oldest queued cycle
+    SAMPLE_QUEUE_SPILL        // write the cycle to SAMPLE_SPILL_PATH for loop() to take later; drop-oldest without SD
+};
+
+/// @brief A finished acquisition cycle on its way from the sampling task to loop()
+struct QueuedSample
+{
+    SensorSample sample;
+    PMBurstSummary burst; // for current_sensor_data; count 0 if not known
+};
+
+/// @brief Backpressure counters of the sample queue
+/// @note blocked, dropped and spilled are written by the sampling task, ingested by loop()
+struct SampleQueueState
+{
+    uint32_t blocked = 0;                  // cycles that waited for a free place
+    uint32_t dropped = 0;                  // cycles given up
+    uint32_t spilled = 0;                  // cycles written to SAMPLE_SPILL_PATH
+    uint32_t ingested = 0;                 // spilled cycles loop() has logged
+    std::atomic<bool> spillPending{false}; // SAMPLE_SPILL_PATH holds cycles loop() has not logged yet
+};
+
+#endif
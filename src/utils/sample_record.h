@@ -0,0 +1,99 @@
+#ifndef SAMPLE_RECORD_H
+#define SAMPLE_RECORD_H
+
+#include <Arduino.h>
+#include "cbor.h"
+#include "datetime.h"
+#include "sensor_registry.h"
+
+/**
+ * @brief Compact binary sample record (CBOR) for the SD backlog and the optional application/cbor uplink
+ * @details One record holds what one JSON push payload holds, in about a tenth of the bytes. Schema version 1 is a
+ *          CBOR array:
+ *
+ *              [1, api_pin, epoch, tz_offset_min | null, [value, ...]]
+ *
+ *          api_pin identifies the sensor (X-Pin of the API, see SENSOR_REGISTRY), epoch is UTC seconds, values follow
+ *          the sensor's SENSOR_REGISTRY value order as integers (values without decimals) or single-precision floats.
+ *          A file of records is a plain CBOR sequence (RFC 8742), records back to back.
+ *          scripts/sample_records.py turns records back into the JSON payloads. Changing the layout or the value
+ *          order of a sensor requires a new SAMPLE_RECORD_VERSION and a matching decoder.
+ */
+
+#define SAMPLE_RECORD_VERSION 1
+#define SAMPLE_RECORD_MAX_SIZE 64 // largest encoded record, incl. a sensor with SENSOR_MAX_VALUES float values
+
+struct SampleRecord
+{
+    Timestamp time;
+    float values[SENSOR_MAX_VALUES] = {};
+    uint8_t sensor = SENSOR_COUNT; // SensorId; last, so it takes the padding after the values
+};
+
+static_assert(1 + 1 + 2 + 9 + 3 + 1 + SENSOR_MAX_VALUES * 5 <= SAMPLE_RECORD_MAX_SIZE, "SAMPLE_RECORD_MAX_SIZE too small");
+
+/// @return SensorId of the sensor with this X-Pin, SENSOR_COUNT if there is none
+static uint8_t sensorByApiPin(int32_t api_pin)
+{
+    uint8_t id = 0;
+    while (id < SENSOR_COUNT && SENSOR_REGISTRY[id].api_pin != api_pin)
+        id++;
+    return id;
+}
+
+/// @return length of the encoded record, 0 if it does not fit or the sensor is unknown
+static size_t encodeSampleRecord(uint8_t *buf, size_t size, const SampleRecord &record)
+{
+    if (record.sensor >= SENSOR_COUNT)
+        return 0;
+    const SensorDescriptor &sensor = SENSOR_REGISTRY[record.sensor];
+
+    CborWriter cbor(buf, size);
+    cbor.array(5);
+    cbor.uint(SAMPLE_RECORD_VERSION);
+    cbor.uint(sensor.api_pin);
+    cbor.integer(record.time.epoch);
+    if (record.time.tzOffsetMin == TZ_OFFSET_UNKNOWN)
+        cbor.null();
+    else
+        cbor.integer(record.time.tzOffsetMin);
+    cbor.array(sensor.value_count);
+    for (uint8_t i = 0; i < sensor.value_count; i++)
+    {
+        if (sensor.values[i].decimals == 0)
+            cbor.integer((int32_t)rintf(record.values[i])); // ties to even, as formatFixed()
+        else
+            cbor.float32(record.values[i]);
+    }
+    return cbor.length();
+}
+
+/**
+ * @brief Decode the record at the start of buf
+ * @return bytes consumed; 0 if the record is incomplete, malformed, of another schema version or of an unknown sensor
+ */
+static size_t decodeSampleRecord(const uint8_t *buf, size_t len, SampleRecord &record)
+{
+    CborReader cbor(buf, len);
+    if (cbor.array() != 5 || cbor.uint() != SAMPLE_RECORD_VERSION)
+        return 0;
+    uint8_t id = sensorByApiPin((int32_t)cbor.uint());
+    int64_t epoch = cbor.integer();
+    int16_t tz = cbor.null() ? TZ_OFFSET_UNKNOWN : (int16_t)cbor.integer();
+    uint8_t count = cbor.array();
+    if (cbor.failed() || id >= SENSOR_COUNT || count != SENSOR_REGISTRY[id].value_count)
+        return 0;
+
+    SampleRecord decoded;
+    decoded.sensor = id;
+    decoded.time.epoch = epoch;
+    decoded.time.tzOffsetMin = tz;
+    for (uint8_t i = 0; i < count; i++)
+        decoded.values[i] = cbor.number();
+    if (cbor.failed())
+        return 0;
+    record = decoded;
+    return cbor.pos;
+}
+
+#endif
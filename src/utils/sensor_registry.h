@@ -0,0 +1,95 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <Arduino.h>
+#include "../global_configs.h"
+#include "number_format.h"
+
+/**
+ * @brief Compile-time sensor registry
+ * @details Every sensor is described once: API pin, payload/CSV names and, per value, the API value_type, CSV
+ *          value column, current_sensor_data key and unit. The JSON/CSV encoders, the memory loggers and
+ *          current_sensor_data are driven from these tables (see logSensorSample() in main.cpp).
+ *          Adding a sensor: a SensorId, a value index enum, a value table and a SENSOR_REGISTRY entry.
+ */
+
+/// @brief Index of a sensor in SENSOR_REGISTRY
+enum SensorId : uint8_t
+{
+    SENSOR_PMS,
+    SENSOR_DHT,
+    SENSOR_COUNT
+};
+
+/// @brief Value order of the PMS (order of the API payload)
+enum PMSValueIndex : uint8_t
+{
+    PMS_PM1,
+    PMS_PM10,
+    PMS_PM25,
+    PMS_VALUE_COUNT
+};
+
+/// @brief Value order of the DHT (order of the API payload)
+enum DHTValueIndex : uint8_t
+{
+    DHT_TEMPERATURE,
+    DHT_HUMIDITY,
+    DHT_VALUE_COUNT
+};
+
+struct SensorValueDescriptor
+{
+    const char *api_key;     // value_type in the API JSON payload
+    const char *csv_key;     // value column of the CSV log
+    const char *current_key; // key in current_sensor_data
+    const char *unit;        // unit column of the CSV log
+    uint8_t decimals;        // digits after the decimal point in every encoding, 0 = integer
+};
+
+struct SensorDescriptor
+{
+    uint8_t api_pin;           // X-Pin of the API
+    const char *sensor_type;   // sensor_type of the API JSON payload
+    const char *csv_sensor;    // sensor column of the CSV log
+    const char *current_group; // object in current_sensor_data
+    const SensorValueDescriptor *values;
+    uint8_t value_count;
+};
+
+static constexpr SensorValueDescriptor PMS_VALUES[PMS_VALUE_COUNT] = {
+    {"P0", "PM0", "PM1", "ug/m3", 0},
+    {"P1", "PM10", "PM10", "ug/m3", 0},
+    {"P2", "PM2.5", "PM2.5", "ug/m3", 0},
+};
+
+static constexpr SensorValueDescriptor DHT_VALUES[DHT_VALUE_COUNT] = {
+    {"temperature", "temperature", "temperature", "°C", 1}, // DHT22 resolution 0.1
+    {"humidity", "humidity", "humidity", "%", 1},
+};
+
+static constexpr SensorDescriptor SENSOR_REGISTRY[SENSOR_COUNT] = {
+    {PMS_API_PIN, "PMS", "PMS", "PM", PMS_VALUES, PMS_VALUE_COUNT},
+    {DHT_API_PIN, "DHT", "DHT22", "DHT", DHT_VALUES, DHT_VALUE_COUNT},
+};
+
+static constexpr uint8_t sensorMaxValues(uint8_t i = 0, uint8_t max = 0)
+{
+    return i == SENSOR_COUNT ? max : sensorMaxValues(i + 1, SENSOR_REGISTRY[i].value_count > max ? SENSOR_REGISTRY[i].value_count : max);
+}
+
+/// @brief Values per reading, sized for the sensor with the most values
+static constexpr uint8_t SENSOR_MAX_VALUES = sensorMaxValues();
+
+static constexpr bool sensorDecimalsValid(uint8_t i = 0, uint8_t v = 0)
+{
+    return i == SENSOR_COUNT                      ? true
+           : v == SENSOR_REGISTRY[i].value_count ? sensorDecimalsValid(i + 1, 0)
+                                                 : SENSOR_REGISTRY[i].values[v].decimals <= FIXED_MAX_DECIMALS && sensorDecimalsValid(i, v + 1);
+}
+
+static_assert(sensorDecimalsValid(), "decimals of a sensor value exceed FIXED_MAX_DECIMALS");
+static_assert(SENSOR_REGISTRY[SENSOR_PMS].api_pin == PMS_API_PIN, "SENSOR_REGISTRY order must follow SensorId");
+static_assert(SENSOR_REGISTRY[SENSOR_DHT].api_pin == DHT_API_PIN, "SENSOR_REGISTRY order must follow SensorId");
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SENSOR_RETRY_H
+#define SENSOR_RETRY_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Bounded retry of a sensor read within one acquisition cycle
+ * @details reset() at the start of a cycle, attempt() before every read. Time is passed in by the caller.
+ */
+struct RetryPolicy
+{
+    uint8_t maxAttempts;      // reads per cycle, including the first
+    unsigned long intervalMs; // minimum time between two reads
+    uint8_t attempts = 0;
+    unsigned long lastAttemptAt = 0;
+
+    RetryPolicy(uint8_t max_attempts, unsigned long interval_ms) : maxAttempts(max_attempts), intervalMs(interval_ms) {}
+
+    void reset()
+    {
+        attempts = 0;
+    }
+
+    bool exhausted() const
+    {
+        return attempts >= maxAttempts;
+    }
+
+    /// @return true if another read may be made now
+    bool due(unsigned long now) const
+    {
+        return !exhausted() && (attempts == 0 || now - lastAttemptAt >= intervalMs);
+    }
+
+    void attempt(unsigned long now)
+    {
+        attempts++;
+        lastAttemptAt = now;
+    }
+};
+
+/**
+ * @brief Read outcome counters of one sensor, indexed by status code
+ * @tparam CODES : number of status codes, code 0 being success
+ */
+template <uint8_t CODES>
+struct SensorErrorCounters
+{
+    uint32_t counts[CODES] = {};
+    uint32_t reads = 0;
+    uint32_t retries = 0;       // reads that were a retry within the cycle
+    uint32_t recovered = 0;     // cycles saved by a retry
+    uint32_t lostSamples = 0;   // cycles where every attempt failed
+
+    /// @param code : status code, out of range codes are counted as the last code
+    void record(uint8_t code)
+    {
+        reads++;
+        counts[code < CODES ? code : CODES - 1]++;
+    }
+
+    uint32_t errors() const
+    {
+        return reads - counts[0];
+    }
+};
+
+#endif
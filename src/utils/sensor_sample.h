@@ -0,0 +1,76 @@
+#ifndef SENSOR_SAMPLE_H
+#define SENSOR_SAMPLE_H
+
+#include <Arduino.h>
+#include "sensor_registry.h"
+#include "datetime.h"
+
+/// @brief Values of one sensor, in the order of its SENSOR_REGISTRY value table
+struct SensorReading
+{
+    bool valid = false;
+    float values[SENSOR_MAX_VALUES] = {};
+};
+
+/**
+ * @brief One acquisition cycle's readings under a single capture timestamp
+ * @details Filled by acquisitionManager() (see main.cpp): the DHT is read during the PMS warm-up and the PMS burst
+ *          once the fan has settled; the timestamp is taken once, when the PMS reading starts, and shared by both
+ *          sensors' payloads so the PM and temperature/humidity series line up. It stays binary until the sample is
+ *          serialized.
+ */
+struct SensorSample
+{
+    Timestamp time;               // RTC capture time; not set if the RTC was not set
+    unsigned long capturedAt = 0; // millis() at capture
+    SensorReading readings[SENSOR_COUNT];
+
+    void reset()
+    {
+        *this = SensorSample();
+    }
+
+    /// @brief Stamp the sample
+    /// @param t : RTC capture time
+    /// @param now : current millis()
+    void stamp(const Timestamp &t, unsigned long now)
+    {
+        time = t;
+        capturedAt = now;
+    }
+
+    bool isStamped() const
+    {
+        return time.isSet();
+    }
+
+    /// @brief Set one value and mark the sensor's reading valid
+    /// @param index : value index of the sensor (e.g. PMS_PM25, DHT_TEMPERATURE)
+    void set(SensorId sensor, uint8_t index, float value)
+    {
+        readings[sensor].values[index] = value;
+        readings[sensor].valid = true;
+    }
+
+    bool has(SensorId sensor) const
+    {
+        return readings[sensor].valid;
+    }
+
+    float value(SensorId sensor, uint8_t index) const
+    {
+        return readings[sensor].values[index];
+    }
+
+    bool empty() const
+    {
+        for (const SensorReading &reading : readings)
+        {
+            if (reading.valid)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
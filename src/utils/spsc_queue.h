@@ -0,0 +1,114 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief Bounded lock-free queue from one producer task to one consumer task
+ * @details Every slot carries a sequence number, as in D. Vyukov's bounded queue: a slot is written only while its
+ *          sequence says it is free and read only while it says it holds an entry, so a push and a pop never touch the
+ *          same slot at the same time and neither side takes a lock or disables interrupts.
+ *          The producer may also give up the oldest entry with dropOldest() (drop-oldest backpressure). It claims the
+ *          entry with the same compare-and-swap on the read position as pop(), so the consumer and a dropping producer
+ *          never take the same entry; everything else is single-writer.
+ *          push() and dropOldest() are for the producer only, pop() for the consumer only.
+ * @tparam Capacity : a power of two, so the positions may wrap around
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue()
+    {
+        for (size_t i = 0; i < Capacity; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    /// @return false if the queue is full or the consumer is still reading the slot this entry goes to
+    bool push(const T &item)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Slot &slot = slots[pos % Capacity];
+        if (slot.sequence.load(std::memory_order_acquire) != pos)
+            return false;
+        slot.item = item;
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        tail.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @return false if the queue is empty
+    bool pop(T &item)
+    {
+        return take(&item);
+    }
+
+    /// @brief Discard the oldest entry
+    /// @return false if the queue is empty
+    bool dropOldest()
+    {
+        return take(nullptr);
+    }
+
+    /// @brief Entries pushed and not yet taken; an entry being read by pop() no longer counts
+    /// @note Exact in the producer; elsewhere a snapshot that may already be out of date
+    size_t size() const
+    {
+        size_t taken = head.load(std::memory_order_acquire); // first: the tail is never behind it
+        return tail.load(std::memory_order_acquire) - taken;
+    }
+
+    bool full() const
+    {
+        return size() >= Capacity;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence; // position + 1 while it holds that entry, position + Capacity once read
+        T item;
+    };
+
+    Slot slots[Capacity];
+    std::atomic<size_t> head{0}; // next entry to take
+    std::atomic<size_t> tail{0}; // next entry to push, written by the producer only
+
+    bool take(T *item)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots[pos % Capacity];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t ahead = (intptr_t)(sequence - (pos + 1));
+            if (ahead < 0)
+                return false; // empty
+            if (ahead > 0)
+            {
+                pos = head.load(std::memory_order_relaxed); // taken by the other side
+                continue;
+            }
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                if (item)
+                    *item = slot.item;
+                slot.sequence.store(pos + Capacity, std::memory_order_release);
+                return true;
+            }
+        }
+    }
+};
+
+#endif
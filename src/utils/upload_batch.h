@@ -0,0 +1,110 @@
+#ifndef UPLOAD_BATCH_H
+#define UPLOAD_BATCH_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Batch upload envelope: several JSON push payloads in one request body
+ * @details The body is a JSON array of the payloads, "[{…},{…}]"; each payload keeps its API_PIN, the request carries
+ *          X-PIN: 0. Payloads are copied into the caller's buffer as they are added, and their offsets kept, so a
+ *          batch the endpoint rejects can be re-sent record by record from the same buffer (see sendBatch() in
+ *          main.cpp). A payload can come with the record it was rendered from, kept as a pointer for the retry store.
+ */
+
+#define UPLOAD_BATCH_MAX_RECORDS 32 // upper bound of batchMaxRecords
+
+struct UploadBatch
+{
+    char *buf;
+    size_t limit;        // body length limit, brackets included
+    uint8_t maxRecords;
+    size_t len = 1;      // buf[0] is '['
+    uint8_t count = 0;
+    uint16_t offset[UPLOAD_BATCH_MAX_RECORDS] = {};
+    uint16_t size[UPLOAD_BATCH_MAX_RECORDS] = {};
+    uint8_t pin[UPLOAD_BATCH_MAX_RECORDS] = {};
+    const char *source[UPLOAD_BATCH_MAX_RECORDS] = {}; // caller's record behind each payload, nullptr if none
+
+    /// @param buffer_size : at least 3; the body (and its terminator) never exceeds it
+    /// @param max_records : records per body, at most UPLOAD_BATCH_MAX_RECORDS
+    /// @param max_bytes : body length limit, capped by the buffer
+    UploadBatch(char *buffer, size_t buffer_size, uint8_t max_records, size_t max_bytes) : buf(buffer)
+    {
+        limit = max_bytes < buffer_size - 1 ? max_bytes : buffer_size - 1;
+        if (limit > 0xffff)
+            limit = 0xffff;
+        maxRecords = max_records == 0 ? 1 : max_records > UPLOAD_BATCH_MAX_RECORDS ? UPLOAD_BATCH_MAX_RECORDS : max_records;
+        buf[0] = '[';
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    /**
+     * @brief Append a payload
+     * @return false if the batch is full or the payload would take it past the byte limit; nothing is added then
+     *         (a payload that does not fit even an empty batch has to be sent on its own)
+     */
+    bool add(const char *payload, size_t n, uint8_t api_pin, const char *record_source = nullptr)
+    {
+        size_t separator = count > 0 ? 1 : 0;
+        if (count >= maxRecords || len + separator + n + 1 > limit) // + 1 for the closing bracket
+            return false;
+        if (separator)
+            buf[len++] = ',';
+        memcpy(buf + len, payload, n);
+        offset[count] = len;
+        size[count] = n;
+        pin[count] = api_pin;
+        source[count] = record_source;
+        len += n;
+        count++;
+        return true;
+    }
+
+    /// @brief Close the array and terminate the body
+    /// @return body length
+    size_t finish()
+    {
+        buf[len] = ']';
+        buf[len + 1] = '\0';
+        return len + 1;
+    }
+
+    const char *body() const
+    {
+        return buf;
+    }
+
+    /// @brief Payload i as added, not terminated; see recordLength()
+    const char *record(uint8_t i) const
+    {
+        return buf + offset[i];
+    }
+
+    size_t recordLength(uint8_t i) const
+    {
+        return size[i];
+    }
+
+    uint8_t recordPin(uint8_t i) const
+    {
+        return pin[i];
+    }
+
+    /// @brief What payload i was rendered from, as passed to add()
+    const char *recordSource(uint8_t i) const
+    {
+        return source[i];
+    }
+
+    void clear()
+    {
+        len = 1;
+        count = 0;
+    }
+};
+
+#endif
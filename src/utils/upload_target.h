@@ -0,0 +1,35 @@
+#ifndef UPLOAD_TARGET_H
+#define UPLOAD_TARGET_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+/**
+ * @brief Uplink destination: endpoint URL, retry stores on the SD card and the state kept between requests to it
+ * @details Normally only the target selected by isLive is sent to. With fanOut set every payload is encoded once and
+ *          sent to both the production and the staging endpoint; each target keeps its own retry stores (production in
+ *          SENSORSDATA/, staging in SENSORSDATA/TESTING/), counters, batch support flag and WiFi connection, so one
+ *          endpoint being down or rejecting batches does not hold back the other.
+ */
+
+enum UploadTargetId
+{
+    UPLOAD_STAGING,
+    UPLOAD_PRODUCTION,
+    UPLOAD_TARGET_COUNT
+};
+
+struct UploadTarget
+{
+    const char *name;
+    const char *url;                     // DeviceConfig.staging_url / production_url
+    char failed_payloads_path[128] = {}; // failed_send_payloads.txt of this endpoint
+    char failed_records_path[128] = {};  // failed_send_records.cbor of this endpoint
+    bool batch_rejected = false;         // the endpoint answered a batch with a rejection, see sendBatch()
+    uint32_t sent = 0;                   // records the endpoint accepted
+    uint32_t stored = 0;                 // records put (back) into a retry store
+    WiFiClient client;                   // kept open between requests, see sendDataViaWiFi()
+    char client_host[128] = {};          // host the client is connected to
+};
+
+#endif
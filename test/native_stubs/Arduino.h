@@ -0,0 +1,90 @@
+/*
+ Host stand-in for the Arduino core, for the [env:native] unit tests.
+ Only what the headers and libraries under test use. Time does not pass on its
+ own: the tests move hostClockUs forward (delay() does too).
+*/
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+typedef uint8_t byte;
+
+#define F(x) x
+#define PROGMEM
+#define IRAM_ATTR
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+// clock
+inline unsigned long hostClockUs = 0;
+
+inline unsigned long millis() { return hostClockUs / 1000; }
+inline unsigned long micros() { return hostClockUs; }
+inline void delay(unsigned long ms) { hostClockUs += ms * 1000; }
+inline void delayMicroseconds(unsigned int us) { hostClockUs += us; }
+inline void yield() {}
+
+// pins: reads return hostPinLevel, everything else is ignored
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 3
+#define digitalPinToInterrupt(p) (p)
+
+inline int hostPinLevel = HIGH;
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return hostPinLevel; }
+inline void attachInterruptArg(uint8_t, void (*)(void *), void *, int) {}
+inline void detachInterrupt(uint8_t) {}
+inline void interrupts() {}
+inline void noInterrupts() {}
+
+// serial ports: output is discarded, tests derive from HardwareSerial to script the input
+struct Print
+{
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) { return 1; }
+    virtual size_t write(const uint8_t *, size_t size) { return size; }
+    template <typename T>
+    size_t print(const T &) { return 0; }
+    template <typename T>
+    size_t print(const T &, int) { return 0; }
+    template <typename T>
+    size_t println(const T &) { return 0; }
+    template <typename T>
+    size_t println(const T &, int) { return 0; }
+    size_t println() { return 0; }
+    size_t printf(const char *, ...) { return 0; }
+};
+
+struct Stream : Print
+{
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    virtual void flush() {}
+};
+
+#define SERIAL_8N1 0
+
+struct HardwareSerial : Stream
+{
+    void begin(unsigned long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {}
+    void end() {}
+};
+
+inline HardwareSerial Serial, Serial1;
+
+#endif
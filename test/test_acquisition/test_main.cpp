@@ -0,0 +1,270 @@
+/*
+ AcquisitionState driven the way acquisitionManager() drives it: a passive PMS
+ read every PMS_STABILITY_READ_INTERVAL_MS through SerialPM, on a simulated
+ clock, with a scripted sensor answering on a mock serial port.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include "PMserial.h"
+#include "utils/acquisition.h"
+
+// PMS5003 on a serial port: answers a passive read command with a 32 byte frame after responseMs
+struct MockPMS : HardwareSerial
+{
+    uint16_t pm[3] = {}; // PM1.0, PM2.5, PM10 of the next frame
+    bool silent = false;
+    unsigned long responseMs = 200;
+    uint8_t reply[32];
+    uint8_t replyLen = 0, replyPos = 0;
+    unsigned long replyAt = 0;
+    uint32_t triggers = 0;
+
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        if (size == 7 && data[0] == 0x42 && data[1] == 0x4D && data[2] == 0xE2)
+        {
+            triggers++;
+            if (!silent)
+                prepareFrame();
+        }
+        return size;
+    }
+
+    int available() override
+    {
+        return millis() >= replyAt ? replyLen - replyPos : 0;
+    }
+
+    int read() override
+    {
+        return available() ? reply[replyPos++] : -1;
+    }
+
+    void prepareFrame()
+    {
+        memset(reply, 0, sizeof(reply));
+        reply[0] = 0x42;
+        reply[1] = 0x4D;
+        reply[3] = 28;
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            // TSI and atmospheric values alike: PM1.0, PM2.5, PM10
+            reply[4 + 2 * i] = reply[10 + 2 * i] = pm[i] >> 8;
+            reply[5 + 2 * i] = reply[11 + 2 * i] = pm[i] & 0xFF;
+        }
+        uint16_t sum = 0;
+        for (uint8_t i = 0; i < 30; i++)
+            sum += reply[i];
+        reply[30] = sum >> 8;
+        reply[31] = sum & 0xFF;
+        replyLen = sizeof(reply);
+        replyPos = 0;
+        replyAt = millis() + responseMs;
+    }
+};
+
+static MockPMS port;
+static SerialPM pms(PMS5003, port);
+static AcquisitionState acq;
+static unsigned long lastRequest;
+static uint32_t framesSeen;
+
+void setUp(void)
+{
+    hostClockUs = 1000000000UL; // 1000 s after boot
+    port = MockPMS();
+    if (pms.waiting())
+        pms.expire();
+    pms.status = SerialPM::OK;
+    acq = AcquisitionState();
+    lastRequest = 0;
+    framesSeen = 0;
+}
+
+void tearDown(void) {}
+
+static void setPM(uint16_t pm01, uint16_t pm25, uint16_t pm10)
+{
+    port.pm[0] = pm01;
+    port.pm[1] = pm25;
+    port.pm[2] = pm10;
+}
+
+// one SAMPLING_TASK_PERIOD_MS pass of the warm-up part of acquisitionManager()
+static void pass()
+{
+    unsigned long now = millis();
+    if (acq.phase == ACQ_WARMING && acq.elapsed(now) >= acq.settleMs)
+    {
+        if (pms.waiting() && pms.poll())
+        {
+            if (pms)
+            {
+                acq.addWarmupFrame(pms.pm);
+                framesSeen++;
+            }
+        }
+        else if ((!pms.waiting() || pms.waiting_ms() > PMS_READ_TIMEOUT_MS) &&
+                 now - lastRequest >= PMS_STABILITY_READ_INTERVAL_MS)
+        {
+            if (pms.waiting())
+                pms.expire();
+            pms.trigger();
+            lastRequest = now;
+        }
+    }
+    acq.step(now);
+    delay(SAMPLING_TASK_PERIOD_MS);
+}
+
+// run passes until the cycle leaves the phase or limitMs have passed
+static unsigned long runWhile(AcquisitionPhase phase, unsigned long limitMs)
+{
+    unsigned long start = millis();
+    while (acq.phase == phase && millis() - start < limitMs)
+        pass();
+    return millis() - start;
+}
+
+void test_start_only_from_idle()
+{
+    TEST_ASSERT_TRUE(acq.start(millis()));
+    TEST_ASSERT_EQUAL(ACQ_WARMING, acq.phase);
+    TEST_ASSERT_FALSE(acq.start(millis()));
+}
+
+void test_stable_frames_end_warmup_at_minimum()
+{
+    setPM(10, 20, 30);
+    acq.start(millis());
+    unsigned long took = runWhile(ACQ_WARMING, PMS_WARMUP_MAX_MS + 1000);
+
+    TEST_ASSERT_EQUAL(ACQ_READING, acq.phase);
+    TEST_ASSERT_TRUE(acq.lastWarmupConverged);
+    // frames agree long before the minimum, so the minimum decides
+    TEST_ASSERT_GREATER_OR_EQUAL(PMS_WARMUP_MIN_MS, acq.lastWarmupMs);
+    TEST_ASSERT_LESS_THAN(PMS_WARMUP_MIN_MS + 2 * SAMPLING_TASK_PERIOD_MS, took);
+    TEST_ASSERT_EQUAL(PMS_WARMUP_MAX_MS - acq.lastWarmupMs, acq.totalWarmupSavedMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(PMS_STABLE_FRAMES + 1, framesSeen);
+}
+
+void test_settling_frames_delay_the_reading()
+{
+    // PM2.5 falls by 20% a frame for 15 frames, then holds
+    acq.start(millis());
+    unsigned long holdAt = 0;
+    while (acq.phase == ACQ_WARMING && acq.elapsed(millis()) < PMS_WARMUP_MAX_MS + 1000)
+    {
+        uint16_t pm25 = 2000;
+        for (uint32_t i = 0; i < port.triggers && i < 15; i++)
+            pm25 = pm25 * 4 / 5;
+        if (port.triggers == 15 && holdAt == 0)
+            holdAt = acq.elapsed(millis());
+        setPM(pm25 / 2, pm25, pm25 + pm25 / 2);
+        pass();
+    }
+
+    TEST_ASSERT_EQUAL(ACQ_READING, acq.phase);
+    TEST_ASSERT_TRUE(acq.lastWarmupConverged);
+    TEST_ASSERT_GREATER_THAN(PMS_WARMUP_MIN_MS, acq.lastWarmupMs);
+    TEST_ASSERT_LESS_THAN(PMS_WARMUP_MAX_MS, acq.lastWarmupMs);
+    // it took PMS_STABLE_FRAMES agreeing frames after the last change
+    TEST_ASSERT_GREATER_OR_EQUAL(holdAt + (PMS_STABLE_FRAMES - 1) * PMS_STABILITY_READ_INTERVAL_MS, acq.lastWarmupMs);
+}
+
+void test_unstable_frames_read_at_maximum()
+{
+    acq.start(millis());
+    uint32_t k = 0;
+    while (acq.phase == ACQ_WARMING && k < 100000)
+    {
+        // alternates between two levels 50% apart
+        setPM(40, port.triggers % 2 ? 60 : 40, 80);
+        pass();
+        k++;
+    }
+
+    TEST_ASSERT_EQUAL(ACQ_READING, acq.phase);
+    TEST_ASSERT_FALSE(acq.lastWarmupConverged);
+    TEST_ASSERT_GREATER_OR_EQUAL(PMS_WARMUP_MAX_MS, acq.lastWarmupMs);
+    TEST_ASSERT_LESS_THAN(PMS_WARMUP_MAX_MS + 2 * SAMPLING_TASK_PERIOD_MS, acq.lastWarmupMs);
+    TEST_ASSERT_EQUAL(0, acq.totalWarmupSavedMs);
+}
+
+void test_silent_sensor_times_out_each_request()
+{
+    port.silent = true;
+    acq.start(millis());
+    runWhile(ACQ_WARMING, PMS_WARMUP_MAX_MS + 1000);
+
+    TEST_ASSERT_EQUAL(ACQ_READING, acq.phase);
+    TEST_ASSERT_FALSE(acq.lastWarmupConverged);
+    TEST_ASSERT_EQUAL(0, framesSeen);
+    TEST_ASSERT_EQUAL(SerialPM::ERROR_TIMEOUT, pms.status);
+    // a request is only repeated once the previous one has timed out
+    uint32_t maxRequests = (PMS_WARMUP_MAX_MS - PMS_CMD_SETTLE_MS) / (PMS_READ_TIMEOUT_MS + SAMPLING_TASK_PERIOD_MS) + 1;
+    TEST_ASSERT_LESS_OR_EQUAL(maxRequests, port.triggers);
+    TEST_ASSERT_GREATER_THAN(maxRequests / 2, port.triggers);
+}
+
+void test_no_request_before_wake_settles()
+{
+    setPM(1, 2, 3);
+    acq.start(millis());
+    while (millis() - acq.phaseStartedAt < PMS_CMD_SETTLE_MS)
+        pass();
+    TEST_ASSERT_EQUAL(0, port.triggers);
+    pass();
+    TEST_ASSERT_EQUAL(1, port.triggers);
+}
+
+void test_sleep_settles_to_idle()
+{
+    acq.start(millis());
+    acq.enter(ACQ_READING, millis());
+    acq.finishReading(millis());
+    TEST_ASSERT_EQUAL(ACQ_SLEEPING, acq.phase);
+
+    unsigned long took = runWhile(ACQ_SLEEPING, 10 * PMS_CMD_SETTLE_MS);
+    TEST_ASSERT_EQUAL(ACQ_IDLE, acq.phase);
+    TEST_ASSERT_GREATER_OR_EQUAL(PMS_CMD_SETTLE_MS, took);
+    TEST_ASSERT_LESS_THAN(PMS_CMD_SETTLE_MS + 2 * SAMPLING_TASK_PERIOD_MS, took);
+    TEST_ASSERT_EQUAL(1, acq.cyclesCompleted);
+    TEST_ASSERT_TRUE(acq.start(millis()));
+}
+
+void test_finish_reading_ignored_outside_reading()
+{
+    acq.finishReading(millis());
+    TEST_ASSERT_EQUAL(ACQ_IDLE, acq.phase);
+    acq.start(millis());
+    acq.finishReading(millis());
+    TEST_ASSERT_EQUAL(ACQ_WARMING, acq.phase);
+}
+
+void test_clean_air_uses_absolute_tolerance()
+{
+    const uint16_t a[3] = {1, 2, 3}, b[3] = {3, 4, 5}, c[3] = {0, 0, 0}, d[3] = {0, 0, 4};
+    acq.addWarmupFrame(a);
+    acq.addWarmupFrame(b); // +2 ug/m3, far above 10% but within PMS_STABLE_TOLERANCE_UGM3
+    TEST_ASSERT_EQUAL(1, acq.stableFrames);
+    acq.addWarmupFrame(c);
+    TEST_ASSERT_EQUAL(0, acq.stableFrames);
+    acq.addWarmupFrame(d);
+    TEST_ASSERT_EQUAL(0, acq.stableFrames);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start_only_from_idle);
+    RUN_TEST(test_stable_frames_end_warmup_at_minimum);
+    RUN_TEST(test_settling_frames_delay_the_reading);
+    RUN_TEST(test_unstable_frames_read_at_maximum);
+    RUN_TEST(test_silent_sensor_times_out_each_request);
+    RUN_TEST(test_no_request_before_wake_settles);
+    RUN_TEST(test_sleep_settles_to_idle);
+    RUN_TEST(test_finish_reading_ignored_outside_reading);
+    RUN_TEST(test_clean_air_uses_absolute_tolerance);
+    return UNITY_END();
+}
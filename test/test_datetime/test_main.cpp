@@ -0,0 +1,184 @@
+/*
+ formatISO8601(), parseISO8601() and parseModemTime() against the C library:
+ every day of years 1000-9999 through gmtime_r()/strftime(), every modem date
+ yy/MM/dd (valid or not) through timegm(), and every timezone offset.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <random>
+#include <time.h>
+#include "utils/datetime.h"
+
+static const int64_t DAY = 86400;
+
+// days since 1970 of 1000-01-01 and of 10000-01-01
+static const int64_t FIRST_DAY = -354285;
+static const int64_t END_DAY = 2932897;
+
+static struct tm utc(int64_t epoch)
+{
+    time_t t = (time_t)epoch;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    return tm;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_days_from_civil_matches_timegm()
+{
+    for (int64_t days = FIRST_DAY; days < END_DAY; days++)
+    {
+        struct tm tm = utc(days * DAY);
+        int32_t year;
+        uint8_t month, day;
+        civilFromDays(days, year, month, day);
+        TEST_ASSERT_EQUAL(tm.tm_year + 1900, year);
+        TEST_ASSERT_EQUAL(tm.tm_mon + 1, month);
+        TEST_ASSERT_EQUAL(tm.tm_mday, day);
+        TEST_ASSERT_EQUAL(days, daysFromCivil(year, month, day));
+    }
+}
+
+void test_format_and_parse_every_day()
+{
+    // a random time of every day, formatted as strftime() does and parsed back
+    std::mt19937 rng(12);
+    for (int64_t days = FIRST_DAY; days < END_DAY; days++)
+    {
+        Timestamp t;
+        t.epoch = days * DAY + rng() % DAY;
+        if (!t.isSet())
+            continue; // 1970-01-01T00:00:00 is the unset clock
+        struct tm tm = utc(t.epoch);
+        char expected[32], got[32];
+        strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%S", &tm);
+        TEST_ASSERT_EQUAL(19, formatISO8601(got, sizeof(got), t));
+        TEST_ASSERT_EQUAL_STRING(expected, got);
+
+        Timestamp back;
+        TEST_ASSERT_TRUE(parseISO8601(got, back));
+        TEST_ASSERT_EQUAL(t.epoch, back.epoch);
+        TEST_ASSERT_EQUAL(TZ_OFFSET_UNKNOWN, back.tzOffsetMin);
+    }
+}
+
+void test_every_modem_date()
+{
+    // yy/MM/dd for every yy, MM 00..13 and dd 00..32: accepted exactly when timegm() keeps the date as is
+    char s[32];
+    for (int yy = 0; yy <= 99; yy++)
+        for (int mm = 0; mm <= 13; mm++)
+            for (int dd = 0; dd <= 32; dd++)
+            {
+                struct tm tm = {};
+                tm.tm_year = 100 + yy;
+                tm.tm_mon = mm - 1;
+                tm.tm_mday = dd;
+                tm.tm_hour = 13;
+                tm.tm_min = 14;
+                tm.tm_sec = 15;
+                int64_t epoch = timegm(&tm);
+                bool valid = mm >= 1 && mm <= 12 && tm.tm_mon == mm - 1 && tm.tm_mday == dd;
+
+                snprintf(s, sizeof(s), "%02d/%02d/%02d,13:14:15+00", yy, mm, dd);
+                Timestamp t;
+                TEST_ASSERT_EQUAL_MESSAGE(valid, parseModemTime(s, t), s);
+                if (valid)
+                    TEST_ASSERT_EQUAL(epoch, t.epoch);
+                else
+                    TEST_ASSERT_FALSE(t.isSet()); // untouched
+
+                snprintf(s, sizeof(s), "20%02d-%02d-%02dT13:14:15", yy, mm, dd);
+                TEST_ASSERT_EQUAL_MESSAGE(valid, parseISO8601(s, t), s);
+            }
+}
+
+void test_leap_days()
+{
+    Timestamp t;
+    TEST_ASSERT_TRUE(parseModemTime("24/02/29,00:00:00+00", t));
+    TEST_ASSERT_FALSE(parseModemTime("25/02/29,00:00:00+00", t));
+    TEST_ASSERT_FALSE(parseModemTime("26/02/31,00:00:00+00", t));
+    TEST_ASSERT_TRUE(parseModemTime("00/02/29,00:00:00+00", t)); // 2000 is divisible by 400
+    TEST_ASSERT_TRUE(parseISO8601("2000-02-29T00:00:00", t));
+    TEST_ASSERT_FALSE(parseISO8601("2100-02-29T00:00:00", t));
+    TEST_ASSERT_FALSE(parseISO8601("2025-04-31T00:00:00", t));
+}
+
+void test_every_timezone_offset()
+{
+    // Quectel quarter hours -48..+56, and whole hours for the modems that report those
+    char s[32];
+    const int64_t local = daysFromCivil(2025, 2, 24) * DAY + 8 * 3600 + 55 * 60 + 53;
+    for (int zone = -48; zone <= 56; zone++)
+    {
+        snprintf(s, sizeof(s), "\"25/02/24,08:55:53%c%02d\"", zone < 0 ? '-' : '+', zone < 0 ? -zone : zone);
+        Timestamp t;
+        TEST_ASSERT_TRUE_MESSAGE(parseModemTime(s, t), s);
+        TEST_ASSERT_EQUAL(zone * 15, t.tzOffsetMin);
+        TEST_ASSERT_EQUAL(local - zone * 15 * 60, t.epoch);
+        TEST_ASSERT_EQUAL(local, t.localEpoch());
+
+        // the local wall clock comes back out, with the offset, and parses to the same instant
+        char iso[32];
+        TEST_ASSERT_GREATER_THAN(19, formatISO8601(iso, sizeof(iso), t));
+        TEST_ASSERT_EQUAL(0, strncmp(iso, "2025-02-24T08:55:53", 19));
+        Timestamp back;
+        TEST_ASSERT_TRUE_MESSAGE(parseISO8601(iso, back), iso);
+        TEST_ASSERT_EQUAL(t.epoch, back.epoch);
+        TEST_ASSERT_EQUAL(t.tzOffsetMin, back.tzOffsetMin);
+
+        TEST_ASSERT_TRUE(parseModemTime(s, t, false));
+        TEST_ASSERT_EQUAL(zone * 60, t.tzOffsetMin);
+    }
+}
+
+void test_malformed_modem_time()
+{
+    const char *bad[] = {"", "25/02/24", "25-02-24,08:55:53+12", "25/02/24,24:00:00+12", "25/02/24,08:60:00+12",
+                         "25/02/24,08:55:60+12", "25/02/24,08:55:53+1", "25/02/24,08:55:53*12",
+                         "25/02/24,08:55:53+12x", "2a/02/24,08:55:53+12"};
+    for (const char *s : bad)
+    {
+        Timestamp t;
+        TEST_ASSERT_FALSE_MESSAGE(parseModemTime(s, t), s);
+        TEST_ASSERT_FALSE(t.isSet());
+    }
+    Timestamp t;
+    TEST_ASSERT_FALSE(parseModemTime(nullptr, t));
+    TEST_ASSERT_TRUE(parseModemTime("25/02/24,08:55:53", t));
+    TEST_ASSERT_EQUAL(TZ_OFFSET_UNKNOWN, t.tzOffsetMin);
+}
+
+void test_format_limits()
+{
+    char buf[32] = "x";
+    Timestamp t;
+    TEST_ASSERT_EQUAL(0, formatISO8601(buf, sizeof(buf), t)); // clock not set
+    TEST_ASSERT_EQUAL_STRING("", buf);
+    t.epoch = END_DAY * DAY;
+    TEST_ASSERT_EQUAL(0, formatISO8601(buf, sizeof(buf), t)); // year 10000
+    t.epoch = 1740376553;
+    t.tzOffsetMin = 180;
+    TEST_ASSERT_EQUAL(0, formatISO8601(buf, 22, t)); // "+03" needs 23 bytes
+    TEST_ASSERT_EQUAL(22, formatISO8601(buf, 23, t));
+    TEST_ASSERT_EQUAL_STRING("2025-02-24T08:55:53+03", buf);
+    t.tzOffsetMin = -330;
+    TEST_ASSERT_EQUAL(25, formatISO8601(buf, 26, t));
+    TEST_ASSERT_EQUAL_STRING("2025-02-24T00:25:53-05:30", buf);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_days_from_civil_matches_timegm);
+    RUN_TEST(test_format_and_parse_every_day);
+    RUN_TEST(test_every_modem_date);
+    RUN_TEST(test_leap_days);
+    RUN_TEST(test_every_timezone_offset);
+    RUN_TEST(test_malformed_modem_time);
+    RUN_TEST(test_format_limits);
+    return UNITY_END();
+}
@@ -0,0 +1,182 @@
+/*
+ dhtDecodePulses() / dhtConvertBits() / dhtDecode(): datasheet vectors, both
+ negative temperature encodings, error codes, and pulse widths with jitter.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <random>
+#include "dhtnew.h"
+
+// HIGH pulse widths of 40 data bits, MSB first
+static void encodePulses(const uint8_t bits[5], uint16_t zero, uint16_t one, uint16_t pulses[40])
+{
+    for (uint8_t i = 0; i < 40; i++)
+        pulses[i] = bits[i / 8] & (0x80 >> (i % 8)) ? one : zero;
+}
+
+static void withChecksum(uint8_t bits[5])
+{
+    bits[4] = bits[0] + bits[1] + bits[2] + bits[3];
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_dht22_datasheet_example()
+{
+    // AM2302 datasheet: 65.2 %RH, 35.1 C
+    const uint8_t bits[5] = {0x02, 0x8C, 0x01, 0x5F, 0xEE};
+    float humidity = 0, temperature = 0;
+    dhtConvertBits(bits, 22, humidity, temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 65.2f, humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 35.1f, temperature);
+
+    uint16_t pulses[40];
+    encodePulses(bits, 27, 70, pulses);
+    uint8_t decoded[5];
+    TEST_ASSERT_EQUAL(DHTLIB_OK, dhtDecodePulses(pulses, 40, decoded));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(bits, decoded, 5);
+}
+
+void test_dht22_negative_sign_magnitude()
+{
+    // AM2302 datasheet: bit 15 set = negative, -10.1 C
+    uint8_t bits[5] = {0x02, 0x8C, 0x80, 0x65};
+    withChecksum(bits);
+    float humidity = 0, temperature = 0;
+    dhtConvertBits(bits, 22, humidity, temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -10.1f, temperature);
+}
+
+void test_dht22_negative_twos_complement()
+{
+    // some clones send the temperature as a 16 bit two's complement (RobTillaart/DHTNew#100)
+    uint8_t bits[5] = {0x02, 0x8C, 0xFF, 0x9B}; // -101
+    withChecksum(bits);
+    float humidity = 0, temperature = 0;
+    dhtConvertBits(bits, 22, humidity, temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -10.1f, temperature);
+}
+
+void test_dht22_zero_is_positive_zero()
+{
+    const uint8_t bits[5] = {0x01, 0xF4, 0x00, 0x00, 0xF5};
+    float humidity = 0, temperature = 1;
+    dhtConvertBits(bits, 22, humidity, temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 50.0f, humidity);
+    TEST_ASSERT_TRUE(temperature == 0.0f && !signbit(temperature));
+}
+
+void test_dht22_range_limits()
+{
+    // 100.0 %RH and 80.0 C, -40.0 C
+    uint8_t hot[5] = {0x03, 0xE8, 0x03, 0x20};
+    uint8_t cold[5] = {0x00, 0x00, 0x81, 0x90};
+    withChecksum(hot);
+    withChecksum(cold);
+    float humidity = 0, temperature = 0;
+    dhtConvertBits(hot, 22, humidity, temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 100.0f, humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 80.0f, temperature);
+    dhtConvertBits(cold, 22, humidity, temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -40.0f, temperature);
+}
+
+void test_dht11_integral_and_decimal_bytes()
+{
+    uint8_t bits[5] = {55, 0, 24, 3};
+    withChecksum(bits);
+    float humidity = 0, temperature = 0;
+    dhtConvertBits(bits, 11, humidity, temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 55.0f, humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 24.3f, temperature);
+}
+
+void test_too_few_pulses()
+{
+    uint16_t pulses[40] = {};
+    uint8_t bits[5] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_EQUAL(DHTLIB_ERROR_TIMEOUT_C, dhtDecodePulses(pulses, 39, bits));
+    const uint8_t zero[5] = {};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(zero, bits, 5);
+}
+
+void test_checksum_error()
+{
+    uint8_t bits[5] = {0x02, 0x8C, 0x01, 0x5F, 0xEF};
+    uint16_t pulses[40];
+    encodePulses(bits, 27, 70, pulses);
+    uint8_t decoded[5];
+    TEST_ASSERT_EQUAL(DHTLIB_ERROR_CHECKSUM, dhtDecodePulses(pulses, 40, decoded));
+    float humidity = -1, temperature = -1;
+    TEST_ASSERT_EQUAL(DHTLIB_ERROR_CHECKSUM, dhtDecode(pulses, 40, 22, humidity, temperature));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, humidity); // outputs untouched on error
+}
+
+void test_bit_shift()
+{
+    // a pulse pattern shifted right by one bit sets the humidity MSB
+    uint8_t bits[5] = {0x82, 0x8C, 0x01, 0x5F};
+    withChecksum(bits);
+    uint16_t pulses[40];
+    encodePulses(bits, 27, 70, pulses);
+    uint8_t decoded[5];
+    TEST_ASSERT_EQUAL(DHTLIB_ERROR_BIT_SHIFT, dhtDecodePulses(pulses, 40, decoded));
+}
+
+void test_threshold_boundary()
+{
+    // a pulse counts as 1 only above the threshold
+    uint8_t bits[5] = {0x00, 0x01, 0x00, 0x00, 0x01};
+    uint16_t pulses[40];
+    encodePulses(bits, DHTLIB_BIT_THRESHOLD, DHTLIB_BIT_THRESHOLD + 1, pulses);
+    uint8_t decoded[5];
+    TEST_ASSERT_EQUAL(DHTLIB_OK, dhtDecodePulses(pulses, 40, decoded));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(bits, decoded, 5);
+    // one higher and every pulse is a 0
+    const uint8_t zero[5] = {};
+    TEST_ASSERT_EQUAL(DHTLIB_OK, dhtDecodePulses(pulses, 40, decoded, DHTLIB_BIT_THRESHOLD + 1));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(zero, decoded, 5);
+}
+
+void test_jittered_pulses_round_trip()
+{
+    // every DHT22 reading in range survives pulse widths anywhere in the datasheet tolerance plus ISR latency
+    std::mt19937 rng(22);
+    std::uniform_int_distribution<int> zero(18, 45), one(56, 90);
+    for (uint32_t k = 0; k < 20000; k++)
+    {
+        int16_t t = (int16_t)(rng() % 1201) - 400; // -40.0 .. 80.0 C
+        uint16_t h = rng() % 1001;                  // 0.0 .. 100.0 %RH
+        uint16_t magnitude = t < 0 ? -t : t;
+        uint8_t bits[5] = {(uint8_t)(h >> 8), (uint8_t)h, (uint8_t)((magnitude >> 8) | (t < 0 ? 0x80 : 0)),
+                           (uint8_t)magnitude};
+        withChecksum(bits);
+        uint16_t pulses[40];
+        for (uint8_t i = 0; i < 40; i++)
+            pulses[i] = bits[i / 8] & (0x80 >> (i % 8)) ? one(rng) : zero(rng);
+
+        float humidity = 0, temperature = 0;
+        TEST_ASSERT_EQUAL(DHTLIB_OK, dhtDecode(pulses, 40, 22, humidity, temperature));
+        TEST_ASSERT_FLOAT_WITHIN(0.0001f, h * 0.1f, humidity);
+        TEST_ASSERT_FLOAT_WITHIN(0.0001f, t * 0.1f, temperature);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dht22_datasheet_example);
+    RUN_TEST(test_dht22_negative_sign_magnitude);
+    RUN_TEST(test_dht22_negative_twos_complement);
+    RUN_TEST(test_dht22_zero_is_positive_zero);
+    RUN_TEST(test_dht22_range_limits);
+    RUN_TEST(test_dht11_integral_and_decimal_bytes);
+    RUN_TEST(test_too_few_pulses);
+    RUN_TEST(test_checksum_error);
+    RUN_TEST(test_bit_shift);
+    RUN_TEST(test_threshold_boundary);
+    RUN_TEST(test_jittered_pulses_round_trip);
+    return UNITY_END();
+}
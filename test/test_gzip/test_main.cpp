@@ -0,0 +1,228 @@
+/*
+ GzipEncoder: every member it writes must inflate with zlib to the input, with
+ the right CRC-32 and length, for batched payloads, edge-case inputs and every
+ output buffer size; compression ratio and speed reported against zlib.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "utils/gzip.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static GzipEncoder gzip;
+
+static Bytes inflateGzip(const uint8_t *data, size_t n)
+{
+    Bytes out(GzipEncoder::MAX_INPUT_BYTES + 1);
+    z_stream z = {};
+    TEST_ASSERT_EQUAL(Z_OK, inflateInit2(&z, 16 + MAX_WBITS)); // gzip wrapper only
+    z.next_in = (Bytef *)data;
+    z.avail_in = n;
+    z.next_out = out.data();
+    z.avail_out = out.size();
+    int status = inflate(&z, Z_FINISH);
+    size_t length = z.total_out;
+    size_t consumed = z.total_in;
+    inflateEnd(&z);
+    TEST_ASSERT_EQUAL_MESSAGE(Z_STREAM_END, status, "zlib could not inflate the member (bad data, CRC or length)");
+    TEST_ASSERT_EQUAL(n, consumed); // nothing after the trailer
+    out.resize(length);
+    return out;
+}
+
+// compress, and if a member came out, check it inflates to the input
+static size_t roundTrip(const Bytes &in, size_t outSize = 0)
+{
+    Bytes out(outSize ? outSize : in.size() + 64);
+    size_t n = gzip.compress(in.data(), in.size(), out.data(), out.size());
+    if (n == 0)
+        return 0;
+    TEST_ASSERT_LESS_THAN(in.size(), n);
+    TEST_ASSERT_LESS_OR_EQUAL(out.size(), n);
+    TEST_ASSERT_TRUE(inflateGzip(out.data(), n) == in);
+    return n;
+}
+
+static Bytes batchedPayloads(uint32_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::string body = "[";
+    for (uint32_t i = 0; i < count; i++)
+    {
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "%s{\"software_version\":\"NRZ-2020-129\",\"timestamp\":\"2025-02-24T%02u:%02u:%02u+03\","
+                 "\"sensordatavalues\":[{\"value_type\":\"P0\",\"value\":%u},{\"value_type\":\"P1\",\"value\":%u},"
+                 "{\"value_type\":\"P2\",\"value\":%u}],\"sensor_type\":\"PMS\",\"API_PIN\":1}",
+                 i ? "," : "", (unsigned)(i / 60 % 24), (unsigned)(i % 60), (unsigned)(rng() % 60), (unsigned)(rng() % 50),
+                 (unsigned)(rng() % 80), (unsigned)(rng() % 120));
+        body += line;
+    }
+    body += "]";
+    return Bytes(body.begin(), body.end());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_crc32_matches_zlib()
+{
+    std::mt19937 rng(16);
+    for (size_t n = 0; n < 300; n++)
+    {
+        Bytes data(n);
+        for (uint8_t &b : data)
+            b = rng();
+        TEST_ASSERT_EQUAL_HEX32(crc32(0, data.data(), n), GzipEncoder::crc32(data.data(), n));
+    }
+}
+
+void test_batched_payloads_round_trip()
+{
+    for (uint32_t count = 1; count <= 200; count += 7)
+    {
+        Bytes in = batchedPayloads(count, count);
+        size_t n = roundTrip(in);
+        TEST_ASSERT_GREATER_THAN(0, n);
+        if (count >= 8)
+            TEST_ASSERT_LESS_THAN(in.size() / 3, n); // the keys repeat in every entry
+    }
+}
+
+void test_every_length_of_mixed_input()
+{
+    // text, runs and noise; prefixes of every length up to a few windows
+    std::mt19937 rng(1952);
+    Bytes data = batchedPayloads(20, 3);
+    data.insert(data.end(), 700, 'a');
+    for (uint32_t i = 0; i < 500; i++)
+        data.push_back(rng());
+    Bytes more = batchedPayloads(5, 4);
+    data.insert(data.end(), more.begin(), more.end());
+    for (size_t n = 1; n <= data.size(); n++)
+        roundTrip(Bytes(data.begin(), data.begin() + n));
+}
+
+void test_longest_runs_and_farthest_matches()
+{
+    Bytes run(10000, 'x'); // distance 1, length 258 over and over
+    TEST_ASSERT_LESS_THAN(200, roundTrip(run));
+
+    // a block repeated at exactly the window size, one byte less and one byte more
+    std::mt19937 rng(1024);
+    for (size_t gap : {GZIP_WINDOW - 1, GZIP_WINDOW, GZIP_WINDOW + 1})
+    {
+        Bytes block(gap);
+        for (uint8_t &b : block)
+            b = 'a' + rng() % 26;
+        Bytes in = block;
+        in.insert(in.end(), block.begin(), block.end());
+        in.insert(in.end(), block.begin(), block.end());
+        roundTrip(in);
+    }
+}
+
+void test_largest_input()
+{
+    Bytes in = batchedPayloads(400, 5);
+    in.resize(GzipEncoder::MAX_INPUT_BYTES, ' ');
+    TEST_ASSERT_GREATER_THAN(0, roundTrip(in));
+    in.push_back(' ');
+    Bytes out(in.size());
+    TEST_ASSERT_EQUAL(0, gzip.compress(in.data(), in.size(), out.data(), out.size()));
+}
+
+void test_incompressible_input_is_refused()
+{
+    std::mt19937 rng(8);
+    Bytes noise(2000);
+    for (uint8_t &b : noise)
+        b = rng();
+    TEST_ASSERT_EQUAL(0, roundTrip(noise));
+    TEST_ASSERT_EQUAL(0, roundTrip(Bytes{'{', '}'})); // header and trailer alone are 18 bytes
+}
+
+void test_every_output_size()
+{
+    // a buffer too small gives 0, never a truncated member
+    Bytes in = batchedPayloads(10, 6);
+    size_t full = roundTrip(in);
+    TEST_ASSERT_GREATER_THAN(0, full);
+    for (size_t size = 0; size < full; size++)
+    {
+        Bytes out(size + 1);
+        TEST_ASSERT_EQUAL(0, gzip.compress(in.data(), in.size(), out.data(), size));
+    }
+    TEST_ASSERT_EQUAL(full, roundTrip(in, full));
+}
+
+void test_random_inputs_round_trip()
+{
+    // small alphabets make matches of every length and distance
+    std::mt19937 rng(20250224);
+    for (uint32_t k = 0; k < 2000; k++)
+    {
+        Bytes in(1 + rng() % 3000);
+        uint8_t alphabet = 1 + rng() % 8;
+        for (uint8_t &b : in)
+            b = 'a' + rng() % alphabet;
+        roundTrip(in);
+    }
+}
+
+void test_benchmark_against_zlib()
+{
+    Bytes in = batchedPayloads(60, 7); // one hour of minute readings
+    Bytes out(in.size());
+    const uint32_t rounds = 200;
+    size_t ours = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; r++)
+        ours = gzip.compress(in.data(), in.size(), out.data(), out.size());
+    double oursUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    Bytes zout(compressBound(in.size()) + 32);
+    size_t theirs = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        z_stream z = {};
+        deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        z.next_in = in.data();
+        z.avail_in = in.size();
+        z.next_out = zout.data();
+        z.avail_out = zout.size();
+        deflate(&z, Z_FINISH);
+        theirs = z.total_out;
+        deflateEnd(&z);
+    }
+    double zlibUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%u byte batch: GzipEncoder %u bytes in %.0f us, zlib -6 %u bytes in %.0f us",
+             (unsigned)in.size(), (unsigned)ours, oursUs, (unsigned)theirs, zlibUs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_GREATER_THAN(0, ours);
+    TEST_ASSERT_TRUE(inflateGzip(out.data(), ours) == in);
+    TEST_ASSERT_LESS_THAN(2 * theirs + 64, ours); // fixed Huffman and a 1 KB window stay within 2x of zlib here
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_matches_zlib);
+    RUN_TEST(test_batched_payloads_round_trip);
+    RUN_TEST(test_every_length_of_mixed_input);
+    RUN_TEST(test_longest_runs_and_farthest_matches);
+    RUN_TEST(test_largest_input);
+    RUN_TEST(test_incompressible_input_is_refused);
+    RUN_TEST(test_every_output_size);
+    RUN_TEST(test_random_inputs_round_trip);
+    RUN_TEST(test_benchmark_against_zlib);
+    return UNITY_END();
+}
@@ -0,0 +1,229 @@
+/*
+ JsonWriter and formatJsonFloat() against ArduinoJson's serializeJson(): fixed
+ vectors, every float exponent, random bit patterns, a sensor payload, and the
+ cost of writing that payload both ways.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <float.h>
+#include <random>
+#include <string>
+#include "utils/json_writer.h"
+
+static std::string ours(float v)
+{
+    char buf[32];
+    size_t n = formatJsonFloat(buf, sizeof(buf), v);
+    return std::string(buf, n);
+}
+
+static std::string theirs(float v)
+{
+    JsonDocument doc;
+    doc.set(v);
+    char buf[32];
+    size_t n = serializeJson(doc, buf, sizeof(buf));
+    return std::string(buf, n);
+}
+
+static void assertSameAsArduinoJson(float v)
+{
+    std::string expected = theirs(v), got = ours(v);
+    if (expected != got)
+    {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "%a: ArduinoJson %s, formatJsonFloat %s", (double)v, expected.c_str(), got.c_str());
+        TEST_FAIL_MESSAGE(msg);
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_float_vectors()
+{
+    // what serializeJson() writes for a float in ArduinoJson 7.3 and later
+    TEST_ASSERT_EQUAL_STRING("0", ours(0.0f).c_str());
+    TEST_ASSERT_EQUAL_STRING("0", ours(-0.0f).c_str());
+    TEST_ASSERT_EQUAL_STRING("0.1", ours(0.1f).c_str());
+    TEST_ASSERT_EQUAL_STRING("23", ours(23.0f).c_str());
+    TEST_ASSERT_EQUAL_STRING("23.4", ours(23.4f).c_str());
+    TEST_ASSERT_EQUAL_STRING("-10.1", ours(-10.1f).c_str());
+    TEST_ASSERT_EQUAL_STRING("3.141593", ours(3.14159265f).c_str());
+    TEST_ASSERT_EQUAL_STRING("123.456", ours(123.456f).c_str());
+    TEST_ASSERT_EQUAL_STRING("0.000123", ours(0.000123f).c_str());
+    TEST_ASSERT_EQUAL_STRING("9999999", ours(9999999.0f).c_str());
+    TEST_ASSERT_EQUAL_STRING("1e7", ours(1e7f).c_str());
+    TEST_ASSERT_EQUAL_STRING("1.234568e8", ours(123456789.0f).c_str());
+    TEST_ASSERT_EQUAL_STRING("4.294967e9", ours(4294967295.0f).c_str());
+    TEST_ASSERT_EQUAL_STRING("1e-5", ours(1e-5f).c_str());
+    TEST_ASSERT_EQUAL_STRING("0.000015", ours(1.5e-5f).c_str());
+    TEST_ASSERT_EQUAL_STRING("2e-6", ours(2e-6f).c_str());
+    TEST_ASSERT_EQUAL_STRING("3.402823e38", ours(FLT_MAX).c_str());
+    TEST_ASSERT_EQUAL_STRING("-1.175494e-38", ours(-FLT_MIN).c_str());
+    TEST_ASSERT_EQUAL_STRING("null", ours(NAN).c_str());
+    TEST_ASSERT_EQUAL_STRING("null", ours(INFINITY).c_str());
+    TEST_ASSERT_EQUAL_STRING("null", ours(-INFINITY).c_str());
+}
+
+void test_float_too_long_for_buffer()
+{
+    char buf[6] = "xxxxx";
+    TEST_ASSERT_EQUAL(0, formatJsonFloat(buf, sizeof(buf), 3.14159265f)); // "3.141593"
+    TEST_ASSERT_EQUAL_STRING("", buf);
+    TEST_ASSERT_EQUAL(5, formatJsonFloat(buf, sizeof(buf), 23.45f));
+    TEST_ASSERT_EQUAL_STRING("23.45", buf);
+}
+
+void test_every_exponent_matches_arduinojson()
+{
+    // powers of ten, and the floats either side, across the whole float range
+    for (int e = -45; e <= 38; e++)
+    {
+        float v = (float)pow(10.0, e);
+        const float around[] = {v, nextafterf(v, 0), nextafterf(v, INFINITY), 1.5f * v, 9.999999f * v};
+        for (float a : around)
+        {
+            assertSameAsArduinoJson(a);
+            assertSameAsArduinoJson(-a);
+        }
+    }
+}
+
+void test_sensor_range_matches_arduinojson()
+{
+    // every DHT reading (-40.0 .. 125.0, 0.1 steps) and PM concentration as a float
+    for (int t = -400; t <= 1250; t++)
+        assertSameAsArduinoJson(t * 0.1f);
+    for (int pm = 0; pm <= 2000; pm++)
+        assertSameAsArduinoJson((float)pm);
+}
+
+void test_random_bit_patterns_match_arduinojson()
+{
+    std::mt19937 rng(11);
+    for (uint32_t k = 0; k < 1000000; k++)
+    {
+        uint32_t bits = rng();
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        assertSameAsArduinoJson(v);
+    }
+}
+
+static const char *const VALUE_TYPES[] = {"temperature", "humidity"};
+
+static size_t writePayload(char *buf, size_t size, const float *values)
+{
+    JsonWriter json(buf, size);
+    json.beginObject();
+    json.key("software_version");
+    json.value("NRZ-2020-129");
+    json.key("timestamp");
+    json.value("2024-06-11T08:30:00Z");
+    json.key("sensordatavalues");
+    json.beginArray();
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        json.beginObject();
+        json.key("value_type");
+        json.value(VALUE_TYPES[i]);
+        json.key("value");
+        json.value(values[i]);
+        json.endObject();
+    }
+    json.endArray();
+    json.key("sensor_type");
+    json.value("dht22");
+    json.key("API_PIN");
+    json.value((int32_t)7);
+    json.endObject();
+    return json.finish();
+}
+
+// the baseline generateJSON_payload()
+static size_t serializePayload(char *buf, size_t size, const float *values)
+{
+    JsonDocument payload;
+    payload["software_version"] = "NRZ-2020-129";
+    payload["timestamp"] = "2024-06-11T08:30:00Z";
+    JsonArray data = payload["sensordatavalues"].to<JsonArray>();
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        JsonObject obj = data.add<JsonObject>();
+        obj["value_type"] = VALUE_TYPES[i];
+        obj["value"] = values[i];
+    }
+    payload["sensor_type"] = "dht22";
+    payload["API_PIN"] = 7;
+    return serializeJson(payload, buf, size);
+}
+
+void test_payload_matches_arduinojson()
+{
+    const float values[][2] = {{23.4f, 65.2f}, {-10.1f, 100.0f}, {0.0f, 1e-6f}, {NAN, 42.0f}};
+    for (const float *v : values)
+    {
+        char expected[256], got[256];
+        serializePayload(expected, sizeof(expected), v);
+        TEST_ASSERT_GREATER_THAN(0, writePayload(got, sizeof(got), v));
+        TEST_ASSERT_EQUAL_STRING(expected, got);
+    }
+}
+
+void test_payload_overflow_leaves_empty_string()
+{
+    const float values[2] = {23.4f, 65.2f};
+    char full[256];
+    size_t length = writePayload(full, sizeof(full), values);
+    char buf[256];
+    TEST_ASSERT_EQUAL(0, writePayload(buf, length, values)); // no room for the terminator
+    TEST_ASSERT_EQUAL_STRING("", buf);
+    TEST_ASSERT_EQUAL(length, writePayload(buf, length + 1, values));
+}
+
+void test_benchmark_payload()
+{
+    const uint32_t rounds = 100000;
+    char buf[256];
+    float values[2] = {23.4f, 65.2f};
+    size_t total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        values[0] = 20.0f + (r % 100) * 0.1f;
+        total += writePayload(buf, sizeof(buf), values);
+    }
+    double writerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        values[0] = 20.0f + (r % 100) * 0.1f;
+        total -= serializePayload(buf, sizeof(buf), values);
+    }
+    double documentNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "DHT payload: JsonWriter %.0f ns, JsonDocument + serializeJson %.0f ns (%.1fx)", writerNs,
+             documentNs, documentNs / writerNs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(0, total); // same length every round
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_float_vectors);
+    RUN_TEST(test_float_too_long_for_buffer);
+    RUN_TEST(test_every_exponent_matches_arduinojson);
+    RUN_TEST(test_sensor_range_matches_arduinojson);
+    RUN_TEST(test_random_bit_patterns_match_arduinojson);
+    RUN_TEST(test_payload_matches_arduinojson);
+    RUN_TEST(test_payload_overflow_leaves_empty_string);
+    RUN_TEST(test_benchmark_payload);
+    return UNITY_END();
+}
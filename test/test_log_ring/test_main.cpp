@@ -0,0 +1,258 @@
+/*
+ LogRing / LogArena against a std::deque model under random pushes, pops and
+ clears, on buffers with guard bytes; and the PSRAM OfflineQueue holding
+ SampleRecords the way memoryDataLog() and queueOffline() use it.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "utils/log_arena.h"
+#include "utils/offline_queue.h"
+#include "utils/sample_record.h"
+
+static const uint8_t GUARD = 0xA5;
+static const size_t GUARD_BYTES = 16;
+
+// the ring must match the model record for record, and never write outside its buffer
+static void assertSame(const LogRing &ring, const std::deque<std::string> &model, const std::vector<uint8_t> &memory,
+                       size_t capacity)
+{
+    TEST_ASSERT_EQUAL(model.size(), ring.size());
+    TEST_ASSERT_EQUAL(model.empty(), ring.empty());
+    size_t i = 0, live = 0;
+    for (LogRecord r : ring)
+    {
+        TEST_ASSERT_TRUE(i < model.size());
+        TEST_ASSERT_TRUE(std::string(r.data, r.length) == model[i]);
+        TEST_ASSERT_EQUAL('\0', r.data[r.length]);
+        live += r.length + LogRing::RECORD_OVERHEAD;
+        i++;
+    }
+    TEST_ASSERT_EQUAL(model.size(), i);
+    // used bytes are the live records plus a skipped buffer end, never more than the buffer
+    TEST_ASSERT_GREATER_OR_EQUAL(live, ring.bytesUsed());
+    TEST_ASSERT_LESS_OR_EQUAL(capacity, ring.bytesUsed());
+    for (size_t g = 0; g < GUARD_BYTES; g++)
+    {
+        TEST_ASSERT_EQUAL_HEX8(GUARD, memory[g]);
+        TEST_ASSERT_EQUAL_HEX8(GUARD, memory[GUARD_BYTES + capacity + g]);
+    }
+}
+
+static void fuzz(size_t capacity, size_t maxRecords, size_t maxLength, uint32_t seed, uint32_t steps)
+{
+    std::vector<uint8_t> memory(capacity + 2 * GUARD_BYTES, GUARD);
+    LogRing ring;
+    ring.attach(memory.data() + GUARD_BYTES, capacity, maxRecords);
+    std::deque<std::string> model;
+    std::mt19937 rng(seed);
+    uint32_t pushed = 0, refused = 0;
+
+    for (uint32_t step = 0; step < steps; step++)
+    {
+        uint32_t op = rng() % 100;
+        if (op < 60)
+        {
+            // binary records: any byte, '\0' included
+            std::string s(rng() % (maxLength + 1), '\0');
+            for (char &c : s)
+                c = rng() % 4 == 0 ? '\0' : (char)rng();
+            size_t usedBefore = ring.bytesUsed();
+            if (ring.push(s.data(), s.size()))
+            {
+                model.push_back(s);
+                pushed++;
+            }
+            else
+            {
+                // refused only when the records run out or neither free stretch takes it
+                refused++;
+                size_t need = s.size() + LogRing::RECORD_OVERHEAD;
+                TEST_ASSERT_TRUE(model.size() == maxRecords || usedBefore + 2 * need > capacity);
+                TEST_ASSERT_EQUAL(usedBefore, ring.bytesUsed());
+            }
+        }
+        else if (op < 98)
+        {
+            LogRecord oldest = ring.peek();
+            if (model.empty())
+            {
+                TEST_ASSERT_NULL(oldest.data);
+                ring.pop(); // no-op
+            }
+            else
+            {
+                TEST_ASSERT_TRUE(std::string(oldest.data, oldest.length) == model.front());
+                ring.pop();
+                model.pop_front();
+            }
+        }
+        else
+        {
+            ring.clear();
+            model.clear();
+            TEST_ASSERT_EQUAL(0, ring.bytesUsed());
+        }
+        assertSame(ring, model, memory, capacity);
+    }
+    TEST_ASSERT_GREATER_THAN(0, pushed);
+    TEST_ASSERT_GREATER_THAN(0, refused); // the ring was full at times
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fuzz_tiny_ring()
+{
+    fuzz(4, 10, 1, 1, 20000);
+    fuzz(7, 10, 4, 2, 50000);
+    fuzz(64, 100, 30, 3, 100000);
+}
+
+void test_fuzz_memory_logger_sizes()
+{
+    // the 12 KB / 96 record JSON and CSV memory loggers with payload-sized records
+    fuzz(12240, 96, 250, 4, 100000);
+    fuzz(12240, 96, 40, 5, 100000); // record limit first
+}
+
+void test_fuzz_record_sizes_near_capacity()
+{
+    fuzz(300, 8, 297, 6, 50000);
+    fuzz(1000, 1000, 200, 7, 100000);
+}
+
+void test_refuses_what_never_fits()
+{
+    LogArena<16, 4> arena;
+    char big[14] = {};
+    TEST_ASSERT_FALSE(arena.push(big, 14)); // 17 bytes with length and terminator
+    TEST_ASSERT_TRUE(arena.push(big, 13));
+    TEST_ASSERT_FALSE(arena.push("", 0));
+    LogRing detached;
+    TEST_ASSERT_FALSE(detached.push("x"));
+    TEST_ASSERT_EQUAL(0, detached.capacity());
+}
+
+void test_offline_queue_holds_sample_records()
+{
+    static OfflineQueue queue; // allocated once and kept, as in the firmware
+    TEST_ASSERT_TRUE(queue.begin(PSRAM_QUEUE_BYTES));
+    TEST_ASSERT_TRUE(queue.enabled());
+    TEST_ASSERT_FALSE(queue.psram);
+    TEST_ASSERT_TRUE(queue.begin(PSRAM_QUEUE_BYTES)); // once only
+
+    // alternating PMS and DHT records, 5 minutes apart, until the queue is full
+    std::deque<SampleRecord> model;
+    SampleRecord record;
+    record.time.epoch = 1740376553;
+    record.time.tzOffsetMin = 180;
+    for (;;)
+    {
+        record.sensor = model.size() % 2 ? SENSOR_DHT : SENSOR_PMS;
+        for (uint8_t i = 0; i < SENSOR_MAX_VALUES; i++)
+            record.values[i] = (float)(model.size() % 97) + i * 0.5f;
+        if (!queue.records.push((const char *)&record, sizeof(record)))
+            break;
+        model.push_back(record);
+        if (model.size() % 2 == 0)
+            record.time.epoch += 300;
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%u KB holds %u sample records, %.1f days of 5-minute PMS and DHT samples",
+             (unsigned)(PSRAM_QUEUE_BYTES / 1024), (unsigned)model.size(), model.size() / 2.0 / 288);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_GREATER_THAN(30 * 288 * 2, model.size()); // over a month
+
+    size_t i = 0;
+    for (LogRecord stored : queue.records)
+    {
+        TEST_ASSERT_EQUAL(sizeof(SampleRecord), stored.length);
+        TEST_ASSERT_EQUAL_MEMORY(&model[i], stored.data, sizeof(SampleRecord));
+        i++;
+    }
+    TEST_ASSERT_EQUAL(model.size(), i);
+}
+
+void test_offline_queue_flush_due()
+{
+    static OfflineQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(4096));
+    TEST_ASSERT_FALSE(queue.flushDue(1000000, 5000)); // empty
+    queue.records.push("x");
+    queue.queuedSince = 1000;
+    TEST_ASSERT_FALSE(queue.flushDue(5999, 5000));
+    TEST_ASSERT_TRUE(queue.flushDue(6000, 5000));
+    TEST_ASSERT_FALSE(queue.flushDue(6000, 0)); // timed flushes off
+
+    OfflineQueue off;
+    TEST_ASSERT_FALSE(off.begin(0));
+    TEST_ASSERT_FALSE(off.enabled());
+    TEST_ASSERT_FALSE(off.records.push("x"));
+}
+
+void test_fuzz_offline_queue_spills()
+{
+    // memory logger batches move to the queue; a full queue is spilled (cleared) first, as queueOffline() does, and a
+    // link coming back sends (clears) it: nothing is lost or reordered in between
+    static OfflineQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(2048));
+    std::mt19937 rng(22);
+    std::deque<uint32_t> model;
+    uint32_t next = 0, spilled = 0, sent = 0, spills = 0;
+    for (uint32_t round = 0; round < 5000; round++)
+    {
+        if (rng() % 10 == 0)
+        {
+            // link back: everything queued goes out, oldest first
+            for (LogRecord stored : queue.records)
+            {
+                uint32_t id;
+                memcpy(&id, stored.data, sizeof(id));
+                TEST_ASSERT_EQUAL(model.front(), id);
+                model.pop_front();
+                sent++;
+            }
+            TEST_ASSERT_TRUE(model.empty());
+            queue.records.clear();
+            continue;
+        }
+        uint32_t batch = 1 + rng() % 40;
+        for (uint32_t k = 0; k < batch; k++)
+        {
+            SampleRecord record;
+            record.sensor = rng() % SENSOR_COUNT;
+            char bytes[sizeof(SampleRecord)];
+            memcpy(bytes, &record, sizeof(record));
+            memcpy(bytes, &next, sizeof(next)); // sequence number in place of the epoch
+            if (!queue.records.push(bytes, sizeof(bytes)))
+            {
+                spilled += queue.records.size();
+                spills++;
+                model.clear();
+                queue.records.clear();
+                TEST_ASSERT_TRUE(queue.records.push(bytes, sizeof(bytes)));
+            }
+            model.push_back(next++);
+        }
+        TEST_ASSERT_EQUAL(model.size(), queue.records.size());
+    }
+    TEST_ASSERT_EQUAL(next, sent + spilled + model.size());
+    TEST_ASSERT_GREATER_THAN(0, spills);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fuzz_tiny_ring);
+    RUN_TEST(test_fuzz_memory_logger_sizes);
+    RUN_TEST(test_fuzz_record_sizes_near_capacity);
+    RUN_TEST(test_refuses_what_never_fits);
+    RUN_TEST(test_offline_queue_holds_sample_records);
+    RUN_TEST(test_offline_queue_flush_due);
+    RUN_TEST(test_fuzz_offline_queue_spills);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+/*
+ renderPayload() against the payload the firmware built before the templates:
+ a JsonDocument filled the way generateJSON_payload() and add_value2JSON_array()
+ did, serialized with serializeJson().
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdlib.h>
+#include "utils/payload_template.h"
+
+static const char *const TIMESTAMP = "2025-02-24T08:55:53+03";
+
+// the baseline generateJSON_payload(): integer values as int, the others as float
+static size_t baselinePayload(char *buf, size_t size, uint8_t id, const float *values)
+{
+    const SensorDescriptor &sensor = SENSOR_REGISTRY[id];
+    JsonDocument payload;
+    payload["software_version"] = "NRZ-2020-129";
+    payload["timestamp"] = TIMESTAMP;
+    JsonArray data = payload["sensordatavalues"].to<JsonArray>();
+    for (uint8_t i = 0; i < sensor.value_count; i++)
+    {
+        JsonObject obj = data.add<JsonObject>();
+        obj["value_type"] = sensor.values[i].api_key;
+        if (sensor.values[i].decimals == 0)
+            obj["value"] = (int)values[i];
+        else
+            obj["value"] = values[i];
+    }
+    payload["sensor_type"] = sensor.sensor_type;
+    payload["API_PIN"] = sensor.api_pin;
+    return serializeJson(payload, buf, size);
+}
+
+static void assertGolden(uint8_t id, const float *values)
+{
+    char expected[256], got[256];
+    size_t length = baselinePayload(expected, sizeof(expected), id, values);
+    size_t rendered = renderPayload(got, sizeof(got), id, TIMESTAMP, values);
+    TEST_ASSERT_EQUAL_STRING(expected, got);
+    TEST_ASSERT_EQUAL(length, rendered);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_pms_golden()
+{
+    // PM concentrations are integers: the template output is the baseline byte for byte
+    for (uint16_t pm = 0; pm <= 1000; pm++)
+    {
+        const float values[PMS_VALUE_COUNT] = {(float)pm, (float)(pm + 7), (float)(pm * 3)};
+        assertGolden(SENSOR_PMS, values);
+    }
+}
+
+void test_dht_golden()
+{
+    // DHT22 readings are tenths, converted in double as dhtConvertBits() does; where the tenths digit is not 0 both
+    // print the same single decimal
+    for (int t = -400; t <= 1250; t++)
+        for (int h = 1; h <= 1000; h += 37)
+        {
+            if (t % 10 == 0 || h % 10 == 0)
+                continue;
+            const float values[DHT_VALUE_COUNT] = {(float)(t * 0.1), (float)(h * 0.1)};
+            assertGolden(SENSOR_DHT, values);
+        }
+}
+
+void test_dht_whole_numbers_keep_their_decimal()
+{
+    // the one intended difference: 23.0 is written "23.0" (registry decimals), serializeJson() wrote "23"
+    for (int t = -40; t <= 125; t++)
+    {
+        const float values[DHT_VALUE_COUNT] = {(float)t, 50.0f};
+        char expected[256], got[256];
+        baselinePayload(expected, sizeof(expected), SENSOR_DHT, values);
+        TEST_ASSERT_GREATER_THAN(0, renderPayload(got, sizeof(got), SENSOR_DHT, TIMESTAMP, values));
+
+        TEST_ASSERT_NOT_NULL(strstr(expected, "\"value\":50}"));
+        TEST_ASSERT_NOT_NULL(strstr(got, "\"value\":50.0}"));
+        TEST_ASSERT_EQUAL(strlen(expected) + 4, strlen(got)); // ".0" twice
+        const char *value = strstr(got, "\"value\":") + 8;
+        TEST_ASSERT_EQUAL_FLOAT((float)t, strtof(value, nullptr));
+    }
+}
+
+void test_template_matches_registry()
+{
+    for (uint8_t id = 0; id < SENSOR_COUNT; id++)
+    {
+        const PayloadTemplate &t = PAYLOAD_TEMPLATES.of[id];
+        TEST_ASSERT_FALSE(t.overflow);
+        TEST_ASSERT_EQUAL(SENSOR_REGISTRY[id].value_count, t.value_count);
+        TEST_ASSERT_LESS_THAN(sizeof(t.text), t.length);
+        TEST_ASSERT_EQUAL(t.length, strnlen(t.text, sizeof(t.text))); // terminated right after the text
+    }
+}
+
+void test_overflow_leaves_empty_string()
+{
+    const float values[PMS_VALUE_COUNT] = {12, 34, 56};
+    char full[256];
+    size_t length = renderPayload(full, sizeof(full), SENSOR_PMS, TIMESTAMP, values);
+    TEST_ASSERT_GREATER_THAN(0, length);
+    for (size_t size = 1; size <= length; size++)
+    {
+        char buf[256];
+        memset(buf, 'x', sizeof(buf));
+        TEST_ASSERT_EQUAL(0, renderPayload(buf, size, SENSOR_PMS, TIMESTAMP, values));
+        TEST_ASSERT_EQUAL_STRING("", buf);
+    }
+    char buf[256];
+    TEST_ASSERT_EQUAL(length, renderPayload(buf, length + 1, SENSOR_PMS, TIMESTAMP, values));
+    TEST_ASSERT_EQUAL(0, renderPayload(buf, sizeof(buf), SENSOR_COUNT, TIMESTAMP, values));
+}
+
+void test_api_pin_read_back()
+{
+    const float values[DHT_VALUE_COUNT] = {23.4f, 65.2f};
+    char buf[256];
+    size_t length = renderPayload(buf, sizeof(buf), SENSOR_DHT, TIMESTAMP, values);
+    TEST_ASSERT_EQUAL(DHT_API_PIN, payloadApiPin(buf, length));
+    TEST_ASSERT_EQUAL(-1, payloadApiPin(buf, length - 1)); // torn line
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pms_golden);
+    RUN_TEST(test_dht_golden);
+    RUN_TEST(test_dht_whole_numbers_keep_their_decimal);
+    RUN_TEST(test_template_matches_registry);
+    RUN_TEST(test_overflow_leaves_empty_string);
+    RUN_TEST(test_api_pin_read_back);
+    return UNITY_END();
+}
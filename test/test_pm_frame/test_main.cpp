@@ -0,0 +1,273 @@
+/*
+ PlantowerFrameParser: hand-made edge cases, a generated fuzz corpus of good
+ frames mixed with line noise, truncated, corrupted and mislabelled frames,
+ and the parsing cost per byte.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "PMframe.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes makeFrame(uint8_t length, uint32_t seed)
+{
+    Bytes f(length);
+    f[0] = 'B';
+    f[1] = 'M';
+    f[2] = 0;
+    f[3] = length - 4;
+    uint16_t sum = 'B' + 'M' + length - 4;
+    for (uint8_t i = 4; i < length - 2; i++)
+    {
+        f[i] = (uint8_t)(seed * 31 + i * 7);
+        sum += f[i];
+    }
+    f[length - 2] = sum >> 8;
+    f[length - 1] = sum & 0xFF;
+    return f;
+}
+
+static std::vector<Bytes> parseAll(PlantowerFrameParser &p, const Bytes &stream)
+{
+    std::vector<Bytes> frames;
+    for (uint8_t c : stream)
+        if (p.feed(c) == PlantowerFrameParser::FRAME_READY)
+            frames.push_back(Bytes(p.frame(), p.frame() + p.length()));
+    return frames;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_frame_lengths()
+{
+    const uint8_t lengths[] = {24, 32, 40};
+    for (uint8_t length : lengths)
+    {
+        PlantowerFrameParser p;
+        Bytes f = makeFrame(length, length);
+        std::vector<Bytes> got = parseAll(p, f);
+        TEST_ASSERT_EQUAL(1, got.size());
+        TEST_ASSERT_EQUAL(length, p.length());
+        TEST_ASSERT_TRUE(got[0] == f);
+        TEST_ASSERT_FALSE(p.in_sync());
+    }
+}
+
+void test_unsupported_length()
+{
+    PlantowerFrameParser p;
+    const uint8_t header[] = {'B', 'M', 0x00, 0x10};
+    PlantowerFrameParser::RESULT r = PlantowerFrameParser::NEED_MORE;
+    for (uint8_t c : header)
+        r = p.feed(c);
+    TEST_ASSERT_EQUAL(PlantowerFrameParser::ERROR_LENGTH, r);
+    TEST_ASSERT_EQUAL(1, p.length_errors);
+    // the next frame is not affected
+    TEST_ASSERT_EQUAL(1, parseAll(p, makeFrame(32, 1)).size());
+}
+
+void test_checksum_error()
+{
+    PlantowerFrameParser p;
+    Bytes f = makeFrame(32, 2);
+    f[10] ^= 0x01;
+    PlantowerFrameParser::RESULT r = PlantowerFrameParser::NEED_MORE;
+    for (uint8_t c : f)
+        r = p.feed(c);
+    TEST_ASSERT_EQUAL(PlantowerFrameParser::ERROR_CKSUM, r);
+    TEST_ASSERT_EQUAL(1, p.cksum_errors);
+    TEST_ASSERT_EQUAL(0, p.frames);
+}
+
+void test_repeated_b_before_header()
+{
+    PlantowerFrameParser p;
+    Bytes stream = {'B', 'B', 'B'};
+    Bytes f = makeFrame(32, 3);
+    stream.insert(stream.end(), f.begin() + 1, f.end()); // "BBBM..."
+    std::vector<Bytes> got = parseAll(p, stream);
+    TEST_ASSERT_EQUAL(1, got.size());
+    TEST_ASSERT_TRUE(got[0] == f);
+    TEST_ASSERT_EQUAL(2, p.skipped);
+}
+
+void test_frame_after_truncated_frame()
+{
+    // the sensor was reset mid-frame: the good frame arrives inside the body of the broken one
+    PlantowerFrameParser p;
+    Bytes broken = makeFrame(32, 4);
+    broken.resize(20);
+    Bytes good = makeFrame(32, 5);
+    Bytes stream = broken;
+    stream.insert(stream.end(), good.begin(), good.end());
+    std::vector<Bytes> got = parseAll(p, stream);
+    TEST_ASSERT_EQUAL(1, got.size());
+    TEST_ASSERT_TRUE(got[0] == good);
+}
+
+void test_short_frame_inside_long_frame()
+{
+    // a 24 byte frame complete within the rejected body of a 40 byte one is reported
+    PlantowerFrameParser p;
+    Bytes stream = {'B', 'M', 0x00, 36, 0x11, 0x22};
+    Bytes inner = makeFrame(24, 6);
+    stream.insert(stream.end(), inner.begin(), inner.end());
+    while (stream.size() < 40)
+        stream.push_back(0x55);
+    std::vector<Bytes> got = parseAll(p, stream);
+    TEST_ASSERT_EQUAL(1, got.size());
+    TEST_ASSERT_TRUE(got[0] == inner);
+    TEST_ASSERT_EQUAL(1, p.cksum_errors);
+}
+
+void test_frame_right_after_replayed_frame()
+{
+    // 7 bytes of a broken 32 byte frame take in a whole 24 byte frame and the
+    // first byte of the next one: both frames come out
+    PlantowerFrameParser p;
+    Bytes stream = makeFrame(32, 7);
+    stream.resize(7);
+    Bytes first = makeFrame(24, 8), second = makeFrame(32, 9);
+    stream.insert(stream.end(), first.begin(), first.end());
+    stream.insert(stream.end(), second.begin(), second.end());
+    std::vector<Bytes> got = parseAll(p, stream);
+    TEST_ASSERT_EQUAL(2, got.size());
+    TEST_ASSERT_TRUE(got[0] == first);
+    TEST_ASSERT_TRUE(got[1] == second);
+}
+
+void test_block_feed_matches_byte_feed()
+{
+    Bytes stream;
+    for (uint32_t k = 0; k < 20; k++)
+    {
+        Bytes f = makeFrame(k % 3 == 0 ? 24 : 32, k);
+        stream.insert(stream.end(), f.begin(), f.end());
+        stream.push_back(0x00);
+    }
+    PlantowerFrameParser bytewise, blockwise;
+    std::vector<Bytes> expected = parseAll(bytewise, stream);
+
+    std::vector<Bytes> got;
+    size_t at = 0;
+    while (at < stream.size())
+    {
+        size_t chunk = std::min<size_t>(7, stream.size() - at), consumed = 0;
+        if (blockwise.feed(stream.data() + at, chunk, consumed) == PlantowerFrameParser::FRAME_READY)
+            got.push_back(Bytes(blockwise.frame(), blockwise.frame() + blockwise.length()));
+        at += consumed;
+    }
+    TEST_ASSERT_EQUAL(20, expected.size());
+    TEST_ASSERT_TRUE(got == expected);
+    TEST_ASSERT_EQUAL(bytewise.skipped, blockwise.skipped);
+}
+
+void test_fuzz_corpus()
+{
+    // every good frame comes out, in order and intact, whatever precedes it
+    std::mt19937 rng(20240611);
+    for (uint32_t round = 0; round < 20; round++)
+    {
+        Bytes stream;
+        std::vector<Bytes> expected;
+        for (uint32_t k = 0; k < 2000; k++)
+        {
+            uint32_t seed = round * 100000 + k;
+            Bytes f = makeFrame(rng() % 2 ? 32 : 24, seed);
+            switch (rng() % 6)
+            {
+            case 0: // line noise
+                for (uint32_t n = rng() % 64; n > 0; n--)
+                    stream.push_back(rng() & 0xFF);
+                continue;
+            case 1: // truncated, at least the checksum missing
+                f.resize(1 + rng() % (f.size() - 2));
+                break;
+            case 2: // corrupted byte, header kept
+                f[4 + rng() % (f.size() - 4)] ^= 1 << (rng() % 8);
+                break;
+            case 3: // announced length not supported
+                f[3] = (uint8_t)(f[3] + 1 + rng() % 8);
+                break;
+            default:
+                expected.push_back(f);
+                break;
+            }
+            stream.insert(stream.end(), f.begin(), f.end());
+        }
+
+        PlantowerFrameParser p;
+        std::vector<Bytes> got = parseAll(p, stream);
+        TEST_ASSERT_EQUAL(expected.size(), got.size());
+        TEST_ASSERT_TRUE(got == expected);
+        TEST_ASSERT_EQUAL(expected.size(), p.frames);
+    }
+}
+
+void test_fuzz_random_bytes()
+{
+    // no input makes the parser report a frame with a wrong checksum or length
+    std::mt19937 rng(7);
+    PlantowerFrameParser p;
+    for (uint32_t n = 0; n < 2000000; n++)
+    {
+        uint8_t c = rng() % 4 == 0 ? "BM\x00\x1c"[rng() % 4] : rng() & 0xFF;
+        if (p.feed(c) != PlantowerFrameParser::FRAME_READY)
+            continue;
+        const uint8_t *f = p.frame();
+        uint8_t length = p.length();
+        TEST_ASSERT_TRUE(length == 24 || length == 32 || length == 40);
+        TEST_ASSERT_TRUE(f[0] == 'B' && f[1] == 'M' && f[3] == length - 4);
+        uint16_t sum = 0;
+        for (uint8_t i = 0; i < length - 2; i++)
+            sum += f[i];
+        TEST_ASSERT_EQUAL((f[length - 2] << 8) | f[length - 1], sum);
+    }
+}
+
+void test_benchmark_parse_rate()
+{
+    Bytes stream;
+    for (uint32_t k = 0; k < 1000; k++)
+    {
+        Bytes f = makeFrame(32, k);
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+    const uint32_t rounds = 200;
+    PlantowerFrameParser p;
+    uint32_t frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; r++)
+        for (uint8_t c : stream)
+            frames += p.feed(c) == PlantowerFrameParser::FRAME_READY;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double perByte = ns / (rounds * stream.size());
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "PlantowerFrameParser: %.1f ns/byte, %.0f frames/s", perByte, frames * 1e9 / ns);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(rounds * 1000, frames);
+    // 9600 baud delivers a byte every ~1 ms; a host core must be three orders of magnitude faster
+    TEST_ASSERT_LESS_THAN(1000.0, perByte);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_lengths);
+    RUN_TEST(test_unsupported_length);
+    RUN_TEST(test_checksum_error);
+    RUN_TEST(test_repeated_b_before_header);
+    RUN_TEST(test_frame_after_truncated_frame);
+    RUN_TEST(test_short_frame_inside_long_frame);
+    RUN_TEST(test_frame_right_after_replayed_frame);
+    RUN_TEST(test_block_feed_matches_byte_feed);
+    RUN_TEST(test_fuzz_corpus);
+    RUN_TEST(test_fuzz_random_bytes);
+    RUN_TEST(test_benchmark_parse_rate);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+/*
+ SpscQueue between two std::threads the way the sampling task and loop() use
+ it: every entry arrives once, in order and intact, with and without the
+ producer giving up the oldest entry when the queue is full.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include "utils/spsc_queue.h"
+
+// large enough that a torn copy shows up in the check words
+struct Item
+{
+    uint32_t seq;
+    uint32_t check[7];
+};
+
+static const uint32_t ITEMS = 300000;
+
+struct StressResult
+{
+    uint32_t received = 0;
+    uint32_t dropped = 0;
+    bool ordered = true; // strictly increasing; without drops also without gaps
+    bool intact = true;
+};
+
+template <size_t Capacity>
+static StressResult stress(bool drop)
+{
+    static SpscQueue<Item, Capacity> queue; // reused: each run leaves it empty
+    StressResult result;
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<bool> done{false};
+
+    std::thread consumer([&]
+    {
+        std::mt19937 rng(2);
+        uint32_t last = UINT32_MAX;
+        Item item;
+        for (;;)
+        {
+            if (!queue.pop(item))
+            {
+                if (!done.load())
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // done is set after the last push: one more pop finds anything left
+                if (!queue.pop(item))
+                    break;
+            }
+            if (last != UINT32_MAX && (item.seq <= last || (!drop && item.seq != last + 1)))
+                result.ordered = false;
+            for (uint32_t k = 0; k < 7; k++)
+                if (item.check[k] != item.seq * 31 + k)
+                    result.intact = false;
+            last = item.seq;
+            result.received++;
+            if (rng() % 64 == 0)
+                std::this_thread::yield();
+        }
+    });
+
+    std::thread producer([&]
+    {
+        std::mt19937 rng(1);
+        for (uint32_t i = 0; i < ITEMS; i++)
+        {
+            Item item = {i, {}};
+            for (uint32_t k = 0; k < 7; k++)
+                item.check[k] = i * 31 + k;
+            while (!queue.push(item))
+            {
+                if (drop && queue.full())
+                {
+                    if (queue.dropOldest())
+                        dropped++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+            if (rng() % 128 == 0)
+                std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    producer.join();
+    consumer.join();
+    result.dropped = dropped.load();
+    TEST_ASSERT_EQUAL(0, queue.size());
+    return result;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_every_entry_arrives_in_order_capacity_2()
+{
+    StressResult r = stress<2>(false);
+    TEST_ASSERT_TRUE(r.ordered);
+    TEST_ASSERT_TRUE(r.intact);
+    TEST_ASSERT_EQUAL(ITEMS, r.received);
+    TEST_ASSERT_EQUAL(0, r.dropped);
+}
+
+void test_every_entry_arrives_in_order_capacity_8()
+{
+    StressResult r = stress<8>(false);
+    TEST_ASSERT_TRUE(r.ordered);
+    TEST_ASSERT_TRUE(r.intact);
+    TEST_ASSERT_EQUAL(ITEMS, r.received);
+}
+
+void test_drop_oldest_never_duplicates_capacity_2()
+{
+    // the consumer and a dropping producer race for the same oldest entry
+    StressResult r = stress<2>(true);
+    TEST_ASSERT_TRUE(r.ordered);
+    TEST_ASSERT_TRUE(r.intact);
+    TEST_ASSERT_EQUAL(ITEMS, r.received + r.dropped);
+}
+
+void test_drop_oldest_never_duplicates_capacity_8()
+{
+    StressResult r = stress<8>(true);
+    TEST_ASSERT_TRUE(r.ordered);
+    TEST_ASSERT_TRUE(r.intact);
+    TEST_ASSERT_EQUAL(ITEMS, r.received + r.dropped);
+}
+
+void test_single_thread_wraps_around()
+{
+    SpscQueue<uint32_t, 4> queue;
+    uint32_t out = 0;
+    TEST_ASSERT_FALSE(queue.pop(out));
+    TEST_ASSERT_FALSE(queue.dropOldest());
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        TEST_ASSERT_TRUE(queue.push(i));
+        TEST_ASSERT_TRUE(queue.push(i + 1));
+        TEST_ASSERT_EQUAL(2, queue.size());
+        TEST_ASSERT_TRUE(queue.pop(out));
+        TEST_ASSERT_EQUAL(i, out);
+        TEST_ASSERT_TRUE(queue.pop(out));
+        TEST_ASSERT_EQUAL(i + 1, out);
+    }
+    for (uint32_t i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_TRUE(queue.full());
+    TEST_ASSERT_FALSE(queue.push(4));
+    TEST_ASSERT_TRUE(queue.dropOldest());
+    TEST_ASSERT_TRUE(queue.push(4));
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL(1, out);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_thread_wraps_around);
+    RUN_TEST(test_every_entry_arrives_in_order_capacity_2);
+    RUN_TEST(test_every_entry_arrives_in_order_capacity_8);
+    RUN_TEST(test_drop_oldest_never_duplicates_capacity_2);
+    RUN_TEST(test_drop_oldest_never_duplicates_capacity_8);
+    return UNITY_END();
+}
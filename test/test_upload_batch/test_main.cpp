@@ -0,0 +1,272 @@
+/*
+ UploadBatch: the envelope and its limits, and a day of minute readings pushed
+ through the uploadBatched()/sendBatch() logic of main.cpp to an endpoint that
+ counts requests, with and without batching and when it rejects batches.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "utils/payload_template.h"
+#include "utils/upload_batch.h"
+
+// rough cost of one HTTPS POST over the modem: connection, TLS, headers and the answer, then the body itself
+static const double REQUEST_OVERHEAD_S = 2.0;
+static const double LINK_BYTES_PER_S = 4000;
+
+struct Endpoint
+{
+    bool rejectBatches = false;
+    uint32_t requests = 0;
+    size_t bytes = 0;
+    std::vector<std::string> received; // payloads, in the order they arrived
+
+    // sendData(): true for a 2xx answer
+    bool post(const char *body, size_t n)
+    {
+        requests++;
+        bytes += n;
+        std::string s(body, n);
+        if (s[0] == '[')
+        {
+            if (rejectBatches)
+                return false; // HTTP 400, see isBatchRejection()
+            unwrap(s);
+        }
+        else
+        {
+            received.push_back(s);
+        }
+        return true;
+    }
+
+    // payloads are objects without nested arrays of objects at the top level: split on depth
+    void unwrap(const std::string &s)
+    {
+        int depth = 0;
+        size_t start = 0;
+        for (size_t i = 1; i + 1 < s.size(); i++)
+        {
+            if (s[i] == '{' && depth++ == 0)
+                start = i;
+            else if (s[i] == '}' && --depth == 0)
+                received.push_back(s.substr(start, i - start + 1));
+        }
+    }
+
+    double seconds() const
+    {
+        return requests * REQUEST_OVERHEAD_S + bytes / LINK_BYTES_PER_S;
+    }
+};
+
+struct Uploader
+{
+    Endpoint &endpoint;
+    bool rejected = false;
+
+    void sendBatch(UploadBatch &batch)
+    {
+        if (batch.empty())
+            return;
+        if (batch.count > 1 && !rejected)
+        {
+            size_t length = batch.finish();
+            if (endpoint.post(batch.body(), length))
+            {
+                batch.clear();
+                return;
+            }
+            rejected = true;
+        }
+        for (uint8_t i = 0; i < batch.count; i++)
+            TEST_ASSERT_TRUE(endpoint.post(batch.record(i), batch.recordLength(i)));
+        batch.clear();
+    }
+
+    void uploadBatched(UploadBatch &batch, const char *payload, uint8_t api_pin)
+    {
+        size_t length = strlen(payload);
+        if (batch.add(payload, length, api_pin))
+            return;
+        sendBatch(batch);
+        if (batch.add(payload, length, api_pin))
+            return;
+        endpoint.post(payload, length);
+    }
+};
+
+// a day of PMS and DHT readings, one a minute
+static std::vector<std::string> dayOfPayloads()
+{
+    std::vector<std::string> payloads;
+    for (uint32_t minute = 0; minute < 24 * 60; minute++)
+    {
+        char timestamp[32], payload[256];
+        snprintf(timestamp, sizeof(timestamp), "2025-02-24T%02u:%02u:00+03", (unsigned)(minute / 60), (unsigned)(minute % 60));
+        const float pm[PMS_VALUE_COUNT] = {(float)(minute % 40), (float)(minute % 90), (float)(minute % 60)};
+        renderPayload(payload, sizeof(payload), SENSOR_PMS, timestamp, pm);
+        payloads.push_back(payload);
+        const float dht[DHT_VALUE_COUNT] = {(float)(200 + minute % 100) / 10, (float)(400 + minute % 300) / 10};
+        renderPayload(payload, sizeof(payload), SENSOR_DHT, timestamp, dht);
+        payloads.push_back(payload);
+    }
+    return payloads;
+}
+
+static Endpoint upload(const std::vector<std::string> &payloads, bool batching, bool rejectBatches)
+{
+    Endpoint endpoint;
+    endpoint.rejectBatches = rejectBatches;
+    Uploader uploader{endpoint};
+    static char body[BATCH_BODY_BUFFER_BYTES];
+    UploadBatch batch(body, sizeof(body), BATCH_MAX_RECORDS, BATCH_MAX_BYTES);
+    for (const std::string &p : payloads)
+    {
+        if (batching)
+            uploader.uploadBatched(batch, p.c_str(), (uint8_t)payloadApiPin(p.c_str(), p.size()));
+        else
+            endpoint.post(p.c_str(), p.size());
+    }
+    uploader.sendBatch(batch);
+    return endpoint;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_envelope()
+{
+    char body[64];
+    UploadBatch batch(body, sizeof(body), 4, 100);
+    TEST_ASSERT_TRUE(batch.empty());
+    TEST_ASSERT_TRUE(batch.add("{\"a\":1}", 7, 1, "r1"));
+    TEST_ASSERT_TRUE(batch.add("{\"b\":2}", 7, 7));
+    TEST_ASSERT_EQUAL(17, batch.finish());
+    TEST_ASSERT_EQUAL_STRING("[{\"a\":1},{\"b\":2}]", batch.body());
+    TEST_ASSERT_EQUAL(0, strncmp(batch.record(1), "{\"b\":2}", batch.recordLength(1)));
+    TEST_ASSERT_EQUAL(7, batch.recordPin(1));
+    TEST_ASSERT_EQUAL_STRING("r1", batch.recordSource(0));
+    TEST_ASSERT_NULL(batch.recordSource(1));
+
+    batch.clear();
+    TEST_ASSERT_TRUE(batch.empty());
+    TEST_ASSERT_TRUE(batch.add("{}", 2, 1));
+    TEST_ASSERT_EQUAL(4, batch.finish());
+    TEST_ASSERT_EQUAL_STRING("[{}]", batch.body());
+}
+
+void test_byte_limit_boundary()
+{
+    char body[64];
+    UploadBatch batch(body, sizeof(body), 8, 10); // "[" + 8 bytes + "]"
+    TEST_ASSERT_FALSE(batch.add("{\"ab\":12}", 9, 1)); // one byte too many
+    TEST_ASSERT_TRUE(batch.empty());
+    TEST_ASSERT_TRUE(batch.add("{\"a\":12}", 8, 1));
+    TEST_ASSERT_FALSE(batch.add("{}", 2, 1));
+    TEST_ASSERT_EQUAL(10, batch.finish());
+}
+
+void test_record_limit_and_clamps()
+{
+    char body[512];
+    UploadBatch none(body, sizeof(body), 0, 500);
+    TEST_ASSERT_EQUAL(1, none.maxRecords);
+    UploadBatch many(body, sizeof(body), 200, 500);
+    TEST_ASSERT_EQUAL(UPLOAD_BATCH_MAX_RECORDS, many.maxRecords);
+    UploadBatch small(body, 16, 4, 500);
+    TEST_ASSERT_EQUAL(15, small.limit); // the terminator always fits
+
+    UploadBatch batch(body, sizeof(body), 3, 500);
+    for (uint8_t i = 0; i < 3; i++)
+        TEST_ASSERT_TRUE(batch.add("{}", 2, i));
+    TEST_ASSERT_FALSE(batch.add("{}", 2, 3));
+    TEST_ASSERT_EQUAL(3, batch.count);
+}
+
+void test_day_of_readings_batched()
+{
+    std::vector<std::string> payloads = dayOfPayloads();
+    Endpoint single = upload(payloads, false, false);
+    Endpoint batched = upload(payloads, true, false);
+    Endpoint rejected = upload(payloads, true, true);
+
+    // every payload arrives once, in order, whichever way it went
+    TEST_ASSERT_TRUE(single.received == payloads);
+    TEST_ASSERT_TRUE(batched.received == payloads);
+    TEST_ASSERT_TRUE(rejected.received == payloads);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "%u payloads: single %u requests %.0f s, batched %u requests %.0f s (%.1f payloads/s vs %.1f), "
+             "after a rejected batch %u requests",
+             (unsigned)payloads.size(), (unsigned)single.requests, single.seconds(), (unsigned)batched.requests,
+             batched.seconds(), payloads.size() / batched.seconds(), payloads.size() / single.seconds(),
+             (unsigned)rejected.requests);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL(payloads.size(), single.requests);
+    // ~200 byte payloads: the 2 KB limit takes 9 or 10 a request
+    TEST_ASSERT_LESS_OR_EQUAL(payloads.size() / 8, batched.requests);
+    TEST_ASSERT_GREATER_OR_EQUAL(payloads.size() / BATCH_MAX_RECORDS, batched.requests);
+    TEST_ASSERT_LESS_THAN(single.seconds() / 5, batched.seconds());
+    // one rejected batch, then single posts
+    TEST_ASSERT_EQUAL(payloads.size() + 1, rejected.requests);
+}
+
+void test_payload_larger_than_a_batch_goes_alone()
+{
+    Endpoint endpoint;
+    Uploader uploader{endpoint};
+    char body[BATCH_BODY_BUFFER_BYTES];
+    UploadBatch batch(body, sizeof(body), BATCH_MAX_RECORDS, 64);
+    std::string big = "{\"API_PIN\":1,\"pad\":\"" + std::string(100, 'x') + "\"}";
+    uploader.uploadBatched(batch, "{\"API_PIN\":1}", 1);
+    uploader.uploadBatched(batch, big.c_str(), 1);
+    uploader.sendBatch(batch);
+    TEST_ASSERT_EQUAL(2, endpoint.requests);
+    TEST_ASSERT_EQUAL(2, endpoint.received.size());
+    TEST_ASSERT_TRUE(endpoint.received[1] == big);
+}
+
+void test_benchmark_packing()
+{
+    std::vector<std::string> payloads = dayOfPayloads();
+    std::vector<size_t> lengths;
+    for (const std::string &p : payloads)
+        lengths.push_back(p.size());
+    static char body[BATCH_BODY_BUFFER_BYTES];
+    UploadBatch batch(body, sizeof(body), BATCH_MAX_RECORDS, BATCH_MAX_BYTES);
+
+    const uint32_t rounds = 200;
+    size_t bodies = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; r++)
+        for (size_t i = 0; i < payloads.size(); i++)
+            if (!batch.add(payloads[i].c_str(), lengths[i], 1))
+            {
+                bodies += batch.finish() > 0;
+                batch.clear();
+                batch.add(payloads[i].c_str(), lengths[i], 1);
+            }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                (rounds * payloads.size());
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "UploadBatch::add: %.0f ns/payload, %u bodies", ns, (unsigned)bodies);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_GREATER_THAN(0, bodies);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_envelope);
+    RUN_TEST(test_byte_limit_boundary);
+    RUN_TEST(test_record_limit_and_clamps);
+    RUN_TEST(test_day_of_readings_batched);
+    RUN_TEST(test_payload_larger_than_a_batch_goes_alone);
+    RUN_TEST(test_benchmark_packing);
+    return UNITY_END();
+}